@@ -19,6 +19,12 @@
 
   Feel like supporting our work? Buy a board from SparkFun!
   https://www.sparkfun.com/products/18642
+
+  Team Practical Projects: with binaryStream true this reads the binary frames
+  sent by the animatronic eyes when the "tof recorder" cloud function is set to
+  "serial" (see TPP_TOFFrame.h). Frames carry a CRC, so the log messages that
+  share the serial port are skipped. Zones with bad status are drawn in grey. The
+  window title shows the frames received, missed and rejected.
 */
 
 import processing.serial.*;
@@ -27,6 +33,22 @@ import processing.serial.*;
 Serial port; // Initialize Serial object
 String buff = ""; // Create a serial buffer
 int[] depths = new int[64]; // Create a list to parse serial into 
+int[] statuses = new int[64]; // Target status of each zone, binary stream only
+
+// Binary stream variables, see TPP_TOFFrame.h
+boolean binaryStream = true; // false for the comma separated text of the SparkFun examples
+final int FRAME_SYNC = 0x4654;
+final int FRAME_HEADER_BYTES = 14;
+final int FLAG_DELTA = 0x01;
+final int FLAG_CALIBRATION = 0x02;
+final int FLAG_STATUS_NIBBLES = 0x08;
+final int FLAG_CRC = 0x10;
+byte[] rx = new byte[4096]; // bytes received that are not yet decoded
+int rxLength = 0;
+int lastFrameNumber = -1;
+int framesReceived = 0;
+int framesMissed = 0;
+int framesRejected = 0;
 
 // Mesh Generation Variables
 int cols = 8; // Sensor is 8x8
@@ -50,12 +72,17 @@ void setup(){
   size(700,700, P3D); // Make a 3D capable window
    
   port = new Serial(this, "COM21", 115200); // CHANGE COM13 TO YOUR SERIAL PORT
-  port.bufferUntil(10); // ASCII LineFeed Character
+  if (binaryStream) {
+    port.buffer(64); // decode in chunks rather than byte by byte
+  } else {
+    port.bufferUntil(10); // ASCII LineFeed Character
+  }
    
   // Fill our list with 0s to avoid a null pointer exception
   // in case the sensor data is not immediately available
   for(int idx = 0; idx < 64; idx++){
     depths[idx] = 0; 
+    statuses[idx] = 5;
   }
  
 }
@@ -67,6 +94,10 @@ void draw(){
   noStroke(); // Draw without stroke
   smooth(); // Draw with anti-aliasing
   background(0); // Fill background with black
+
+  if (binaryStream) {
+    surface.setTitle("frames " + framesReceived + "  missed " + framesMissed + "  rejected " + framesRejected);
+  }
   
   // This stuff is all basically to scale and rotate the mesh
   // while keeping it in the center of the scene
@@ -96,7 +127,8 @@ void draw(){
   for(int y=0; y<rows-1; y++){
     beginShape(TRIANGLE_STRIP);
     for(int x=0; x<cols; x++){
-      fill(map(terrain[x][y],0,400,255,0),255,255);
+      boolean good = (statuses[x+y*cols] == 5) || (statuses[x+y*cols] == 6) || (statuses[x+y*cols] == 9);
+      fill(map(terrain[x][y],0,400,255,0), good ? 255 : 0, 255);
       vertex(x*scale,y*scale, terrain[x][y]);
       vertex(x*scale, (y+1)*scale, terrain[x][y+1]);
     }
@@ -108,6 +140,11 @@ void draw(){
 // Handle incoming serial data
 void serialEvent(Serial p){ 
   
+  if (binaryStream) {
+    readBinaryFrames(p);
+    return;
+  }
+
   buff = (port.readString()); // read the whole line
   buff = buff.substring(0, buff.length()-1); // remove the Carriage Return
   if (buff != "") {
@@ -115,6 +152,104 @@ void serialEvent(Serial p){
   }
 }
 
+// Add the bytes that have arrived to rx and decode every whole frame in it
+void readBinaryFrames(Serial p) {
+
+  byte[] in = p.readBytes();
+  if (in == null) {
+    return;
+  }
+  if (rxLength + in.length > rx.length) {
+    rxLength = 0; // we fell behind; start over
+  }
+  System.arraycopy(in, 0, rx, rxLength, min(in.length, rx.length));
+  rxLength += min(in.length, rx.length);
+
+  int start = 0;
+  while (rxLength - start >= FRAME_HEADER_BYTES) {
+    int used = decodeFrame(start);
+    if (used == 0) {
+      break; // wait for the rest of the frame
+    }
+    start += (used > 0) ? used : 1; // not a frame here, look for the next sync word
+  }
+  System.arraycopy(rx, start, rx, 0, rxLength - start);
+  rxLength -= start;
+}
+
+// Decode the frame at rx[start]. Returns the number of bytes used, 0 if the frame
+// is not all here yet, or -1 if there is no good frame at start.
+int decodeFrame(int start) {
+
+  if (get16(start) != FRAME_SYNC) {
+    return -1;
+  }
+  int flags = rx[start + 2] & 0xFF;
+  int zones = rx[start + 3] & 0xFF;
+  int frameNumber = get16(start + 4);
+  int payloadBytes = get16(start + 8);
+  int frameBytes = FRAME_HEADER_BYTES + payloadBytes + 2;
+
+  // the viewer only understands absolute frames with a CRC
+  if (((flags & FLAG_CRC) == 0) || ((flags & FLAG_DELTA) != 0) || (zones > 64) || (frameBytes > rx.length)) {
+    return -1;
+  }
+  if (rxLength - start < frameBytes) {
+    return 0;
+  }
+  if (crc16(start, frameBytes - 2) != get16(start + frameBytes - 2)) {
+    framesRejected++;
+    return -1;
+  }
+  if ((flags & FLAG_CALIBRATION) != 0) {
+    return frameBytes;
+  }
+
+  int[] newDepths = new int[64];
+  int[] newStatuses = new int[64];
+  int p = start + FRAME_HEADER_BYTES;
+  for (int i = 0; i < zones; i++) {
+    newDepths[i] = (short)get16(p);
+    p += 2;
+  }
+  for (int i = 0; i < zones; i++) {
+    if ((flags & FLAG_STATUS_NIBBLES) != 0) {
+      newStatuses[i] = ((i & 1) == 1) ? ((rx[p + i/2] >> 4) & 0x0F) : (rx[p + i/2] & 0x0F);
+    } else {
+      newStatuses[i] = rx[p + i] & 0xFF;
+    }
+  }
+
+  if ((lastFrameNumber >= 0) && (frameNumber > lastFrameNumber + 1)) {
+    framesMissed += frameNumber - lastFrameNumber - 1;
+  }
+  lastFrameNumber = frameNumber;
+  framesReceived++;
+
+  cols = (zones == 16) ? 4 : 8;
+  rows = cols;
+  statuses = newStatuses;
+  depths = newDepths;
+  return frameBytes;
+}
+
+int get16(int index) {
+  return (rx[index] & 0xFF) | ((rx[index + 1] & 0xFF) << 8);
+}
+
+// CRC-16/CCITT, polynomial 0x1021, start 0xFFFF, as in TPP_TOFFrame.cpp
+int crc16(int start, int length) {
+  int crc = 0xFFFF;
+  for (int i = start; i < start + length; i++) {
+    crc ^= (rx[i] & 0xFF) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = ((crc & 0x8000) != 0) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+      crc &= 0xFFFF;
+    }
+  }
+  return crc;
+}
+
 // Wehn the mouse is pressed, remember where the cursor was
 // so we can calculate how "far" it gets dragged
 void mousePressed() {
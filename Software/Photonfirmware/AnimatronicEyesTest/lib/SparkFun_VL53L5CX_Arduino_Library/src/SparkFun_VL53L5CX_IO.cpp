@@ -46,6 +46,8 @@ void SparkFun_VL53L5CX_IO::setAddress(uint8_t newAddress)
 uint8_t SparkFun_VL53L5CX_IO::writeMultipleBytes(uint16_t registerAddress, uint8_t *buffer, uint16_t bufferSize)
 {
     // Chunk I2C transactions into limit of 32 bytes (or wireMaxPacketSize)
+    // The firmware download at init is about 86 KB, so a large Wire buffer
+    // (see setMaxPacketSize) makes init much faster
     uint8_t i2cError = 0;
     uint32_t startSpot = 0;
     uint32_t bytesToSend = bufferSize;
@@ -58,10 +60,7 @@ uint8_t SparkFun_VL53L5CX_IO::writeMultipleBytes(uint16_t registerAddress, uint8
         _i2cPort->beginTransmission((uint8_t)_address);
         _i2cPort->write(highByte(registerAddress));
         _i2cPort->write(lowByte(registerAddress));
-
-        // TODO write a subsection of the buffer rather than byte wise
-        for (uint16_t x = 0; x < len; x++)
-            _i2cPort->write(buffer[startSpot + x]); // Write a portion of the payload to the bus
+        _i2cPort->write(&buffer[startSpot], len); // Write a portion of the payload to the bus
 
         i2cError = _i2cPort->endTransmission(); // Release bus because we are writing the address each time
         if (i2cError != 0)
@@ -96,7 +95,7 @@ uint8_t SparkFun_VL53L5CX_IO::readMultipleBytes(uint16_t registerAddress, uint8_
         if (bytesToRead > wireMaxPacketSize)
             bytesToRead = wireMaxPacketSize;
 
-        _i2cPort->requestFrom((uint8_t)_address, (uint8_t)bytesToRead);
+        _i2cPort->requestFrom((uint8_t)_address, (size_t)bytesToRead);
         if (_i2cPort->available())
         {
             for (uint16_t x = 0; x < bytesToRead; x++)
@@ -35,8 +35,8 @@ private:
   // Sensor address
   uint8_t _address;
 
-  // I2C maximum packet size
-  uint8_t wireMaxPacketSize = I2C_BUFFER_SIZE;
+  // I2C maximum packet size, the size of the Wire buffer
+  uint16_t wireMaxPacketSize = I2C_BUFFER_SIZE;
 
 public:
   // Default constructor
@@ -64,10 +64,10 @@ public:
   uint8_t writeMultipleBytes(uint16_t registerAddress, uint8_t *buffer, uint16_t bufferSize);
 
   // Get I2C maximum packet size
-  uint8_t getMaxPacketSize() { return wireMaxPacketSize; }
+  uint16_t getMaxPacketSize() { return wireMaxPacketSize; }
 
   // Set I2C maximum packet size
-  void setMaxPacketSize(uint8_t newSize) { wireMaxPacketSize = newSize; }
+  void setMaxPacketSize(uint16_t newSize) { wireMaxPacketSize = newSize; }
 };
 
 #endif
\ No newline at end of file
@@ -21,9 +21,13 @@
 
 #include "SparkFun_VL53L5CX_Library.h"
 #include "vl53l5cx_api.h"
+#include "vl53l5cx_plugin_xtalk.h"
 
-SparkFun_VL53L5CX_IO VL53L5CX_i2c; // I2C driver object
-VL53L5CX_Configuration configDev;        // Sensor condfiguration struct
+SparkFun_VL53L5CX::SparkFun_VL53L5CX()
+{
+    // The platform layer reaches the I2C bus through this sensor's driver
+    configDev.platform.p_i2c = &VL53L5CX_i2c;
+}
 
 void SparkFun_VL53L5CX::clearErrorStruct()
 {
@@ -36,8 +40,18 @@ bool SparkFun_VL53L5CX::begin(byte address, TwoWire &wirePort)
 {
     clearErrorStruct();
 
+    if (!connect(address, wirePort))
+        return false;
+
+    return initStepResult(vl53l5cx_init(&configDev));
+}
+
+bool SparkFun_VL53L5CX::connect(byte address, TwoWire &wirePort)
+{
+    configDev.platform.p_i2c = &VL53L5CX_i2c;
+    configDev.platform.address = address;
+    this->address = address;
     bool ready = VL53L5CX_i2c.begin(address, wirePort);
-    uint8_t result = 0;
     uint8_t deviceId = 0;
     uint8_t revisionId = 0;
 
@@ -60,8 +74,11 @@ bool SparkFun_VL53L5CX::begin(byte address, TwoWire &wirePort)
         return false;
     }
 
-    result = vl53l5cx_init(&configDev);
+    return true;
+}
 
+bool SparkFun_VL53L5CX::initStepResult(uint8_t result)
+{
     if (result == 0)
         return true;
 
@@ -71,6 +88,40 @@ bool SparkFun_VL53L5CX::begin(byte address, TwoWire &wirePort)
     return false;
 }
 
+bool SparkFun_VL53L5CX::beginReboot(byte address, TwoWire &wirePort)
+{
+    clearErrorStruct();
+
+    if (!connect(address, wirePort))
+        return false;
+
+    firmwareOffset = 0;
+    return initStepResult(vl53l5cx_init_reboot(&configDev));
+}
+
+bool SparkFun_VL53L5CX::beginWakeup()
+{
+    clearErrorStruct();
+    return initStepResult(vl53l5cx_init_wakeup(&configDev));
+}
+
+bool SparkFun_VL53L5CX::beginDownload(uint32_t maxBytes)
+{
+    clearErrorStruct();
+    return initStepResult(vl53l5cx_init_download(&configDev, &firmwareOffset, maxBytes));
+}
+
+uint32_t SparkFun_VL53L5CX::getFirmwareBytesRemaining()
+{
+    return VL53L5CX_FIRMWARE_SIZE - firmwareOffset;
+}
+
+bool SparkFun_VL53L5CX::beginFinish()
+{
+    clearErrorStruct();
+    return initStepResult(vl53l5cx_init_finish(&configDev));
+}
+
 void SparkFun_VL53L5CX::setErrorCallback(void (*_errorCallback)(SF_VL53L5CX_ERROR_TYPE errorCode, uint32_t errorValue))
 {
     errorCallback = _errorCallback;
@@ -117,6 +168,7 @@ bool SparkFun_VL53L5CX::setAddress(uint8_t newAddress)
     {
         VL53L5CX_i2c.setAddress(newAddress); // Update driver's knowledg of address
         address = newAddress;
+        configDev.platform.address = newAddress;
 
         result |= VL53L5CX_i2c.writeSingleByte(0x7fff, 0x02);
         return true;
@@ -473,12 +525,57 @@ SF_VL53L5CX_TARGET_ORDER SparkFun_VL53L5CX::getTargetOrder()
     return SF_VL53L5CX_TARGET_ORDER::ERROR;
 }
 
-uint8_t SparkFun_VL53L5CX::getWireMaxPacketSize()
+bool SparkFun_VL53L5CX::calibrateXtalk(uint16_t reflectancePercent, uint8_t numSamples, uint16_t distanceMM)
+{
+    clearErrorStruct();
+
+    uint8_t result = vl53l5cx_calibrate_xtalk(&configDev, reflectancePercent, numSamples, distanceMM);
+
+    if (result == 0)
+        return true;
+
+    lastError.lastErrorCode = SF_VL53L5CX_ERROR_TYPE::CANNOT_CALIBRATE_XTALK;
+    lastError.lastErrorValue = static_cast<uint32_t>(result);
+    SAFE_CALLBACK(errorCallback, lastError.lastErrorCode, lastError.lastErrorValue);
+    return false;
+}
+
+bool SparkFun_VL53L5CX::getXtalkCalibrationData(uint8_t *pData)
+{
+    clearErrorStruct();
+
+    uint8_t result = vl53l5cx_get_caldata_xtalk(&configDev, pData);
+
+    if (result == 0)
+        return true;
+
+    lastError.lastErrorCode = SF_VL53L5CX_ERROR_TYPE::CANNOT_GET_XTALK_DATA;
+    lastError.lastErrorValue = static_cast<uint32_t>(result);
+    SAFE_CALLBACK(errorCallback, lastError.lastErrorCode, lastError.lastErrorValue);
+    return false;
+}
+
+bool SparkFun_VL53L5CX::setXtalkCalibrationData(uint8_t *pData)
+{
+    clearErrorStruct();
+
+    uint8_t result = vl53l5cx_set_caldata_xtalk(&configDev, pData);
+
+    if (result == 0)
+        return true;
+
+    lastError.lastErrorCode = SF_VL53L5CX_ERROR_TYPE::CANNOT_SET_XTALK_DATA;
+    lastError.lastErrorValue = static_cast<uint32_t>(result);
+    SAFE_CALLBACK(errorCallback, lastError.lastErrorCode, lastError.lastErrorValue);
+    return false;
+}
+
+uint16_t SparkFun_VL53L5CX::getWireMaxPacketSize()
 {
     return VL53L5CX_i2c.getMaxPacketSize();
 }
 
-void SparkFun_VL53L5CX::setWireMaxPacketSize(uint8_t newSize)
+void SparkFun_VL53L5CX::setWireMaxPacketSize(uint16_t newSize)
 {
     VL53L5CX_i2c.setMaxPacketSize(newSize);
 }
\ No newline at end of file
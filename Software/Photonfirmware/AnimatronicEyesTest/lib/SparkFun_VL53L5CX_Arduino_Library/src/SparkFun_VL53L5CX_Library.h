@@ -51,16 +51,41 @@ private:
     // Clears the error struct to a no-error state.
     void clearErrorStruct();
 
+    // Sets up the I2C driver and checks the device ID and revision ID.
+    bool connect(byte address, TwoWire &wirePort);
+
+    // Records a failed init step in the lastError struct.
+    bool initStepResult(uint8_t result);
+
+    // Firmware bytes sent by beginDownload so far.
+    uint32_t firmwareOffset = 0;
+
+    // I2C driver object. One per sensor so several sensors can share the bus.
+    SparkFun_VL53L5CX_IO VL53L5CX_i2c;
+
+    // Sensor configuration struct.
+    VL53L5CX_Configuration configDev;
+
 public:
     // This struct holds the last error which happened (if any).
     SparkFun_VL53L5CX_Error lastError;
 
-    // Default empty constructor.
-    SparkFun_VL53L5CX(){};
+    // Default constructor.
+    SparkFun_VL53L5CX();
 
     // Start up the sensor. Passing an address and Wire port instance is optional.
     bool begin(byte address = (DEFAULT_I2C_ADDR >> 1), TwoWire &wirePort = Wire);
 
+    // The steps of begin(), for a caller that cannot wait the second or more it takes.
+    // Call beginReboot(), wait at least 100 ms, call beginWakeup(), call beginDownload()
+    // until getFirmwareBytesRemaining() returns 0, then call beginFinish().
+    // If a step returns false an error entry will be stored in the lastError struct.
+    bool beginReboot(byte address = (DEFAULT_I2C_ADDR >> 1), TwoWire &wirePort = Wire);
+    bool beginWakeup();
+    bool beginDownload(uint32_t maxBytes);
+    uint32_t getFirmwareBytesRemaining();
+    bool beginFinish();
+
     // Set the error callback function.
     void setErrorCallback(void (*errorCallback)(SF_VL53L5CX_ERROR_TYPE errorCode, uint32_t errorValue));
 
@@ -144,10 +169,24 @@ public:
     // If this function returns SF_VL53L5CX_TARGET_ORDER::ERROR an error entry will be stored in the lastError struct.
     SF_VL53L5CX_TARGET_ORDER getTargetOrder();
 
+    // Runs the crosstalk calibration, with a target of reflectancePercent at distanceMM
+    // (600 to 3000 mm) filling the field of view. Takes several seconds. Ranging must be stopped.
+    // If this function returns false an error entry will be stored in the lastError struct.
+    bool calibrateXtalk(uint16_t reflectancePercent, uint8_t numSamples, uint16_t distanceMM);
+
+    // Copies the crosstalk calibration, VL53L5CX_XTALK_BUFFER_SIZE bytes, to pData.
+    // If this function returns false an error entry will be stored in the lastError struct.
+    bool getXtalkCalibrationData(uint8_t *pData);
+
+    // Replaces the crosstalk calibration with one read by getXtalkCalibrationData.
+    // Call after begin() and before startRanging().
+    // If this function returns false an error entry will be stored in the lastError struct.
+    bool setXtalkCalibrationData(uint8_t *pData);
+
     // Gets I2C maximum packet size.
-    uint8_t getWireMaxPacketSize();
+    uint16_t getWireMaxPacketSize();
 
-    // Sets I2C maximum packet size.
-    void setWireMaxPacketSize(uint8_t newSize = I2C_BUFFER_SIZE);
+    // Sets I2C maximum packet size. Must not be more than the Wire buffer size.
+    void setWireMaxPacketSize(uint16_t newSize = I2C_BUFFER_SIZE);
 };
 #endif
\ No newline at end of file
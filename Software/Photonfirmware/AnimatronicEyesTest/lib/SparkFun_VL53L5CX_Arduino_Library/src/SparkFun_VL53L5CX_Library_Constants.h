@@ -47,6 +47,9 @@ enum class SF_VL53L5CX_ERROR_TYPE : uint8_t
     CANNOT_SET_TARGET_ORDER,
     CANNOT_GET_TARGET_ORDER,
     INVALID_TARGET_ORDER,
+    CANNOT_CALIBRATE_XTALK,
+    CANNOT_GET_XTALK_DATA,
+    CANNOT_SET_XTALK_DATA,
     UNKNOWN_ERROR
 };
 
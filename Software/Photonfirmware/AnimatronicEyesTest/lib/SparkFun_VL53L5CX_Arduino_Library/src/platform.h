@@ -76,6 +76,8 @@
  * layer.
  */
 
+class SparkFun_VL53L5CX_IO;
+
 typedef struct
 {
 	/* To be filled with customer's platform. At least an I2C address/descriptor
@@ -83,6 +85,9 @@ typedef struct
 	/* Example for most standard platform : I2C address of sensor */
     uint8_t	address;
 
+	/* I2C driver of the sensor that owns this platform, so several sensors can be used */
+    SparkFun_VL53L5CX_IO *p_i2c;
+
 } VL53L5CX_Platform;
 
 /*
@@ -92,7 +97,9 @@ typedef struct
  * zone means a lower RAM). The value must be between 1 and 4.
  */
 
+#ifndef VL53L5CX_NB_TARGET_PER_ZONE
 #define 	VL53L5CX_NB_TARGET_PER_ZONE		1U
+#endif
 
 /*
  * @brief The macro below can be used to avoid data conversion into the driver.
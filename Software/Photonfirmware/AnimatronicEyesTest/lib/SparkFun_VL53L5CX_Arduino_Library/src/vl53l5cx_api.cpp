@@ -223,10 +223,22 @@ uint8_t vl53l5cx_is_alive(VL53L5CX_Configuration *p_dev, uint8_t *p_is_alive)
 }
 
 uint8_t vl53l5cx_init(VL53L5CX_Configuration *p_dev)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
+	uint32_t offset = 0;
+
+	status |= vl53l5cx_init_reboot(p_dev);
+	status |= WaitMs(&(p_dev->platform), 100);
+	status |= vl53l5cx_init_wakeup(p_dev);
+	status |= vl53l5cx_init_download(p_dev, &offset, VL53L5CX_FIRMWARE_SIZE);
+	status |= vl53l5cx_init_finish(p_dev);
+
+	return status;
+}
+
+uint8_t vl53l5cx_init_reboot(VL53L5CX_Configuration *p_dev)
 {
 	uint8_t tmp, status = VL53L5CX_STATUS_OK;
-	uint8_t pipe_ctrl[] = {VL53L5CX_NB_TARGET_PER_ZONE, 0x00, 0x01, 0x00};
-	uint32_t single_range = 0x01;
 
 	p_dev->default_xtalk = (uint8_t *)VL53L5CX_DEFAULT_XTALK;
 	p_dev->default_configuration = (uint8_t *)VL53L5CX_DEFAULT_CONFIGURATION;
@@ -251,7 +263,13 @@ uint8_t vl53l5cx_init(VL53L5CX_Configuration *p_dev)
 
 	status |= WrByte(&(p_dev->platform), 0x000F, 0x40);
 	status |= WrByte(&(p_dev->platform), 0x000A, 0x01);
-	status |= WaitMs(&(p_dev->platform), 100);
+
+	return status;
+}
+
+uint8_t vl53l5cx_init_wakeup(VL53L5CX_Configuration *p_dev)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
 
 	/* Wait for sensor booted (several ms required to get sensor ready ) */
 	status |= WrByte(&(p_dev->platform), 0x7fff, 0x00);
@@ -292,14 +310,52 @@ uint8_t vl53l5cx_init(VL53L5CX_Configuration *p_dev)
 	status |= WrByte(&(p_dev->platform), 0x7fff, 0x01);
 	status |= WrByte(&(p_dev->platform), 0x0020, 0x07);
 	status |= WrByte(&(p_dev->platform), 0x0020, 0x06);
-	/* Download FW into VL53L5 */
-	status |= WrByte(&(p_dev->platform), 0x7fff, 0x09);
-	status |= WrMulti(&(p_dev->platform), 0, (uint8_t *) &VL53L5CX_FIRMWARE[0], 0x8000);
-	status |= WrByte(&(p_dev->platform), 0x7fff, 0x0a);
-	status |= WrMulti(&(p_dev->platform), 0, (uint8_t *) & VL53L5CX_FIRMWARE[0x8000], 0x8000);
-	status |= WrByte(&(p_dev->platform), 0x7fff, 0x0b);
-	status |= WrMulti(&(p_dev->platform), 0, (uint8_t *) & VL53L5CX_FIRMWARE[0x10000], 0x5000);
-	status |= WrByte(&(p_dev->platform), 0x7fff, 0x01);
+
+	return status;
+}
+
+uint8_t vl53l5cx_init_download(VL53L5CX_Configuration *p_dev, uint32_t *p_offset, uint32_t max_bytes)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
+	uint32_t page_offset, size;
+
+	/* Download FW into VL53L5, pages 0x09 to 0x0b of 0x8000 bytes each */
+	while ((max_bytes > (uint32_t)0) && (*p_offset < (uint32_t)VL53L5CX_FIRMWARE_SIZE))
+	{
+		page_offset = *p_offset % (uint32_t)0x8000;
+		size = (uint32_t)0x8000 - page_offset;
+		if (size > ((uint32_t)VL53L5CX_FIRMWARE_SIZE - *p_offset))
+		{
+			size = (uint32_t)VL53L5CX_FIRMWARE_SIZE - *p_offset;
+		}
+		if (size > max_bytes)
+		{
+			size = max_bytes;
+		}
+
+		status |= WrByte(&(p_dev->platform), 0x7fff, (uint8_t)(0x09 + (*p_offset / (uint32_t)0x8000)));
+		status |= WrMulti(&(p_dev->platform), (uint16_t)page_offset, (uint8_t *) &VL53L5CX_FIRMWARE[*p_offset], size);
+		if (status != (uint8_t)VL53L5CX_STATUS_OK)
+		{
+			return status;
+		}
+		*p_offset += size;
+		max_bytes -= size;
+	}
+
+	if (*p_offset >= (uint32_t)VL53L5CX_FIRMWARE_SIZE)
+	{
+		status |= WrByte(&(p_dev->platform), 0x7fff, 0x01);
+	}
+
+	return status;
+}
+
+uint8_t vl53l5cx_init_finish(VL53L5CX_Configuration *p_dev)
+{
+	uint8_t tmp, status = VL53L5CX_STATUS_OK;
+	uint8_t pipe_ctrl[] = {VL53L5CX_NB_TARGET_PER_ZONE, 0x00, 0x01, 0x00};
+	uint32_t single_range = 0x01;
 
 	/* Check if FW correctly downloaded */
 	status |= WrByte(&(p_dev->platform), 0x7fff, 0x02);
@@ -120,6 +120,13 @@
 #define VL53L5CX_POWER_MODE_SLEEP		((uint8_t) 0U)
 #define VL53L5CX_POWER_MODE_WAKEUP		((uint8_t) 1U)
 
+/**
+ * @brief Size in bytes of the firmware downloaded by vl53l5cx_init(), or in
+ * steps by vl53l5cx_init_download().
+ */
+
+#define VL53L5CX_FIRMWARE_SIZE			((uint32_t) 0x15000U)
+
 /**
  * @brief Macro VL53L5CX_STATUS_OK indicates that VL53L5 sensor has no error.
  * Macro VL53L5CX_STATUS_ERROR indicates that something is wrong (value,
@@ -422,6 +429,34 @@ uint8_t vl53l5cx_is_alive(
 uint8_t vl53l5cx_init(
 		VL53L5CX_Configuration		*p_dev);
 
+/**
+ * @brief The steps of vl53l5cx_init(), for a host that cannot wait for the
+ * whole of it. Call vl53l5cx_init_reboot(), wait at least 100 ms, call
+ * vl53l5cx_init_wakeup(), then vl53l5cx_init_download() until *p_offset
+ * reaches VL53L5CX_FIRMWARE_SIZE, then vl53l5cx_init_finish(). The bus must
+ * not be used for this sensor between the steps.
+ * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
+ * @param (uint32_t) *p_offset : Firmware bytes downloaded so far, start at 0.
+ * Updated by each call.
+ * @param (uint32_t) max_bytes : The most firmware bytes to download in this
+ * call.
+ * @return (uint8_t) status : 0 if the step is OK.
+ */
+
+uint8_t vl53l5cx_init_reboot(
+		VL53L5CX_Configuration		*p_dev);
+
+uint8_t vl53l5cx_init_wakeup(
+		VL53L5CX_Configuration		*p_dev);
+
+uint8_t vl53l5cx_init_download(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			*p_offset,
+		uint32_t			max_bytes);
+
+uint8_t vl53l5cx_init_finish(
+		VL53L5CX_Configuration		*p_dev);
+
 /**
  * @brief This function is used to change the I2C address of the sensor. If
  * multiple VL53L5 sensors are connected to the same I2C line, all other LPn
@@ -0,0 +1,322 @@
+/*
+  TPP_DeferredLogDecoder
+
+  Team Practical Project decoder for the deferred log of the animatronic eyes
+
+  Reads the USB serial port of the eyes after the "deferred log" cloud function
+  has been set to "binary", and prints each trace message to the console as the
+  Particle serial log would have, with the time it was logged. The formats come
+  from the records the eyes send before the first message of each call site (see
+  TPP_DeferredLog.h), so this sketch does not need to change when the firmware
+  does. The text log messages that share the port are printed as they are.
+
+  Change "COM21" below to the name of your serial port. The window shows the
+  messages decoded, the records rejected and the messages the eyes dropped.
+
+  Author: Bob Glicksman, Jim Schrempp
+  (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+  This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+import processing.serial.*;
+import java.util.HashMap;
+
+Serial port;
+
+// Binary records, see TPP_DeferredLog.h
+final int DEFERRED_LOG_SYNC = 0x4C44;
+final int DEFERRED_LOG_SITE = 1;
+final int DEFERRED_LOG_MESSAGE = 2;
+final int DEFERRED_LOG_DROPPED = 3;
+final int DEFERRED_ARG_INT = 0;
+final int DEFERRED_ARG_UINT = 1;
+final int DEFERRED_ARG_FLOAT = 2;
+final int DEFERRED_ARG_STRING = 3;
+final int MAX_RECORD_BYTES = 320;   // DEFERRED_LOG_SEND_BYTES
+
+class CallSite {
+  int level;
+  String format;
+  String category;
+}
+
+HashMap<Long, CallSite> sites = new HashMap<Long, CallSite>();
+byte[] rx = new byte[4096]; // bytes received that are not yet decoded
+int rxLength = 0;
+StringBuilder textLine = new StringBuilder(); // text log messages between the records
+int messagesDecoded = 0;
+int recordsRejected = 0;
+long messagesDropped = 0;
+
+void setup() {
+  size(400, 100);
+  port = new Serial(this, "COM21", 115200); // CHANGE COM21 TO YOUR SERIAL PORT
+}
+
+void draw() {
+  readRecords();
+  background(0);
+  fill(255);
+  text("decoded " + messagesDecoded + "   rejected " + recordsRejected + "   dropped by the eyes " + messagesDropped, 10, 50);
+}
+
+// Add the bytes that have arrived to rx and decode every whole record in it
+void readRecords() {
+
+  byte[] in = port.readBytes();
+  if (in == null) {
+    return;
+  }
+  if (rxLength + in.length > rx.length) {
+    rxLength = 0; // we fell behind; start over
+  }
+  System.arraycopy(in, 0, rx, rxLength, min(in.length, rx.length));
+  rxLength += min(in.length, rx.length);
+
+  int start = 0;
+  while (start < rxLength) {
+    int used = decodeRecord(start);
+    if (used == 0) {
+      break; // wait for the rest of the record
+    }
+    if (used > 0) {
+      start += used;
+    } else {
+      addText(rx[start]); // not a record here; it is part of a text log message
+      start++;
+    }
+  }
+  System.arraycopy(rx, start, rx, 0, rxLength - start);
+  rxLength -= start;
+}
+
+void addText(byte b) {
+  if (b == '\n') {
+    println(textLine.toString());
+    textLine.setLength(0);
+  } else if (b != '\r') {
+    textLine.append((char)(b & 0xFF));
+  }
+}
+
+// Decode the record at rx[start]. Returns the number of bytes used, 0 if the record
+// is not all here yet, or -1 if there is no good record at start.
+int decodeRecord(int start) {
+
+  if (rxLength - start < 2) {
+    return 0;
+  }
+  if (get16(start) != DEFERRED_LOG_SYNC) {
+    return -1;
+  }
+  int length = recordLength(start);
+  if (length <= 0) {
+    return length;
+  }
+  if (crc16(start, length - 2) != get16(start + length - 2)) {
+    recordsRejected++;
+    return -1;
+  }
+
+  int type = rx[start + 2] & 0xFF;
+  int p = start + 4;
+  if (type == DEFERRED_LOG_SITE) {
+    CallSite site = new CallSite();
+    site.level = rx[start + 3] & 0xFF;
+    long address = get32(p);
+    int formatLength = rx[p + 4] & 0xFF;
+    int categoryLength = rx[p + 5] & 0xFF;
+    site.format = new String(rx, p + 6, formatLength);
+    site.category = new String(rx, p + 6 + formatLength, categoryLength);
+    sites.put(address, site);
+  } else if (type == DEFERRED_LOG_MESSAGE) {
+    printMessage(start);
+  } else if (type == DEFERRED_LOG_DROPPED) {
+    messagesDropped += get32(p);
+    println("[deferred log] " + get32(p) + " messages dropped, the ring was full");
+  }
+  return length;
+}
+
+// the length of the record at rx[start] with its CRC, 0 if more bytes are
+// needed to tell, or -1 if it cannot be a record
+int recordLength(int start) {
+
+  int available = rxLength - start;
+  if (available < 4) {
+    return 0;
+  }
+  int type = rx[start + 2] & 0xFF;
+  int length;
+  if (type == DEFERRED_LOG_SITE) {
+    if (available < 10) {
+      return 0;
+    }
+    length = 10 + (rx[start + 8] & 0xFF) + (rx[start + 9] & 0xFF) + 2;
+  } else if (type == DEFERRED_LOG_MESSAGE) {
+    int numArgs = rx[start + 3] & 0xFF;
+    if (numArgs > 10) {
+      return -1;
+    }
+    length = 12;
+    for (int i = 0; i < numArgs; i++) {
+      if (available < length + 2) {
+        return 0;
+      }
+      int argType = rx[start + length] & 0xFF;
+      length += (argType == DEFERRED_ARG_STRING) ? 2 + (rx[start + length + 1] & 0xFF) : 5;
+    }
+    length += 2;
+  } else if (type == DEFERRED_LOG_DROPPED) {
+    length = 10;
+  } else {
+    return -1;
+  }
+  if (length > MAX_RECORD_BYTES) {
+    return -1;
+  }
+  return (available < length) ? 0 : length;
+}
+
+// print the message record at rx[start] the way the Particle serial log does
+void printMessage(int start) {
+
+  int numArgs = rx[start + 3] & 0xFF;
+  long address = get32(start + 4);
+  long timeMS = get32(start + 8);
+  CallSite site = sites.get(address);
+  if (site == null) {
+    println(String.format("%010d [deferred log] no format for call site %08x", timeMS, address));
+    return;
+  }
+
+  int[] argTypes = new int[numArgs];
+  Object[] args = new Object[numArgs];
+  int p = start + 12;
+  for (int i = 0; i < numArgs; i++) {
+    argTypes[i] = rx[p] & 0xFF;
+    if (argTypes[i] == DEFERRED_ARG_STRING) {
+      int stringLength = rx[p + 1] & 0xFF;
+      args[i] = new String(rx, p + 2, stringLength);
+      p += 2 + stringLength;
+    } else {
+      long value = get32(p + 1);
+      if (argTypes[i] == DEFERRED_ARG_FLOAT) {
+        args[i] = Float.intBitsToFloat((int)value);
+      } else if (argTypes[i] == DEFERRED_ARG_INT) {
+        args[i] = (long)(int)value;
+      } else {
+        args[i] = value;
+      }
+      p += 5;
+    }
+  }
+
+  println(String.format("%010d [%s] %s: %s", timeMS, site.category, levelName(site.level),
+    formatMessage(site.format, argTypes, args)));
+  messagesDecoded++;
+}
+
+// Formats a message like formatDeferredLog() in TPP_DeferredLog.cpp: each C
+// conversion is rewritten for String.format and given its argument
+String formatMessage(String format, int[] argTypes, Object[] args) {
+
+  StringBuilder out = new StringBuilder();
+  int arg = 0;
+  int i = 0;
+  while (i < format.length()) {
+    char c = format.charAt(i);
+    if ((c != '%') || ((i + 1 < format.length()) && (format.charAt(i + 1) == '%'))) {
+      out.append(c);
+      i += (c == '%') ? 2 : 1;
+      continue;
+    }
+
+    // the flags, width and precision; the length modifiers are dropped
+    int specStart = i++;
+    while ((i < format.length()) && ("-+ #0123456789.".indexOf(format.charAt(i)) >= 0)) {
+      i++;
+    }
+    String spec = format.substring(specStart, i);
+    while ((i < format.length()) && ("hlLjzt".indexOf(format.charAt(i)) >= 0)) {
+      i++;
+    }
+    if (i >= format.length()) {
+      break;
+    }
+    char conversion = format.charAt(i++);
+    if (arg >= args.length) {
+      out.append('?');
+      continue;
+    }
+    Object value = args[arg];
+    int type = argTypes[arg];
+    arg++;
+
+    long asLong = (type == DEFERRED_ARG_FLOAT) ? (long)(float)(Float)value
+                : (type == DEFERRED_ARG_STRING) ? 0 : (Long)value;
+    String noPrecision = spec.replaceAll("\\.[0-9]*", "");
+    try {
+      switch (conversion) {
+        case 'd': case 'i':
+          out.append(String.format(noPrecision + "d", asLong));
+          break;
+        case 'u':
+          out.append(String.format(noPrecision + "d", asLong & 0xFFFFFFFFL));
+          break;
+        case 'x': case 'X': case 'o':
+          out.append(String.format(noPrecision + conversion, asLong & 0xFFFFFFFFL));
+          break;
+        case 'c':
+          out.append((char)asLong);
+          break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+          double asDouble = (type == DEFERRED_ARG_FLOAT) ? (double)(Float)value : (double)asLong;
+          out.append(String.format(spec + Character.toLowerCase(conversion), asDouble));
+          break;
+        case 's':
+          out.append(String.format(spec + "s", (type == DEFERRED_ARG_STRING) ? value : "?"));
+          break;
+        default:
+          out.append('?');
+          break;
+      }
+    } catch (java.util.IllegalFormatException e) {
+      out.append('?');
+    }
+  }
+  return out.toString();
+}
+
+String levelName(int level) {
+  if (level >= 50) {
+    return "ERROR";
+  } else if (level >= 40) {
+    return "WARN";
+  } else if (level >= 30) {
+    return "INFO";
+  }
+  return "TRACE";
+}
+
+int get16(int index) {
+  return (rx[index] & 0xFF) | ((rx[index + 1] & 0xFF) << 8);
+}
+
+long get32(int index) {
+  return get16(index) | ((long)get16(index + 2) << 16);
+}
+
+// CRC-16/CCITT, polynomial 0x1021, start 0xFFFF, as in TPP_TOFFrame.cpp
+int crc16(int start, int length) {
+  int crc = 0xFFFF;
+  for (int i = start; i < start + length; i++) {
+    crc ^= (rx[i] & 0xFF) << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = ((crc & 0x8000) != 0) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+      crc &= 0xFFFF;
+    }
+  }
+  return crc;
+}
@@ -29,6 +29,7 @@
 
 #include "Adafruit_PWMServoDriver.h"
 #include <Wire.h>
+#include <TPP_Profiler.h>
 
 //#define ENABLE_DEBUG_OUTPUT
 
@@ -100,7 +101,13 @@ void Adafruit_PWMServoDriver::sleep() {
 void Adafruit_PWMServoDriver::wakeup() {
   uint8_t sleep = read8(PCA9685_MODE1);
   uint8_t wakeup = sleep & ~MODE1_SLEEP; // set sleep bit low
-  write8(PCA9685_MODE1, wakeup);
+  write8(PCA9685_MODE1, wakeup & ~MODE1_RESTART);
+  // the outputs that were on when it went to sleep start again once the
+  // oscillator has settled and RESTART is written with a 1 (datasheet 7.3.1.1)
+  if (sleep & MODE1_RESTART) {
+    delayMicroseconds(500);
+    write8(PCA9685_MODE1, wakeup | MODE1_RESTART);
+  }
 }
 
 /*!
@@ -209,8 +216,11 @@ uint8_t Adafruit_PWMServoDriver::readPrescale(void) {
  *  @return requested PWM output value
  */
 uint8_t Adafruit_PWMServoDriver::getPWM(uint8_t num) {
+  _i2c->lock();
   _i2c->requestFrom((int)_i2caddr, PCA9685_LED0_ON_L + 4 * num, (int)4);
-  return _i2c->read();
+  uint8_t value = _i2c->read();
+  _i2c->unlock();
+  return value;
 }
 
 /*!
@@ -229,6 +239,8 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   Serial.println(off);
 #endif
 
+  PROFILE_SECTION(PROFILE_PWM);
+  _i2c->lock();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(PCA9685_LED0_ON_L + 4 * num);
   _i2c->write(on);
@@ -236,6 +248,7 @@ void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
   _i2c->write(off);
   _i2c->write(off >> 8);
   _i2c->endTransmission();
+  _i2c->unlock();
 }
 
 /*!
@@ -343,18 +356,25 @@ void Adafruit_PWMServoDriver::setOscillatorFrequency(uint32_t freq) {
 }
 
 /******************* Low level I2C interface */
+// Each transaction holds the Wire lock; the TOF sensor is read from its own
+// thread on the same bus.
 uint8_t Adafruit_PWMServoDriver::read8(uint8_t addr) {
+  _i2c->lock();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
   _i2c->endTransmission();
 
   _i2c->requestFrom((uint8_t)_i2caddr, (uint8_t)1);
-  return _i2c->read();
+  uint8_t value = _i2c->read();
+  _i2c->unlock();
+  return value;
 }
 
 void Adafruit_PWMServoDriver::write8(uint8_t addr, uint8_t d) {
+  _i2c->lock();
   _i2c->beginTransmission(_i2caddr);
   _i2c->write(addr);
   _i2c->write(d);
   _i2c->endTransmission();
+  _i2c->unlock();
 }
\ No newline at end of file
@@ -14,6 +14,43 @@
  * (cc) Share Alike - Non Commercial - Attibution
  * 2022 Bob Glicksman and Jim Schrempp
  * 
+ * v2.5 idle power: after IDLE_POWER_AFTER_MINUTES with no one seen the TOF ranges slower, the
+ *      servo driver sleeps with the lids closed and loop() sleeps until the next TOF result or
+ *      task; the first hit brings back the full rate. Cloud function "idle power" sets the minutes
+ * v2.4 TOF events go to the mouth over a wired I2C link (TPP_EventLink.h), with the cloud
+ *      as the fallback; cloud function "mouth link" tests it, logs it and turns the cloud mirror on
+ *      events published faster than once a second wait in TPP_PublishQueue instead of being
+ *      dropped; a newer event replaces a waiting one of the same name
+ *      the running loop allocates no memory (no String in the event path; the host test
+ *      test/test_no_alloc.cpp enforces it); the free memory is checked every 10 s for leaks
+ *      trace messages of the servo, animation and TOF code are deferred (TPP_DeferredLog.h) and
+ *      formatted when loop() is idle; cloud function "deferred log" binary streams them raw
+ *      to the Processing TPP_DeferredLogDecoder instead
+ * v2.3 loop() runs its work as tasks of TPP_Scheduler; cloud function "scheduler stats" logs their times
+ *      the kill button and the trigger pin are debounced
+ *      opt-in profiler (TPP_PROFILE in TPP_Profiler.h) times the TOF, animation, servo writes,
+ *      logging and publish; "p" on the USB serial port prints it
+ * v2.2 TOF sensors are read in their own thread (TPP_TOFThread); loop() only takes the results
+ *      while a person is followed only the TOF zones around them are learned and tracked (ROI mode)
+ *      a TOF frame that has not changed since the last empty one is not processed again
+ *      cloud function "tof confidence" on detects a sure hit in one frame instead of two
+ *      TOF can use the nearest of several targets per zone (VL53L5CX_NB_TARGET_PER_ZONE)
+ *      TOF zone search is compiled for 4x4 and 8x8; "tof recorder" replay compares it with the generic one
+ *      cloud function "tof xtalk" calibrate measures the cover glass crosstalk once; it is applied at each boot
+ *      a TOF sensor that stops working is re-initialised on its own; the eyes roam meanwhile
+ * v2.1 eyes follow the sub-zone centroid of the target instead of jumping zone to zone
+ *      eyes stay on the same person while they are tracked, and follow the predicted
+ *      position between frames. The TOF is read once per sample instead of twice.
+ *      gaze target is smoothed with an adaptive (One Euro) filter to cut retargets
+ *      several TOF sensors can be fused into one wide field of view, see TOF_SENSORS
+ *      TOF frames can be recorded and replayed with cloud function "tof recorder"
+ *      "tof recorder" serial streams binary frames to the Processing depth map viewer
+ *      TOF calibration is stored in EEPROM and reused at boot when the scene matches,
+ *      cloud function "tof forget calibration" forces a new one at the next boot
+ *      TOF background adapts to changes in the scene, so moved furniture stops being seen
+ *      faster TOF sensor init with larger I2C transfers; init time of each phase is logged
+ *      TOF sensors come up a step at a time from loop() while the start up sequence runs;
+ *      a missing sensor no longer freezes the eyes
  *      Now using mouth state machine as the default algorithm
  * v2.0 added second speak function, invoked by cloud function "event algorithm" set to 2
  *      faster eyes sample rate from 25ms to 10ms
@@ -44,10 +81,18 @@
 #include <TPPAnimationList.h>
 #include <TPPAnimatePuppet.h>
 #include <eyeservosettings.h>
-#include <TPP_TOF.h>
+#include <TPP_TOFArray.h>
+#include <TPP_GazeFilter.h>
+#include <TPP_TOFRecorder.h>
+#include <TPP_TOFThread.h>
+#include <TPP_Scheduler.h>
+#include <TPP_Profiler.h>
+#include <TPP_EventLink.h>
+#include <TPP_PublishQueue.h>
+#include <TPP_DeferredLog.h>
 #include <TPP_Animatronic_Global.h>
 
-const String version = "2.0";
+const String version = "2.5";
 
 //SYSTEM_MODE(MANUAL);
 SYSTEM_THREAD(ENABLED);  // added this in an attempt to get the software timer to work. didn't help
@@ -56,7 +101,25 @@ SYSTEM_THREAD(ENABLED);  // added this in an attempt to get the software timer t
 #define TOF_USE 1
 //#define VERIFY_CALIBRATION_ONLY 0
 
-TPP_TOF theTOF;
+TPP_TOFArray theTOF;
+TPP_GazeFilter gazeFilter;
+TPP_TOFRecorder tofRecorder;   // see the "tof recorder" cloud function
+TPP_TOFThread tofThread;       // reads theTOF; loop() takes its results
+TPP_Scheduler scheduler;       // runs the work of loop() when it is due
+TPP_EventLinkSender mouthLink; // sends the TOF events to the mouth over I2C
+bool mirrorEventsToCloud = false;   // also publish the events the link sends, to watch them in the console
+TPP_PublishQueue publishQueue; // events wait here for their turn to be published
+int publishTask = -1;          // the scheduler task that publishes them
+const unsigned long IDLE_POWER_AFTER_MINUTES = 10;  // no one seen for this long: save power, 0 for never
+bool idlePower = false;        // the room has been empty for a while, see enterIdlePower()
+bool idleLidsClosing = false;  // enterIdlePower() has closed the lids
+unsigned long idlePowerAfterMS = IDLE_POWER_AFTER_MINUTES * 60000UL;  // see the "idle power" cloud function
+
+// publish priorities, most important first
+enum {
+    PUBLISH_PRIORITY_MOUTH,     // the mouth acts on these
+    PUBLISH_PRIORITY_STATUS     // for people watching the console
+};
 
 #define DEBUGON
 #define TRIGGER_PIN A5
@@ -65,17 +128,43 @@ TPP_TOF theTOF;
 const long IDLE_SEQUENCE_MIN_WAIT_MS = 10000; //30 sec // during idle times, random activity will happen longer than this
 const long TOF_SAMPLE_TIME = 10;   // the TOF only updated 10x/sec, so don't need to upload the TOF data very often
 
+// Time of flight sensors, in the order of increasing x (see TPP_TOFArray.h).
+// With more than one sensor, each needs its own address and all but the
+// first need their LPn pin wired to a GPIO.
+const tofSensorConfig TOF_SENSORS[] = {
+    { TOF_DEFAULT_ADDRESS, -1 }
+//  ,{ 0x2A, D2 }
+};
+#define NUM_TOF_SENSORS (sizeof(TOF_SENSORS) / sizeof(TOF_SENSORS[0]))
+
+// smoothing of the gaze target, see TPP_GazeFilter.h
+const gazeFilterConfig GAZE_FILTER_CONFIG = {
+    500,                    // minCutoffMilliHz: 0.5 Hz when the person is standing still
+    2000,                   // betaMilliHz: 2 Hz more for each zone per second of movement
+    1000,                   // derivCutoffMilliHz
+    POI_FRACTION_ONE / 16   // deadbandFine: about 1% of the eye travel
+};
+
+#if defined(TPP_PROFILE) && defined(PARTICLE)
+typedef TPP_ProfiledSerialLogHandler mainLogHandler;    // times each message
+#else
+typedef SerialLogHandler mainLogHandler;
+#endif
+
 #ifdef DEBUGON
-    SerialLogHandler logHandler1(LOG_LEVEL_INFO, {  // Logging level for non-application messages LOG_LEVEL_ALL or _INFO
+    mainLogHandler logHandler1(LOG_LEVEL_INFO, {  // Logging level for non-application messages LOG_LEVEL_ALL or _INFO
         { "app.main", LOG_LEVEL_ALL }               // Logging for main loop
         ,{ "app.puppet", LOG_LEVEL_WARN }               // Logging for Animate puppet methods
         ,{ "app.anilist", LOG_LEVEL_ERROR }               // Logging for Animation List methods
         ,{ "app.aniservo", LOG_LEVEL_INFO }          // Logging for Animate Servo details
         ,{"comm", LOG_LEVEL_ERROR}         // particle communication system 
         ,{"app.TOF", LOG_LEVEL_WARN}
+        ,{"app.TOF.recorder", LOG_LEVEL_INFO}
+        ,{"app.TOF.init", LOG_LEVEL_INFO}
+        ,{"app.scheduler", LOG_LEVEL_INFO}
     });
 #else
-    SerialLogHandler logHandler1(LOG_LEVEL_ERROR, {  // Logging level for non-application messages LOG_LEVEL_ALL or _INFO
+    mainLogHandler logHandler1(LOG_LEVEL_ERROR, {  // Logging level for non-application messages LOG_LEVEL_ALL or _INFO
         { "app.main", LOG_LEVEL_ERROR }               // Logging for main loop
         ,{ "app.puppet", LOG_LEVEL_ERROR }               // Logging for Animate puppet methods
         ,{ "app.anilist", LOG_LEVEL_ERROR }               // Logging for Animation List methods
@@ -83,6 +172,8 @@ const long TOF_SAMPLE_TIME = 10;   // the TOF only updated 10x/sec, so don't nee
         ,{"comm.protocol", LOG_LEVEL_WARN}          // particle communication system 
         ,{"comm.dtls", LOG_LEVEL_ERROR}          // particle communication system 
         ,{"app.TOF", LOG_LEVEL_TRACE}
+        ,{"app.TOF.recorder", LOG_LEVEL_INFO}
+        ,{"app.TOF.init", LOG_LEVEL_INFO}
         
     });
 #endif
@@ -180,7 +271,7 @@ void processEventsStateMachine(bool hasDetection, int distanceMM) {
         hs_person_left = 4
     };
     static headStates currentState = hs_idle;
-    String headStatesStrings[4] = {"Idle","Normal","Too Close","Person left"};
+    static const char *const headStatesStrings[4] = {"Idle","Normal","Too Close","Person left"};
 
     // local constants
     const long TOO_CLOSE_MM = 254;  // object is too close if < 254 mm = 10"
@@ -300,16 +391,15 @@ void processEventsStateMachine(bool hasDetection, int distanceMM) {
     
     // send event to the mouth
     if (speakThisEvent != No_event) {
-        String eventTypeAsString = String(speakThisEvent);
-        publishEvent("TOF_event", eventTypeAsString); 
-        mainLog.trace("Event sent: " + eventTypeAsString);
+        sendEventToMouth(speakThisEvent);
+        mainLog.trace("Event sent: %d", speakThisEvent);
     }
 
     // logging
     static headStates lastLoggedState;
     if (lastLoggedState != currentState) {
         lastLoggedState = currentState;
-        mainLog.trace("HeadState: " + headStatesStrings[currentState-1]);
+        mainLog.trace("HeadState: %s", headStatesStrings[currentState-1]);
     }
 
     return;
@@ -354,16 +444,29 @@ void animationTimerCallback() {
     }
 }
 
-void publishEvent(String eventName, String eventData) {
-
-    static unsigned long lastPublishedMS = 0;
-    if (millis() - lastPublishedMS > 1000) {
-        Particle.publish(eventName, eventData);
-        lastPublishedMS = millis();
-    } else {
-        mainLog.error("Publication suppressed, too fast: " + eventName + "/" + eventData );
+//------- sendEventToMouth --------
+// over the wired link while the mouth answers on it; through the cloud when it
+// does not, and also when mirroring
+void sendEventToMouth(TOF_detect event) {
+    bool sentOnLink = mouthLink.send((uint8_t)event);
+    if (!sentOnLink || mirrorEventsToCloud) {
+        publishEventForMouth(event);
     }
+}
 
+//------- publishEventForMouth --------
+void publishEventForMouth(TOF_detect event) {
+    char eventData[4];
+    snprintf(eventData, sizeof(eventData), "%d", (int)event);
+    publishEvent("TOF_event", eventData, PUBLISH_PRIORITY_MOUTH);
+}
+
+//------- publishEvent --------
+// queue an event for the cloud. The publish task sends them at the rate the
+// cloud allows, the most important first; see TPP_PublishQueue.h
+void publishEvent(const char *eventName, const char *eventData, int priority) {
+    publishQueue.add(eventName, eventData, priority);
+    scheduler.runIn(publishTask, publishQueue.msUntilNext());
 }
 
 
@@ -374,6 +477,123 @@ int restartDevice(String extra) {
 }
 
 
+// Cloud function to record TOF frames, see TPP_TOFRecorder.h
+//   "serial"   stream frames to the USB serial port, for the depth map viewer
+//   "ram"      record frames to RAM until the buffer is full
+//   "off"      stop recording
+//   "replay"   replay the RAM recording of sensor 0, or "replay n" for sensor n
+int tofRecorderCommand(String command) {
+
+    if (command == "serial") {
+        tofRecorder.setMode(RECORD_SERIAL);
+    } else if (command == "ram") {
+        tofRecorder.setMode(RECORD_RAM);
+    } else if (command == "off") {
+        tofRecorder.setMode(RECORD_OFF);
+        mainLog.info("recorded %d frames, %d bytes, %d dropped", tofRecorder.getFramesRecorded(),
+            tofRecorder.getBytesUsed(), tofRecorder.getFramesDropped());
+    } else if (command.startsWith("replay")) {
+        return tofRecorder.replay(command.substring(6).toInt()) ? 0 : -1;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Cloud function to make the TOF sensors calibrate from the scene at the next
+// boot instead of using the calibration stored in EEPROM. Use after moving the head.
+int tofForgetCalibration(String extra) {
+    theTOF.forgetCalibration();
+    return 0;
+}
+
+// Cloud function to weigh TOF zones by how sure the sensor is of them, see
+// TPP_TOF::setConfidenceMode. "on" or "off"
+int tofConfidence(String command) {
+    if (command == "on") {
+        theTOF.setConfidenceMode(true);
+    } else if (command == "off") {
+        theTOF.setConfidenceMode(false);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Cloud function for the crosstalk calibration of a cover glass over the TOF sensors.
+// "calibrate" with a grey card TOF_XTALK_DISTANCE_MM in front of the head; it is kept
+// in EEPROM and used at every boot. "forget" goes back to the default at the next boot.
+int tofXtalk(String command) {
+    if (command == "calibrate") {
+        theTOF.calibrateXtalk();
+    } else if (command == "forget") {
+        theTOF.forgetXtalkCalibration();
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Cloud function for the wired link to the mouth, see TPP_EventLink.h
+//   "test"         run the protocol in loopback, without the mouth; returns 1 if it passed
+//   "stats"        log how the link is doing
+//   "mirror on"    also publish the events sent over the link to the cloud
+//   "mirror off"
+int mouthLinkCommand(String command) {
+    if (command == "test") {
+        return eventLinkLoopbackTest() ? 1 : -1;
+    } else if (command == "stats") {
+        mouthLink.logStats();
+        publishQueue.logStats();
+    } else if (command == "mirror on") {
+        mirrorEventsToCloud = true;
+    } else if (command == "mirror off") {
+        mirrorEventsToCloud = false;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Cloud function for the deferred trace messages, see TPP_DeferredLog.h
+//   "text"     format them on the Photon and log them with the rest; the default
+//   "binary"   write them raw to the USB serial port, for TPP_DeferredLogDecoder
+int deferredLogCommand(String command) {
+    if (command == "text") {
+        deferredLog.setMode(DEFERRED_LOG_TEXT);
+    } else if (command == "binary") {
+        deferredLog.setMode(DEFERRED_LOG_BINARY);
+    } else {
+        return -1;
+    }
+    mainLog.info("deferred log messages dropped so far %lu", deferredLog.getDropped());
+    return 0;
+}
+
+#ifdef TOF_USE
+// Cloud function for idle power mode: the minutes with no one seen before it
+// starts, 0 for never. Leaves it if it is on.
+int idlePowerCommand(String command) {
+    if ((command.length() == 0) || !isdigit(command.charAt(0))) {
+        return -1;
+    }
+    idlePowerAfterMS = command.toInt() * 60000UL;
+    if (idlePower) {
+        leaveIdlePower();
+    } else {
+        armIdlePower();
+    }
+    return 0;
+}
+#endif
+
+// Cloud function to log how often each task of loop() ran and how long it took
+int schedulerStats(String extra) {
+    scheduler.logStats();
+    return 0;
+}
+
+
 //------ setup -----------
 void setup() {
 
@@ -383,6 +603,16 @@ void setup() {
     pinMode(D7, OUTPUT);
 
     Particle.function("restart device", restartDevice);
+    Particle.function("tof recorder", tofRecorderCommand);
+    Particle.function("tof forget calibration", tofForgetCalibration);
+    Particle.function("tof confidence", tofConfidence);
+    Particle.function("tof xtalk", tofXtalk);
+    Particle.function("scheduler stats", schedulerStats);
+    Particle.function("mouth link", mouthLinkCommand);
+    Particle.function("deferred log", deferredLogCommand);
+#ifdef TOF_USE
+    Particle.function("idle power", idlePowerCommand);
+#endif
 
     delay(1000);
     mainLog.info("===========================================");
@@ -420,8 +650,12 @@ void setup() {
     // Time of Flight Sensor set up
     Wire.begin(); //This resets to 100kHz I2C
     Wire.setClock(400000); //Sensor has max I2C freq of 400kHz 
+    mouthLink.begin();
     
-    theTOF.initTOF();
+    theTOF.initTOFs(TOF_SENSORS, NUM_TOF_SENSORS);
+    gazeFilter.init(GAZE_FILTER_CONFIG);
+    theTOF.setRecorder(&tofRecorder);
+    tofThread.start(&theTOF);   // brings up the sensors, then reads them
 
     sequenceCalibrationConfirmation();
     animation1.startRunning();
@@ -433,75 +667,148 @@ void setup() {
 
 #endif
 
+    addStartupTasks();
 
     
 }
 
-//------- MAIN LOOP --------------
-void loop() {
-
-    static bool firstLoop = true;
-    static bool startingUp = true;
-
-    if (firstLoop){
-
-        firstLoop = false;
-        mainLog.info("first time in main loop");
-
+//------- scheduled tasks --------------
+// loop() runs these through the scheduler when they are due, see TPP_Scheduler.h
+
+const unsigned long EYES_SLEEP_MS = 2000;   // close the eyes when no one has been seen for this long
+const unsigned long INPUT_SAMPLE_MS = 20;   // an input change counts once two samples agree
+const unsigned long IDLE_CHECK_MS = 100;    // how often to consider an idle sequence
+const unsigned long MOUTH_LINK_MS = 5;      // how often to send to the mouth; an event waits at most this long
+const unsigned long HEAP_CHECK_MS = 10000;  // how often to look at the free memory
+const unsigned long DEFERRED_LOG_MS = 5;    // how often to drain the deferred log
+const unsigned long IDLE_POWER_TASK_MS = 50;    // how often the faster periodic tasks run meanwhile
+const unsigned long IDLE_POWER_RETRY_MS = 1000; // the eyes are still moving; try again after this
+const uint32_t HEAP_CHECK_MARGIN_BYTES = 512;   // the system and the cloud come and go by about this much
+
+// most important first
+enum {
+    TASK_PRIORITY_SERVO,
+    TASK_PRIORITY_TOF,
+    TASK_PRIORITY_MOUTH_LINK,
+    TASK_PRIORITY_INPUT,
+    TASK_PRIORITY_EYES,
+    TASK_PRIORITY_IDLE,
+    TASK_PRIORITY_PUBLISH,
+    TASK_PRIORITY_RECORDER
+};
+
+int eyesSleepTask = -1;
+int servoTaskNumber = -1;
+int tofTaskNumber = -1;
+int idlePowerTask = -1;
+
+// the periodic tasks that run every IDLE_POWER_TASK_MS in idle power mode, and their own periods
+#define MAX_IDLE_SLOWED_TASKS 6
+int idleSlowedTasks[MAX_IDLE_SLOWED_TASKS];
+unsigned long idleSlowedPeriodsMS[MAX_IDLE_SLOWED_TASKS];
+int numIdleSlowedTasks = 0;
+
+//------- addPeriodicSlowedWhenIdle --------
+// scheduler.addPeriodic() for a task that need not run often while the room is empty
+int addPeriodicSlowedWhenIdle(const char *name, schedulerTaskFunction pFunction, unsigned long periodMS,
+        int priority, unsigned long budgetUS) {
+    int task = scheduler.addPeriodic(name, pFunction, periodMS, priority, budgetUS);
+    if ((task >= 0) && (numIdleSlowedTasks < MAX_IDLE_SLOWED_TASKS)) {
+        idleSlowedTasks[numIdleSlowedTasks] = task;
+        idleSlowedPeriodsMS[numIdleSlowedTasks] = periodMS;
+        numIdleSlowedTasks++;
     }
+    return task;
+}
 
-    // this is called every time to make the animation run
+//------- servoTask --------
+// move the servos a step towards their scenes
+void servoTask() {
     animationTimerCallback();
+}
 
-    if (startingUp) {
-        // keep coming here until start up sequence is done
-        if (!animation1.isRunning()) {
-            startingUp = false;
-            mainLog.info("finished start up sequence");
-        }
-        return;
+//------- publishNextEvent --------
+// one-shot task: publish the next queued event, and come back when the one after it may go
+void publishNextEvent() {
+
+    queuedEvent event;
+    if (publishQueue.take(&event)) {
+        PROFILE_SECTION(PROFILE_PUBLISH);
+        Particle.publish(event.name, event.data);
+    }
+    if (!publishQueue.isEmpty()) {
+        scheduler.runIn(publishTask, publishQueue.msUntilNext());
     }
+}
 
+//------- tofRecorderTask --------
+// stream recorded TOF frames without waiting on the serial port
+void tofRecorderTask() {
+    tofRecorder.process();
+}
+
+//------- deferredLogTask --------
+// format or send the trace messages the other tasks left in the deferred log
+void deferredLogTask() {
+    deferredLog.process();
+}
 
 #ifdef TOF_USE
-    //int32_t smallestValue; 
-    int32_t focusX = -255;  //sensor coordinates
-    int32_t focusY = -255;
-    static int32_t xPos = -1;
-    static int32_t yPos = -1;
-    static long lastEyeUpdateMS = 0;
 
-    //decide where to point the eyes
-    if ( (millis() - lastEyeUpdateMS) > TOF_SAMPLE_TIME){    // XXX made this longer than 1 ms
+//------- tofTask --------
+// take the next result of the TOF thread, tell the mouth about people coming and going,
+// and point the eyes at the person we are looking at
+void tofTask() {
 
-        // this is called every time to allow TOF to make measurements
-        pointOfInterest thisPOITF;
+    static int32_t xPos = -1;
+    static int32_t yPos = -1;
+    static bool haveTarget = false;
+    static bool hadTarget = false;
 
-        //theTOF.getPOI(&thisPOI);
-        theTOF.getPOITemporalFiltered(&thisPOITF);
+    // the TOF thread queues a result for each frame
+    pointOfInterest thisPOITF;
+    tofThread.getPOI(&thisPOITF);
 
-        if (thisPOITF.gotNewSensorData) {
-           
-            // consider running the mouth
-            processEventsStateMachine(thisPOITF.hasDetection, thisPOITF.distanceMM);
-            
-        }
+    // a sensor that saw someone has gone back to the full rate on its own
+    if (idlePower && (!theTOF.isIdleRate() || theTOF.isRecovering())) {
+        leaveIdlePower();
+    }
 
+    if (thisPOITF.gotNewSensorData) {
+       
+        // consider running the mouth
+        processEventsStateMachine(thisPOITF.hasDetection, thisPOITF.distanceMM);
+        haveTarget = thisPOITF.hasDetection;
+        
+    }
 
-        // get POI data without temporal filtering
-        pointOfInterest thisPOI;
-        theTOF.getPOI(&thisPOI);
+    // Look at the person we are tracking. Between frames the tracker predicts
+    // where they have moved to, so the eyes do not lag a frame behind.
+    int gazeXFine = 0;
+    int gazeYFine = 0;
+    bool haveGaze = haveTarget && tofThread.predictFocus(millis(), &gazeXFine, &gazeYFine);
+    if (!haveGaze && thisPOITF.hasDetection) {
+        // the tracker had no room for this person
+        gazeXFine = thisPOITF.xFine;
+        gazeYFine = thisPOITF.yFine;
+        haveGaze = true;
+    }
 
-        // do we have a focus point?
-        if (thisPOI.hasDetection) {
+    // do we have a focus point?
+    if (haveGaze) {
 
-            focusX = thisPOI.x;
-            focusY = thisPOI.y;
+        scheduler.runIn(eyesSleepTask, EYES_SLEEP_MS);
+        armIdlePower();
 
-            lastEyeUpdateMS = millis();
+        // smooth out the jitter; only retarget the eyes for a worthwhile move
+        int smoothXFine = 0;
+        int smoothYFine = 0;
+        if (gazeFilter.update(gazeXFine, gazeYFine, millis(), &smoothXFine, &smoothYFine)) {
 
-            int xPosNew = map(focusX,0,7, 0,100);   
-            int yPosNew = map(focusY,0,7, 100,0);
+            // use the sub-zone centroid so the eyes move continuously rather than
+            // in 8 steps across the field of view
+            int xPosNew = map(smoothXFine,0,(theTOF.getPanoramaWidth() - 1) * POI_FRACTION_ONE, 0,100);   
+            int yPosNew = map(smoothYFine,0,(theTOF.getPanoramaHeight() - 1) * POI_FRACTION_ONE, 100,0);
             
             // has the focus changed?
             if ((xPosNew != xPos) || (yPosNew != yPos)) {
@@ -509,7 +816,7 @@ void loop() {
                 xPos = xPosNew;
                 yPos = yPosNew;
 
-                //mainLog.info("New position: x: %d, y: %d",focusX,focusY);
+                //mainLog.info("New position: x: %d, y: %d",xPos,yPos);
 
                 animation1.stopRunning();
                 animation1.clearSceneList();
@@ -520,36 +827,140 @@ void loop() {
                 //now let the animation run
                 animation1.startRunning();
             }
-        } 
+        }
+    } else if (haveTarget != hadTarget) {
+        // we lost the person; the next person starts a fresh filter
+        gazeFilter.reset();
+        mainLog.info("gaze retargets: %lu suppressed: %lu", 
+            gazeFilter.getRetargets(), gazeFilter.getSuppressedRetargets());
     }
+    hadTarget = haveTarget;
 
-    // If the POI has not changed, then go to sleep
-    if (millis() - lastEyeUpdateMS > 2000){
+    if (theTOF.isRecovering()) {
 
-        lastEyeUpdateMS = millis();
+        // a TOF sensor is being brought back up; look around until it is
+        if (!animation1.isRunning()) {
+            animation1.clearSceneList();
+            sequenceEyesRoamAhead();
+            animation1.startRunning();
+        }
+        scheduler.runIn(eyesSleepTask, EYES_SLEEP_MS);
+        armIdlePower();
+    }
+}
 
-        animation1.stopRunning();
-        animation1.clearSceneList();
-        animation1.addScene(sceneEyesOpen, 0 , MOVE_SPEED_IMMEDIATE, 0);
-        
-        //now let the animation run
-        animation1.startRunning();
+//------- mouthLinkTask --------
+// send queued events to the mouth, repeat the ones it did not ack, ping it.
+// Events the mouth never acked go to it through the cloud instead.
+void mouthLinkTask() {
+
+    mouthLink.process();
+
+    uint8_t event;
+    while (mouthLink.getUndelivered(&event)) {
+        if (!mirrorEventsToCloud) {     // else it was published when it was sent
+            publishEventForMouth((TOF_detect)event);
+        }
     }
 
-#else
+    static bool wasUp = false;
+    if (mouthLink.isUp() != wasUp) {
+        wasUp = !wasUp;
+        publishEvent("mouth_link", wasUp ? "up" : "down", PUBLISH_PRIORITY_STATUS);
+    }
+}
 
-#ifndef VERIFY_CALIBRATION_ONLY
+//------- eyesSleep --------
+// one-shot task: no one has been looked at for EYES_SLEEP_MS, so go to sleep
+void eyesSleep() {
 
-    static bool mouthTriggered = false;
-    static long lastIdleSequenceStartTime = 0;
+    animation1.stopRunning();
+    animation1.clearSceneList();
+    animation1.addScene(sceneEyesOpen, 0 , MOVE_SPEED_IMMEDIATE, 0);
+    
+    //now let the animation run
+    animation1.startRunning();
+}
 
-    static bool weAreAlive = true; // when true we will not run
+//------- armIdlePower --------
+// someone is here; idle power mode starts once no one has been seen for idlePowerAfterMS
+void armIdlePower() {
+    idleLidsClosing = false;
+    if (idlePowerAfterMS > 0) {
+        scheduler.runIn(idlePowerTask, idlePowerAfterMS);
+    } else {
+        scheduler.cancel(idlePowerTask);
+    }
+}
+
+//------- enterIdlePower --------
+// one-shot task: no one has been seen for idlePowerAfterMS. Close the lids, then
+// let the servos go limp, range slowly and run the other tasks less often.
+// loop() sleeps between them.
+void enterIdlePower() {
+
+    if (!idleLidsClosing) {
+        idleLidsClosing = true;
+        eyesSleep();
+        scheduler.runIn(idlePowerTask, IDLE_POWER_RETRY_MS);
+        return;
+    }
+    if (animation1.isRunning()) {
+        scheduler.runIn(idlePowerTask, IDLE_POWER_RETRY_MS);
+        return;
+    }
+
+    idlePower = true;
+    theTOF.setIdleRate(true);
+    scheduler.cancel(servoTaskNumber);
+    TPP_AnimateServo::sleepDriver();
+    for (int i = 0; i < numIdleSlowedTasks; i++) {
+        scheduler.setPeriod(idleSlowedTasks[i], max(idleSlowedPeriodsMS[i], IDLE_POWER_TASK_MS));
+    }
+    mainLog.info("idle power on, no one seen for %lu minutes", idlePowerAfterMS / 60000);
+}
 
-   // has the sleep button been pressed?
-    static int lastKillButtonState = switchReadStateBUTTON_PIN();
-    if(switchReadStateBUTTON_PIN() != lastKillButtonState){
+//------- leaveIdlePower --------
+// back to full rate tracking; called before the eyes are told to move
+void leaveIdlePower() {
+
+    idlePower = false;
+    theTOF.setIdleRate(false);
+    TPP_AnimateServo::wakeDriver();
+    scheduler.runIn(servoTaskNumber, 0);
+    for (int i = 0; i < numIdleSlowedTasks; i++) {
+        scheduler.setPeriod(idleSlowedTasks[i], idleSlowedPeriodsMS[i]);
+    }
+    armIdlePower();
+    mainLog.info("idle power off");
+}
+
+#elif !defined(VERIFY_CALIBRATION_ONLY)
+
+bool weAreAlive = true; // when false we will not run
+bool mouthTriggered = false;
+
+//------- debounce --------
+// the debounced state of an input, given a new sample and the previous one.
+// returns true if the debounced state has changed
+bool debounce(int sample, int *pLastSample, int *pState) {
+    bool changed = (sample == *pLastSample) && (sample != *pState);
+    if (changed) {
+        *pState = sample;
+    }
+    *pLastSample = sample;
+    return changed;
+}
+
+//------- inputTask --------
+// debounce the kill button and the trigger from the mouth, and act on their changes
+void inputTask() {
+
+    // has the sleep button been pressed?
+    static int lastKillSample = switchReadStateBUTTON_PIN();
+    static int killButtonState = lastKillSample;
+    if (debounce(switchReadStateBUTTON_PIN(), &lastKillSample, &killButtonState)) {
 
-        lastKillButtonState = switchReadStateBUTTON_PIN();
         // invert alive/dead state
         mainLog.info("kill button pressed");
 
@@ -572,10 +983,11 @@ void loop() {
         return;
     }
 
- 
-
     // have we been triggered by the mouth?
-    if (digitalRead(TRIGGER_PIN) == HIGH) {
+    static int lastTriggerSample = LOW;
+    static int triggerState = LOW;
+    debounce(digitalRead(TRIGGER_PIN), &lastTriggerSample, &triggerState);
+    if (triggerState == HIGH) {
         
         if (mouthTriggered) {
             // we are already running, refresh the sequence if needed
@@ -615,55 +1027,165 @@ void loop() {
         }
 
     }
+}
+
+//------- idleTask --------
+// We are not mouth triggered, so decide if we want to have 
+// the puppet do some random thing
+void idleTask() {
+
+    static long lastIdleSequenceStartTime = 0;
 
-    // We are not mouth triggered, so decide if we want to have 
-    // the puppet do some random thing
-    if (!mouthTriggered) {
+    if (!weAreAlive || mouthTriggered) {
+        return;
+    }
         
-        if (!animation1.isRunning() && 
-            (millis() - lastIdleSequenceStartTime > IDLE_SEQUENCE_MIN_WAIT_MS)) {
-            // there is no animation running, and we haven't done any random
-            // thing for at least IDLE_SEQUENCE_MIN_WAIT_TS
+    if (!animation1.isRunning() && 
+        (millis() - lastIdleSequenceStartTime > IDLE_SEQUENCE_MIN_WAIT_MS)) {
+        // there is no animation running, and we haven't done any random
+        // thing for at least IDLE_SEQUENCE_MIN_WAIT_TS
 
-            animation1.clearSceneList();
-            lastIdleSequenceStartTime = millis();
-
-            int thisRandom = random(100);
-            if (thisRandom > 80) {
-                //20%
-                sequenceWakeUpSlowly(0);
-                sequenceEyesRoam();
-                sequenceAsleep(5000);
-                mainLog.info("Idle option 1");
-            } else if (thisRandom > 60){
-                //20%
-                sequenceWakeUpSlowly(0);
-                sequenceEyesRoam();
-                sequenceAsleep(5000);
-                mainLog.info("Idle option 2");
-            } else if (thisRandom > 20){
-                //20%
-                sequenceEyesRoamAhead();
-                sequenceEyesRoamAhead();
-                sequenceEyesRoamAhead();
-                sequenceEyesRoamAhead();
-                sequenceAsleep(5000);
-                mainLog.info("Idle option 3");
-            } else if (thisRandom > 0){
-                //20%
-                sequenceBlinkEyes(1000);
-                sequenceBlinkEyes(100);
-                sequenceAsleep(5000);
-                mainLog.info("Idle option 4");
-            }
+        animation1.clearSceneList();
+        lastIdleSequenceStartTime = millis();
+
+        int thisRandom = random(100);
+        if (thisRandom > 80) {
+            //20%
+            sequenceWakeUpSlowly(0);
+            sequenceEyesRoam();
+            sequenceAsleep(5000);
+            mainLog.info("Idle option 1");
+        } else if (thisRandom > 60){
+            //20%
+            sequenceWakeUpSlowly(0);
+            sequenceEyesRoam();
+            sequenceAsleep(5000);
+            mainLog.info("Idle option 2");
+        } else if (thisRandom > 20){
+            //20%
+            sequenceEyesRoamAhead();
+            sequenceEyesRoamAhead();
+            sequenceEyesRoamAhead();
+            sequenceEyesRoamAhead();
+            sequenceAsleep(5000);
+            mainLog.info("Idle option 3");
+        } else if (thisRandom > 0){
+            //20%
+            sequenceBlinkEyes(1000);
+            sequenceBlinkEyes(100);
+            sequenceAsleep(5000);
+            mainLog.info("Idle option 4");
+        }
 
-            animation1.startRunning();
+        animation1.startRunning();
+    }
+}
+
+#endif
+
+//------- heapCheckTask --------
+// Once the head is running, the tasks of loop() allocate no memory: no String,
+// no new. That is enforced off the Photon by Software/Photonfirmware/test
+// ("make test" fails on any allocation after setup). This only watches for
+// leaks on the Photon, from the system or a cloud function: the free memory at
+// the first check is the reference, and a warning is logged each time it falls
+// well below that.
+void heapCheckTask() {
+
+    static uint32_t referenceFree = 0;
+    uint32_t freeNow = System.freeMemory();
+
+    if (referenceFree == 0) {
+        referenceFree = freeNow;
+        mainLog.info("free memory %lu bytes", (unsigned long)freeNow);
+    } else if (freeNow + HEAP_CHECK_MARGIN_BYTES < referenceFree) {
+        mainLog.warn("free memory down to %lu bytes from %lu", (unsigned long)freeNow, (unsigned long)referenceFree);
+        referenceFree = freeNow;
+    }
+}
+
+#ifdef TPP_PROFILE
+//------- serialCommandTask --------
+// commands typed on the USB serial port: "p" prints the profile, "r" starts it over
+void serialCommandTask() {
+    while (Serial.available() > 0) {
+        int command = Serial.read();
+        if (command == 'p') {
+            profiler.dump();
+        } else if (command == 'r') {
+            profiler.reset();
         }
     }
+}
+#endif
+
+//------- addStartupTasks --------
+// the tasks that run from the start, while the start up sequence plays
+void addStartupTasks() {
+    servoTaskNumber = scheduler.addPeriodic("servo", servoTask, 1, TASK_PRIORITY_SERVO, 2000);
+    addPeriodicSlowedWhenIdle("tof recorder", tofRecorderTask, 1, TASK_PRIORITY_RECORDER, 1000);
+    addPeriodicSlowedWhenIdle("deferred log", deferredLogTask, DEFERRED_LOG_MS, TASK_PRIORITY_RECORDER, 5000);
+    publishTask = scheduler.addOneShot("publish", publishNextEvent, 0, TASK_PRIORITY_PUBLISH, 20000);
+    scheduler.cancel(publishTask);      // publishEvent() arms it
+#ifdef TOF_USE
+    addPeriodicSlowedWhenIdle("mouth link", mouthLinkTask, MOUTH_LINK_MS, TASK_PRIORITY_MOUTH_LINK, 1000);
+#endif
+#ifdef TPP_PROFILE
+    profiler.reset();
+    scheduler.addPeriodic("serial", serialCommandTask, 100, TASK_PRIORITY_RECORDER, 20000);
+#endif
+}
+
+//------- addBehaviourTasks --------
+// called once the start up sequence is done; the head starts reacting from here on
+void addBehaviourTasks() {
 
+#ifdef TOF_USE
+    tofTaskNumber = addPeriodicSlowedWhenIdle("tof", tofTask, TOF_SAMPLE_TIME, TASK_PRIORITY_TOF, 3000);
+    eyesSleepTask = scheduler.addOneShot("eyes sleep", eyesSleep, EYES_SLEEP_MS, TASK_PRIORITY_EYES, 2000);
+    idlePowerTask = scheduler.addOneShot("idle power", enterIdlePower, idlePowerAfterMS, TASK_PRIORITY_IDLE, 10000);
+    armIdlePower();
+#elif !defined(VERIFY_CALIBRATION_ONLY)
+    scheduler.addPeriodic("input", inputTask, INPUT_SAMPLE_MS, TASK_PRIORITY_INPUT, 2000);
+    scheduler.addPeriodic("idle", idleTask, IDLE_CHECK_MS, TASK_PRIORITY_IDLE, 2000);
 #endif
+    scheduler.addPeriodic("heap check", heapCheckTask, HEAP_CHECK_MS, TASK_PRIORITY_RECORDER, 1000);
+}
+
+//------- MAIN LOOP --------------
+void loop() {
+
+    static bool firstLoop = true;
+    static bool startingUp = true;
+
+    if (firstLoop){
+
+        firstLoop = false;
+        mainLog.info("first time in main loop");
+
+    }
+
+    // run whatever is due: the servos every time, the rest when their time comes
+    scheduler.run();
+
+#ifdef TOF_USE
+    if (idlePower) {
+        // nothing to do until a task is due or the TOF has a result; the
+        // result is taken at once so a newcomer is seen within one frame
+        if (tofThread.waitForPOI(scheduler.msUntilNextDue())) {
+            scheduler.runIn(tofTaskNumber, 0);
+        }
+    }
 #endif
 
+    if (startingUp) {
+        // keep coming here until start up sequence is done
+        if (!animation1.isRunning()) {
+            startingUp = false;
+            mainLog.info("finished start up sequence");
+            addBehaviourTasks();
+        }
+    }
 
 } // end of main loop
 
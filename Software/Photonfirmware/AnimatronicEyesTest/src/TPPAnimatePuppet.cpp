@@ -38,6 +38,8 @@
  */
 
 #include <TPPAnimatePuppet.h>
+#include <TPP_Profiler.h>
+#include <TPP_DeferredLog.h>
 
 Logger logPuppet("app.puppet");
 
@@ -51,6 +53,7 @@ Logger logPuppet("app.puppet");
 */
 void TPP_Puppet::process()  {
     
+    PROFILE_SECTION(PROFILE_PUPPET);
     eyeballs.process();
     eyelidLeftUpper.process();
     eyelidLeftLower.process();
@@ -153,7 +156,7 @@ void TPP_Eyeball::process() {
  */
 int TPP_Eyeball::lookCenter(float speed){
 
-    logPuppet.trace("eyeballs lookCenter");
+    DEFERRED_TRACE(logPuppet, "eyeballs lookCenter");
 
     int xMS = positionX(50,speed);
     int yMS = positionY(50, speed);
@@ -170,7 +173,7 @@ int TPP_Eyeball::lookCenter(float speed){
  */
 int TPP_Eyeball::positionX(int position, float speed) {
 
-    logPuppet.trace("eyeballs positionX");
+    DEFERRED_TRACE(logPuppet, "eyeballs positionX");
 
     position = map(position, 0, 100, xmidPos+leftOffset, xmidPos+rightOffset );
     return xServo.moveTo(position, speed);
@@ -185,7 +188,7 @@ int TPP_Eyeball::positionX(int position, float speed) {
  */
 int TPP_Eyeball::positionY(int position, float speed) {
 
-    logPuppet.trace("eyeballs positionY");
+    DEFERRED_TRACE(logPuppet, "eyeballs positionY");
 
     position = map(position, 0, 100, ymidPos+downOffset, ymidPos+upOffset);
     return yServo.moveTo(position, speed);
@@ -222,7 +225,7 @@ void TPP_Eyelid::process(){
 */
 int TPP_Eyelid::position(int position, float speed){
 
-    logPuppet.trace("Eyelid to position %d%%, speed %.2f", position, speed);
+    DEFERRED_TRACE(logPuppet, "Eyelid to position %d%%, speed %.2f", position, speed);
     int newPosition = map(position, 0, 100, closedPos, openPos);
     int durationMS = myServo.moveTo(newPosition, speed);
     return durationMS;
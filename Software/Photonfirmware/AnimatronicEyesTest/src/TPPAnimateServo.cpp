@@ -13,6 +13,8 @@
  *      moveTo: pass in a target PWM duration and increment 
  *      process: called over and over to cause the servo to move from its current
  *              position to the new target position
+ *      sleepDriver, wakeDriver: stop and restart the pulses of all the servos, which
+ *              then go limp; saves power while the head has nothing to do
  * 
  * For full documentation see https://github/TeamPracticalProjects/XXXX
  * 
@@ -21,6 +23,7 @@
  */
 
 #include <TPPAnimateServo.h>
+#include <TPP_DeferredLog.h>
 #define TPPServo_DEBUG   // note that the debug prints in process() are not recommended because they
                             // slow the timer work
 
@@ -55,6 +58,23 @@ void TPP_AnimateServo::initPWM(){
 
 }
 
+/* ----- sleepDriver -----
+ *  stops the oscillator of the driver board, so no servo gets pulses.
+ *  Nothing moves until wakeDriver is called.
+ */
+void TPP_AnimateServo::sleepDriver(){
+    pwm_.sleep();
+    logAniservo.info("servo driver asleep");
+}
+
+/* ----- wakeDriver -----
+ *  the servos get the pulses they had when the driver went to sleep
+ */
+void TPP_AnimateServo::wakeDriver(){
+    pwm_.wakeup();
+    logAniservo.info("servo driver awake");
+}
+
 /*------ begin -----
  * servoNum: based on the AdaFruit servo driver board
  * position: where to set the servo on initialization
@@ -109,7 +129,7 @@ int TPP_AnimateServo::moveTo (int newPos, float newSpeed)  volatile{
 
     estimatedMSToFinish = (movesMS + servoMoveMS);
 
-    logAniservo.trace("MoveTo - ServoNum: %d, pos: %.1f, dest: %d, dist: %d speed: %.2f, movesNeeded: %d, estDur: %d", 
+    DEFERRED_TRACE(logAniservo, "MoveTo - ServoNum: %d, pos: %.1f, dest: %d, dist: %d speed: %.2f, movesNeeded: %d, estDur: %d", 
               servoNum_, position_, destination_, totalDistance, speed_, movesNeeded, estimatedMSToFinish);
 
 
@@ -151,7 +171,7 @@ void TPP_AnimateServo::process() volatile {
             pwm_.setPWM (servoNum_, 0, newPosition);
             lastMoveMade_ = millis();
 
-            logAniservo.trace("!ServoNum: %i, dtg: %d, speed: %.2f, how far this time: %.2f", 
+            DEFERRED_TRACE(logAniservo, "!ServoNum: %i, dtg: %d, speed: %.2f, how far this time: %.2f", 
               servoNum_, distanceToGo, speed_, howFarToMoveNow );
 
         }
@@ -174,14 +194,10 @@ void TPP_AnimateServo::process() volatile {
             }
             int actualDuration = timeEnd - timeStart_;
 
-        // XXX If this is called from a Timer object and I uncomment these then
-        //    the process crashes. The documentation explicitly says to use
-        //    the log object instead of Serial.print in a Timer call back.
-        //    why doesn't this work?
-
-            logAniservo.trace("Arrived, ServoNum: %i, pos: %.2f, speed: %.2f, actDur: %d", 
+            // deferred, since logging directly from a Timer call back crashed
+            DEFERRED_TRACE(logAniservo, "Arrived, ServoNum: %i, pos: %.2f, speed: %.2f, actDur: %d", 
               servoNum_, position_, speed_, actualDuration );
-            logAniservo.trace("Summary, speed: %.2f , MS Per Move Unit: %.2f", 
+            DEFERRED_TRACE(logAniservo, "Summary, speed: %.2f , MS Per Move Unit: %.2f", 
                 speed_, MSPerMoveUnit);
 
         }
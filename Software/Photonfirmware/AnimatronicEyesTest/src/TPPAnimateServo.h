@@ -13,6 +13,8 @@
  *      moveTo: pass in a target PWM duration and increment 
  *      process: called over and over to cause the servo to move from its current
  *              position to the new target position
+ *      sleepDriver, wakeDriver: stop and restart the pulses of all the servos, which
+ *              then go limp; saves power while the head has nothing to do
  * 
  * For full documentation see https://github/TeamPracticalProjects/XXXX
  * 
@@ -43,6 +45,8 @@ class TPP_AnimateServo{
         void begin(int servoNum, int postion) volatile;
         void process() volatile; // called every time in the loop to keep the eyes moving
         int moveTo (int newX, float speed) volatile;
+        static void sleepDriver();
+        static void wakeDriver();
 
     private:
         
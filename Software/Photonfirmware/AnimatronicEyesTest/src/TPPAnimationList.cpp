@@ -45,6 +45,8 @@
  */
 
 #include <TPPAnimationList.h>
+#include <TPP_Profiler.h>
+#include <TPP_DeferredLog.h>
 
 Logger logAnilist("app.anilist");
 
@@ -139,6 +141,8 @@ void animationList::clearSceneList(){
  */
 void animationList::process() {
 
+    PROFILE_SECTION(PROFILE_ANIMATION);
+
     bool sceneChangeNow = false;
     int runTime = millis();
     int timeToFinishScene_ = 0;    
@@ -154,9 +158,9 @@ void animationList::process() {
         currentSceneIndex_++;
         if (currentSceneIndex_ <= lastSceneIndex_) {
             sceneChangeNow = true;
-            logAnilist.trace("moving to scene list # %d ", currentSceneIndex_);
+            DEFERRED_TRACE(logAnilist, "moving to scene list # %d ", currentSceneIndex_);
         } else {
-            logAnilist.trace("Last Scene has played");
+            DEFERRED_TRACE(logAnilist, "Last Scene has played");
             isRunning_ = false;
         }
 
@@ -167,7 +171,7 @@ void animationList::process() {
 
         sceneChangeNow = false;
 
-        logAnilist.trace("Changing scene now to %s", eSceneNames[sceneList_[currentSceneIndex_].scene]);
+        DEFERRED_TRACE(logAnilist, "Changing scene now to %s", eSceneNames[sceneList_[currentSceneIndex_].scene]);
 
         eScene thisScene = sceneList_[currentSceneIndex_].scene;
         int thisModifier = sceneList_[currentSceneIndex_].modifier;
@@ -182,7 +186,7 @@ void animationList::process() {
 
         }  // else the scene will change on the very next call to this process() routine
         
-        logAnilist.trace("Next scene at: %d",nextSceneChangeMS_);
+        DEFERRED_TRACE(logAnilist, "Next scene at: %d",nextSceneChangeMS_);
     }
 
     puppet.process();
@@ -196,7 +200,7 @@ int animationList::setScene(eScene newScene, int modifier, float speed) { //, TP
 
     int timeForSceneChange = 0;
 
-    logAnilist.info("now setting scene %s with speed %.2f ", eSceneNames[newScene], speed);
+    DEFERRED_INFO(logAnilist, "now setting scene %s with speed %.2f ", eSceneNames[newScene], speed);
 
     // For each scene in the eNum scene, we set the servos to their positions
     switch (newScene) {
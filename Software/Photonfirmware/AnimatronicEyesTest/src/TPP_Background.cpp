@@ -0,0 +1,111 @@
+/*
+    TPP_Background.cpp
+
+    Team Practical Project adaptive background for the Time of Flight sensor
+
+    See TPP_Background.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_Background.h>
+
+Logger backgroundLogger("app.TOF.background");
+
+// deviation that gives BACKGROUND_START_BAND_MM
+const int32_t START_DEVIATION_Q = (BACKGROUND_START_BAND_MM << BACKGROUND_FRACTION_BITS) / BACKGROUND_BAND_FACTOR;
+
+// -------- init ------------
+// start every zone from its calibration distance
+void TPP_Background::init(const int32_t calibration[], int numZones) {
+
+    numZones_ = min(numZones, BACKGROUND_MAX_ZONES);
+    for (int i = 0; i < numZones_; i++) {
+        zones_[i].meanQ = calibration[i] << BACKGROUND_FRACTION_BITS;
+        zones_[i].minQ = zones_[i].meanQ;
+        zones_[i].deviationQ = START_DEVIATION_Q;
+        zones_[i].stillMM = 0;
+        zones_[i].stillFrames = 0;
+        setForegroundMM(i);
+    }
+}
+
+// -------- classifyAndLearn ------------
+// called with each good distance of a frame
+// inLiveTrack is true if the zone was held by a live track in the last frame
+// returns true if the distance is foreground. Otherwise it is learned as background.
+bool TPP_Background::classifyAndLearn(int zone, int distanceMM, bool inLiveTrack) {
+
+    if (zone >= numZones_) {
+        return false;
+    }
+    zoneModel *pZone = &zones_[zone];
+    int32_t distanceQ = (int32_t)distanceMM << BACKGROUND_FRACTION_BITS;
+
+    if (distanceMM < pZone->foregroundMM) {
+
+        // foreground. If it stays put long enough, and no one is moving there,
+        // it was not a person.
+        if (!inLiveTrack && (abs(distanceMM - pZone->stillMM) <= getBandMM(zone))) {
+            pZone->stillFrames++;
+        } else {
+            pZone->stillMM = distanceMM;
+            pZone->stillFrames = 0;
+        }
+        if (pZone->stillFrames < BACKGROUND_ABSORB_FRAMES) {
+            return true;
+        }
+        backgroundLogger.info("zone %d: %d mm is now background, was %d mm", zone, distanceMM, getMeanMM(zone));
+        pZone->meanQ = distanceQ;
+        pZone->minQ = distanceQ;
+        pZone->deviationQ = START_DEVIATION_Q;
+        pZone->stillFrames = 0;
+        setForegroundMM(zone);
+        return false;
+    }
+
+    // background. stillFrames is kept, so a zone that flickers between the
+    // background and a nearer surface ends up with the nearer one in min.
+    pZone->deviationQ += (abs(distanceQ - pZone->meanQ) - pZone->deviationQ) >> BACKGROUND_LEARN_SHIFT;
+    pZone->meanQ += (distanceQ - pZone->meanQ) >> BACKGROUND_LEARN_SHIFT;
+    if (distanceQ < pZone->minQ) {
+        pZone->minQ += (distanceQ - pZone->minQ) >> BACKGROUND_LEARN_SHIFT;
+    } else {
+        pZone->minQ += (pZone->meanQ - pZone->minQ) >> BACKGROUND_MIN_RELAX_SHIFT;
+    }
+    setForegroundMM(zone);
+    return false;
+}
+
+/* ------------------------------ */
+// the foreground threshold of a zone in whole mm, min(mean, min) - band rounded up,
+// so distanceMM < foregroundMM is the same as distanceQ < min(meanQ, minQ) - bandQ
+void TPP_Background::setForegroundMM(int zone) {
+    zoneModel *pZone = &zones_[zone];
+    int32_t thresholdQ = min(pZone->meanQ, pZone->minQ) - (getBandMM(zone) << BACKGROUND_FRACTION_BITS);
+    pZone->foregroundMM = (thresholdQ + (1 << BACKGROUND_FRACTION_BITS) - 1) >> BACKGROUND_FRACTION_BITS;
+}
+
+/* ------------------------------ */
+// the background distance of a zone
+int TPP_Background::getMeanMM(int zone) const {
+    return zones_[zone].meanQ >> BACKGROUND_FRACTION_BITS;
+}
+
+/* ------------------------------ */
+// how much closer than the background a distance must be to be foreground
+int TPP_Background::getBandMM(int zone) const {
+    int bandMM = (BACKGROUND_BAND_FACTOR * zones_[zone].deviationQ) >> BACKGROUND_FRACTION_BITS;
+    return constrain(bandMM, BACKGROUND_MIN_BAND_MM, BACKGROUND_MAX_BAND_MM);
+}
+
+/* ------------------------------ */
+// the nearer of the mean and the min of a zone, which foreground is measured
+// from. init() with these starts another TPP_Background where this one is now.
+int TPP_Background::getBackgroundMM(int zone) const {
+    return min(zones_[zone].meanQ, zones_[zone].minQ) >> BACKGROUND_FRACTION_BITS;
+}
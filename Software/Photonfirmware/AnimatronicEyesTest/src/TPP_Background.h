@@ -0,0 +1,87 @@
+/*
+    TPP_Background.h
+
+    Team Practical Project adaptive background for the Time of Flight sensor
+
+    The calibration frame taken at boot goes stale when furniture is moved, the
+    light changes or a sign is put up, and every zone that is now closer than the
+    calibration looks like a person until the head is restarted. This keeps a
+    running estimate of the background of each zone instead.
+
+    For each zone
+        mean        exponential moving average of the background distance
+        deviation   exponential moving average of |distance - mean|, the noise of the zone
+        min         the closest background seen. Nearer readings pull it in as fast as
+                    the mean learns, so one noisy reading does not; it slowly relaxes
+                    back to the mean. A zone that flickers between two surfaces keeps
+                    the nearer one.
+    A distance is foreground if it is closer than min(mean, min) - band, where the
+    band is BACKGROUND_BAND_FACTOR deviations, limited to BACKGROUND_MIN_BAND_MM ..
+    BACKGROUND_MAX_BAND_MM. Only zones that are background are learned, so a person
+    does not become background by walking through. A zone that stays foreground at
+    the same distance for BACKGROUND_ABSORB_FRAMES (something was put there) is
+    taken into the background, but not while it is held by a live track of
+    TPP_Tracker: a visitor who stands still is not absorbed until they have not
+    moved for TRACKER_LIVE_MS as well.
+
+    Distances are kept in fixed point mm, BACKGROUND_FRACTION_BITS fraction bits.
+    All math is integer. The foreground threshold of each zone is kept in mm as
+    well, so a zone that is not being learned can be tested with one compare.
+
+    Key methods
+        .init()             start from a calibration frame
+        .classifyAndLearn() decide if a distance is foreground, and learn from it if not
+        .mayBeForeground()  the same decision without learning, for zones outside the ROI
+        .getBackgroundMM()  the background as learned so far, to start another TPP_Background from
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_BACKGROUND_H
+#define _TPP_BACKGROUND_H
+
+#include <Particle.h>
+
+#define BACKGROUND_MAX_ZONES 64
+#define BACKGROUND_FRACTION_BITS 4
+
+#define BACKGROUND_LEARN_SHIFT 5        // mean and deviation learn 1/32 of each frame, about 2 s
+#define BACKGROUND_MIN_RELAX_SHIFT 8    // min relaxes 1/256 of the way to the mean each frame, about 18 s
+#define BACKGROUND_BAND_FACTOR 3
+#define BACKGROUND_MIN_BAND_MM 25
+#define BACKGROUND_MAX_BAND_MM 300
+#define BACKGROUND_START_BAND_MM 50     // the band of a zone before anything is learned
+#define BACKGROUND_ABSORB_FRAMES 840    // about 60 s at 14 frames per second
+
+/*!
+ *  @brief  Class that learns the background distance and noise of each zone
+ */
+class TPP_Background {
+public:
+    void init(const int32_t calibration[], int numZones);
+    bool classifyAndLearn(int zone, int distanceMM, bool inLiveTrack);
+    int  getMeanMM(int zone) const;
+    int  getBandMM(int zone) const;
+    int  getBackgroundMM(int zone) const;
+    bool mayBeForeground(int zone, int distanceMM) const { return distanceMM < zones_[zone].foregroundMM; }
+
+private:
+    typedef struct {
+        int32_t meanQ;              // mm << BACKGROUND_FRACTION_BITS
+        int32_t deviationQ;         // mm << BACKGROUND_FRACTION_BITS
+        int32_t minQ;               // mm << BACKGROUND_FRACTION_BITS
+        int16_t foregroundMM;       // a distance closer than this is foreground
+        int16_t stillMM;            // last foreground distance, for absorbing
+        uint16_t stillFrames;       // frames the zone has been foreground at stillMM
+    } zoneModel;
+
+    void setForegroundMM(int zone);
+
+    zoneModel zones_[BACKGROUND_MAX_ZONES];
+    int numZones_ = 0;
+};
+
+#endif
@@ -0,0 +1,333 @@
+/*
+    TPP_DeferredLog.cpp
+
+    Team Practical Project log that formats its messages later, out of the hot paths
+
+    See TPP_DeferredLog.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_DeferredLog.h>
+#include <TPP_TOFFrame.h>
+
+Logger deferredLogger("app.log");
+
+TPP_DeferredLog deferredLog;
+
+static_assert((DEFERRED_LOG_RECORDS & (DEFERRED_LOG_RECORDS - 1)) == 0,
+    "the ring positions wrap at 2^32, so the ring must be a power of 2");
+
+// -------- siteShown ------------
+// true if the Logger of a call site shows its level. The Logger is asked once and
+// the answer kept in the site. It is not asked in an interrupt: until a call from
+// elsewhere, messages from there are kept and process() decides.
+bool TPP_DeferredLog::siteShown(const deferredLogSite *pSite) {
+
+    uint8_t enabled = pSite->enabled.load(std::memory_order_relaxed);
+    if ((enabled == DEFERRED_SITE_UNKNOWN) && !HAL_IsISR()) {
+        enabled = pSite->pLogger->isLevelEnabled(pSite->level) ? DEFERRED_SITE_ENABLED : DEFERRED_SITE_DISABLED;
+        pSite->enabled.store(enabled, std::memory_order_relaxed);
+    }
+    return enabled != DEFERRED_SITE_DISABLED;
+}
+
+// -------- reserve ------------
+// take the next slot of the ring, or nullptr if the ring is full. Called from
+// any thread or interrupt; several may be filling in slots at once.
+deferredLogRecord *TPP_DeferredLog::reserve() {
+
+    uint32_t write = writeIndex_.load(std::memory_order_relaxed);
+    do {
+        if (write - readIndex_.load(std::memory_order_acquire) >= DEFERRED_LOG_RECORDS) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    } while (!writeIndex_.compare_exchange_weak(write, write + 1, std::memory_order_relaxed));
+
+    deferredLogRecord *pRecord = &records_[write % DEFERRED_LOG_RECORDS];
+    pRecord->position = write;
+    return pRecord;
+}
+
+/* ------------------------------ */
+// the record is filled in; process() may take it
+void TPP_DeferredLog::commit(deferredLogRecord *pRecord) {
+    pRecord->sequence.store(pRecord->position + 1, std::memory_order_release);
+}
+
+// -------- process ------------
+// called from loop() to drain the ring
+void TPP_DeferredLog::process() {
+    if (mode_ == DEFERRED_LOG_BINARY) {
+        drainBinary();
+    } else {
+        drainText();
+    }
+}
+
+// -------- setMode ------------
+void TPP_DeferredLog::setMode(deferredLogMode mode) {
+    mode_ = mode;
+    numSentSites_ = 0;      // a new reader needs the formats again
+    sendingLength_ = 0;
+    sendingSent_ = 0;
+}
+
+/* ------------------------------ */
+// the next complete record, or nullptr. A record being filled in holds up the
+// ones after it until it is done.
+static deferredLogRecord *nextRecord(deferredLogRecord *records, uint32_t read) {
+    deferredLogRecord *pRecord = &records[read % DEFERRED_LOG_RECORDS];
+    if (pRecord->sequence.load(std::memory_order_acquire) != read + 1) {
+        return nullptr;
+    }
+    return pRecord;
+}
+
+/* ------------------------------ */
+// format up to DEFERRED_LOG_DRAIN_RECORDS messages and pass each to its Logger.
+// Messages that their Logger would not show are dropped without being counted;
+// there are at most DEFERRED_LOG_RECORDS of them.
+void TPP_DeferredLog::drainText() {
+
+    uint32_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        droppedTotal_ += dropped;
+        deferredLogger.warn("%lu messages dropped, the ring was full", (unsigned long)dropped);
+    }
+
+    int formatted = 0;
+    for (int i = 0; (i < DEFERRED_LOG_RECORDS) && (formatted < DEFERRED_LOG_DRAIN_RECORDS); i++) {
+        uint32_t read = readIndex_.load(std::memory_order_relaxed);
+        deferredLogRecord *pRecord = nextRecord(records_, read);
+        if (pRecord == nullptr) {
+            return;
+        }
+        const deferredLogSite *pSite = pRecord->pSite;
+        if (siteShown(pSite)) {
+            char text[DEFERRED_LOG_TEXT_BYTES];
+            formatDeferredLog(text, sizeof(text), pSite->format, pRecord->argTypes, pRecord->args, pRecord->numArgs);
+            pSite->pLogger->log(pSite->level, "%s", text);
+            formatted++;
+        }
+        readIndex_.store(read + 1, std::memory_order_release);
+    }
+}
+
+/* ------------------------------ */
+// write what fits in the serial buffer, encoding records as they are needed
+void TPP_DeferredLog::drainBinary() {
+
+    while (true) {
+        if (sendingSent_ < sendingLength_) {
+            int length = min(Serial.availableForWrite(), sendingLength_ - sendingSent_);
+            if (length <= 0) {
+                return;
+            }
+            Serial.write(&sending_[sendingSent_], length);
+            sendingSent_ += length;
+            if (sendingSent_ < sendingLength_) {
+                return;
+            }
+        }
+        if (!encodeNext()) {
+            return;
+        }
+    }
+}
+
+/* ------------------------------ */
+static int put16(uint8_t *buffer, int index, uint16_t value) {
+    buffer[index] = value & 0xFF;
+    buffer[index + 1] = value >> 8;
+    return index + 2;
+}
+
+/* ------------------------------ */
+static int put32(uint8_t *buffer, int index, uint32_t value) {
+    index = put16(buffer, index, value & 0xFFFF);
+    return put16(buffer, index, value >> 16);
+}
+
+/* ------------------------------ */
+// puts the next binary record in sending_: the count of dropped messages, the
+// format of a call site not sent yet, or a message. returns false if there is none
+bool TPP_DeferredLog::encodeNext() {
+
+    uint8_t *buffer = sending_;
+    int length = put16(buffer, 0, DEFERRED_LOG_SYNC);
+
+    uint32_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        droppedTotal_ += dropped;
+        buffer[length++] = DEFERRED_LOG_DROPPED;
+        buffer[length++] = 0;
+        length = put32(buffer, length, dropped);
+        encodeRecord(length);
+        return true;
+    }
+
+    uint32_t read = readIndex_.load(std::memory_order_relaxed);
+    deferredLogRecord *pRecord = nextRecord(records_, read);
+    if (pRecord == nullptr) {
+        return false;
+    }
+    const deferredLogSite *pSite = pRecord->pSite;
+
+    if (!siteWasSent(pSite)) {
+        const char *category = pSite->pLogger->name();
+        int formatLength = min((int)strlen(pSite->format), 240);
+        int categoryLength = min((int)strlen(category), 60);
+        buffer[length++] = DEFERRED_LOG_SITE;
+        buffer[length++] = (uint8_t)pSite->level;
+        length = put32(buffer, length, (uint32_t)(uintptr_t)pSite);
+        buffer[length++] = formatLength;
+        buffer[length++] = categoryLength;
+        memcpy(&buffer[length], pSite->format, formatLength);
+        length += formatLength;
+        memcpy(&buffer[length], category, categoryLength);
+        length += categoryLength;
+        encodeRecord(length);
+        return true;
+    }
+
+    buffer[length++] = DEFERRED_LOG_MESSAGE;
+    buffer[length++] = pRecord->numArgs;
+    length = put32(buffer, length, (uint32_t)(uintptr_t)pSite);
+    length = put32(buffer, length, pRecord->timeMS);
+    for (int i = 0; i < pRecord->numArgs; i++) {
+        buffer[length++] = pRecord->argTypes[i];
+        if (pRecord->argTypes[i] == DEFERRED_ARG_STRING) {
+            const char *string = (const char *)pRecord->args[i];
+            int stringLength = min((int)strlen(string), DEFERRED_LOG_STRING_BYTES);
+            buffer[length++] = stringLength;
+            memcpy(&buffer[length], string, stringLength);
+            length += stringLength;
+        } else {
+            length = put32(buffer, length, (uint32_t)pRecord->args[i]);
+        }
+    }
+    readIndex_.store(read + 1, std::memory_order_release);
+    encodeRecord(length);
+    return true;
+}
+
+/* ------------------------------ */
+// add the CRC to the record of length bytes in sending_, ready to send
+void TPP_DeferredLog::encodeRecord(int length) {
+    sendingLength_ = put16(sending_, length, crc16TOFFrame(sending_, length));
+    sendingSent_ = 0;
+}
+
+/* ------------------------------ */
+// true if the format of pSite has been sent; if not, notes that it is about to be
+bool TPP_DeferredLog::siteWasSent(const deferredLogSite *pSite) {
+    for (int i = 0; i < numSentSites_; i++) {
+        if (sentSites_[i] == pSite) {
+            return true;
+        }
+    }
+    // once the table is full, the rest have their format sent before each message
+    if (numSentSites_ < DEFERRED_LOG_MAX_SITES) {
+        sentSites_[numSentSites_++] = pSite;
+        return false;
+    }
+    static const deferredLogSite *pLastSite = nullptr;
+    bool sent = (pLastSite == pSite);
+    pLastSite = sent ? nullptr : pSite;
+    return sent;
+}
+
+// -------- formatDeferredLog ------------
+// like snprintf with the arguments as they were stored. Length modifiers in the
+// format are ignored since every argument is kept as 32 bits.
+int formatDeferredLog(char *buffer, int bufferSize, const char *format,
+        const uint8_t *argTypes, const uintptr_t *args, int numArgs) {
+
+    int used = 0;
+    int arg = 0;
+    const char *p = format;
+
+    while ((*p != 0) && (used < bufferSize - 1)) {
+
+        if ((*p != '%') || (p[1] == '%')) {
+            buffer[used++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
+
+        // copy the flags, width and precision; drop the length modifiers
+        char spec[16];
+        int specLength = 0;
+        spec[specLength++] = *p++;
+        while ((*p != 0) && (strchr("-+ #0123456789.", *p) != nullptr) && (specLength < 12)) {
+            spec[specLength++] = *p++;
+        }
+        while ((*p != 0) && (strchr("hlLjzt", *p) != nullptr)) {
+            p++;
+        }
+        char conversion = *p;
+        if (conversion == 0) {
+            break;
+        }
+        p++;
+
+        int room = bufferSize - used;
+        int written = 0;
+        if (arg >= numArgs) {
+            written = snprintf(&buffer[used], room, "?");
+        } else {
+            uint8_t type = argTypes[arg];
+            uintptr_t value = args[arg];
+            arg++;
+
+            float asFloat = 0;
+            if (type == DEFERRED_ARG_FLOAT) {
+                uint32_t bits = (uint32_t)value;
+                memcpy(&asFloat, &bits, sizeof(asFloat));
+            }
+            long asLong = (type == DEFERRED_ARG_FLOAT) ? (long)asFloat
+                        : (type == DEFERRED_ARG_INT) ? (long)(int32_t)value : (long)(uint32_t)value;
+
+            switch (conversion) {
+                case 'd': case 'i':
+                    strcpy(&spec[specLength], "ld");
+                    written = snprintf(&buffer[used], room, spec, asLong);
+                    break;
+                case 'u': case 'x': case 'X': case 'o':
+                    spec[specLength] = 'l';
+                    spec[specLength + 1] = conversion;
+                    spec[specLength + 2] = 0;
+                    written = snprintf(&buffer[used], room, spec, (unsigned long)asLong);
+                    break;
+                case 'c':
+                    strcpy(&spec[specLength], "c");
+                    written = snprintf(&buffer[used], room, spec, (int)asLong);
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+                    spec[specLength] = conversion;
+                    spec[specLength + 1] = 0;
+                    written = snprintf(&buffer[used], room, spec,
+                        (type == DEFERRED_ARG_FLOAT) ? (double)asFloat : (double)asLong);
+                    break;
+                case 's':
+                    strcpy(&spec[specLength], "s");
+                    written = snprintf(&buffer[used], room, spec,
+                        (type == DEFERRED_ARG_STRING) ? (const char *)value : "?");
+                    break;
+                default:
+                    written = snprintf(&buffer[used], room, "?");
+                    break;
+            }
+        }
+        used += max(0, min(written, room - 1));
+    }
+
+    buffer[used] = 0;
+    return used;
+}
@@ -0,0 +1,223 @@
+/*
+    TPP_DeferredLog.h
+
+    Team Practical Project log that formats its messages later, out of the hot paths
+
+    DEFERRED_TRACE(logger, format, ...) in place of logger.trace(format, ...) only
+    stores where it was called from, the time and the raw arguments in a RAM ring;
+    nothing is formatted or written. The ring is drained from a low priority task
+    of loop(), so trace messages can stay on in the servo and TOF code without
+    changing their timing. It is safe to call from another thread, a Timer or an
+    interrupt: a call takes a slot with one atomic compare and swap and never waits.
+    If the ring is full the message is dropped and counted.
+
+    In text mode a message whose Logger would not show its level is not stored,
+    so it can not fill the ring. The Logger is asked once for each call site, the
+    first time it is used outside an interrupt, and the answer is kept in the site;
+    the log handlers are set up before setup() and not changed after.
+
+    The ring is drained in one of two modes:
+        DEFERRED_LOG_TEXT     each message is formatted and passed to its Logger, as if
+                              it had been logged when it was drained; the default
+        DEFERRED_LOG_BINARY   the records are written as they are to the USB serial
+                              port, to be formatted on a PC by the Processing sketch
+                              processingApp/TPP_DeferredLogDecoder. Only what fits in
+                              the serial buffer is written, so loop() never waits.
+
+    Arguments are kept as 32 bits: integers, enums, float or double (as float), and
+    strings. A string is kept as its pointer, so it must be a literal or in a table
+    that never changes, such as eSceneNames. At most DEFERRED_LOG_MAX_ARGS arguments.
+
+    Binary records, little endian. Each starts with uint16 DEFERRED_LOG_SYNC and a
+    uint8 type, and ends with the CRC-16/CCITT of TPP_TOFFrame.h over all before it,
+    so a reader can skip the text log messages that share the port.
+        DEFERRED_LOG_SITE       sent before the first message from a call site
+            uint8 level, uint32 site, uint8 format length, uint8 category length,
+            format, category
+        DEFERRED_LOG_MESSAGE
+            uint8 number of arguments, uint32 site, uint32 millis() when logged,
+            then for each argument uint8 DEFERRED_ARG_xxx and uint32 value, except
+            that a string is uint8 DEFERRED_ARG_STRING, uint8 length and its characters
+        DEFERRED_LOG_DROPPED
+            uint8 0, uint32 messages dropped since the last of these
+
+    Key methods
+        DEFERRED_TRACE(), DEFERRED_INFO()   log a message
+        .process()      called from loop() to drain the ring
+        .setMode()
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_DEFERREDLOG_H
+#define _TPP_DEFERREDLOG_H
+
+#include <Particle.h>
+#include <atomic>
+#include <type_traits>
+
+#ifndef DEFERRED_LOG_LEVEL
+#define DEFERRED_LOG_LEVEL LOG_LEVEL_TRACE  // messages below this level compile to nothing
+#endif
+
+#define DEFERRED_LOG_RECORDS 64             // a power of 2; about 4 kB
+#define DEFERRED_LOG_MAX_ARGS 10
+#define DEFERRED_LOG_MAX_SITES 48           // call sites whose format has been sent in binary mode
+#define DEFERRED_LOG_TEXT_BYTES 200         // longer messages are cut short
+#define DEFERRED_LOG_DRAIN_RECORDS 8        // the most process() formats in one call
+#define DEFERRED_LOG_STRING_BYTES 24        // in binary mode, longer string arguments are cut short
+#define DEFERRED_LOG_SEND_BYTES 320
+
+// binary records
+#define DEFERRED_LOG_SYNC 0x4C44            // "DL"
+#define DEFERRED_LOG_SITE 1
+#define DEFERRED_LOG_MESSAGE 2
+#define DEFERRED_LOG_DROPPED 3
+
+// argument types
+#define DEFERRED_ARG_INT 0
+#define DEFERRED_ARG_UINT 1
+#define DEFERRED_ARG_FLOAT 2
+#define DEFERRED_ARG_STRING 3
+
+typedef enum {
+    DEFERRED_LOG_TEXT,
+    DEFERRED_LOG_BINARY
+} deferredLogMode;
+
+// whether the Logger of a call site shows its level, as found by process()
+#define DEFERRED_SITE_UNKNOWN 0
+#define DEFERRED_SITE_ENABLED 1
+#define DEFERRED_SITE_DISABLED 2
+
+// one call site; the macros keep one of these in static memory for each call
+typedef struct {
+    const Logger *pLogger;
+    LogLevel level;
+    const char *format;
+    mutable std::atomic<uint8_t> enabled;   // DEFERRED_SITE_xxx
+} deferredLogSite;
+
+typedef struct {
+    std::atomic<uint32_t> sequence;     // the ring position + 1 once the record is complete
+    const deferredLogSite *pSite;
+    uint32_t timeMS;
+    uint8_t numArgs;
+    uint8_t argTypes[DEFERRED_LOG_MAX_ARGS];
+    uintptr_t args[DEFERRED_LOG_MAX_ARGS];   // 32 bits on the Photon; a string is its pointer
+    uint32_t position;                  // where it is in the ring, while it is being filled in
+} deferredLogRecord;
+
+// Formats a message from its format and stored arguments into buffer, like snprintf
+int formatDeferredLog(char *buffer, int bufferSize, const char *format,
+    const uint8_t *argTypes, const uintptr_t *args, int numArgs);
+
+/*!
+ *  @brief  Class that keeps the ring of log records and drains it. There is one instance.
+ */
+class TPP_DeferredLog {
+public:
+    template <typename... Args>
+    void add(const deferredLogSite *pSite, Args... args) {
+        static_assert(sizeof...(Args) <= DEFERRED_LOG_MAX_ARGS, "too many arguments for the deferred log");
+        if ((mode_ == DEFERRED_LOG_TEXT) && !siteShown(pSite)) {
+            return;
+        }
+        deferredLogRecord *pRecord = reserve();
+        if (pRecord == nullptr) {
+            return;
+        }
+        pRecord->pSite = pSite;
+        pRecord->timeMS = millis();
+        pRecord->numArgs = sizeof...(Args);
+        storeArgs(pRecord, 0, args...);
+        commit(pRecord);
+    }
+
+    void process();
+    void setMode(deferredLogMode mode);
+    unsigned long getDropped() { return droppedTotal_; }
+
+private:
+    static bool siteShown(const deferredLogSite *pSite);
+    deferredLogRecord *reserve();
+    void commit(deferredLogRecord *pRecord);
+    void drainText();
+    void drainBinary();
+    bool encodeNext();
+    void encodeRecord(int length);
+    bool siteWasSent(const deferredLogSite *pSite);
+
+    static void storeArgs(deferredLogRecord *pRecord, int index) {}
+
+    template <typename T, typename... Rest>
+    static void storeArgs(deferredLogRecord *pRecord, int index, T value, Rest... rest) {
+        storeArg(pRecord, index, value);
+        storeArgs(pRecord, index + 1, rest...);
+    }
+
+    template <typename T>
+    static void storeArg(deferredLogRecord *pRecord, int index, T value) {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+            "the deferred log keeps numbers and strings only");
+        if (std::is_floating_point<T>::value) {
+            float asFloat = (float)value;
+            memcpy(&pRecord->args[index], &asFloat, sizeof(asFloat));
+            pRecord->argTypes[index] = DEFERRED_ARG_FLOAT;
+        } else if (std::is_signed<T>::value || std::is_enum<T>::value) {
+            pRecord->args[index] = (uint32_t)(int32_t)value;
+            pRecord->argTypes[index] = DEFERRED_ARG_INT;
+        } else {
+            pRecord->args[index] = (uint32_t)value;
+            pRecord->argTypes[index] = DEFERRED_ARG_UINT;
+        }
+    }
+
+    static void storeArg(deferredLogRecord *pRecord, int index, const char *value) {
+        pRecord->args[index] = (uintptr_t)value;
+        pRecord->argTypes[index] = DEFERRED_ARG_STRING;
+    }
+
+    static void storeArg(deferredLogRecord *pRecord, int index, char *value) {
+        storeArg(pRecord, index, (const char *)value);
+    }
+
+    deferredLogRecord records_[DEFERRED_LOG_RECORDS];
+    std::atomic<uint32_t> writeIndex_{0};
+    std::atomic<uint32_t> readIndex_{0};
+    std::atomic<uint32_t> dropped_{0};
+    unsigned long droppedTotal_ = 0;
+
+    deferredLogMode mode_ = DEFERRED_LOG_TEXT;
+
+    // binary mode
+    const deferredLogSite *sentSites_[DEFERRED_LOG_MAX_SITES];
+    int numSentSites_ = 0;
+    uint8_t sending_[DEFERRED_LOG_SEND_BYTES];
+    int sendingLength_ = 0;
+    int sendingSent_ = 0;
+};
+
+extern TPP_DeferredLog deferredLog;
+
+// never called; lets the compiler check the format against the arguments as it does for Logger
+static inline void deferredLogCheckFormat(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void deferredLogCheckFormat(const char *format, ...) {}
+
+#define DEFERRED_LOG(logger, level, format, ...) do { \
+        if (false) { \
+            deferredLogCheckFormat(format, ##__VA_ARGS__); \
+        } \
+        if ((level) >= DEFERRED_LOG_LEVEL) { \
+            static const deferredLogSite DEFERRED_LOG_SITE_HERE = { &(logger), (level), (format), {DEFERRED_SITE_UNKNOWN} }; \
+            deferredLog.add(&DEFERRED_LOG_SITE_HERE, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define DEFERRED_TRACE(logger, format, ...) DEFERRED_LOG(logger, LOG_LEVEL_TRACE, format, ##__VA_ARGS__)
+#define DEFERRED_INFO(logger, format, ...) DEFERRED_LOG(logger, LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+
+#endif
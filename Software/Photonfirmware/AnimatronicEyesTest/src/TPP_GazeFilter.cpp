@@ -0,0 +1,118 @@
+/*
+    TPP_GazeFilter.cpp
+
+    Team Practical Project adaptive smoothing of the gaze target
+
+    This is a One Euro filter (Casiez, Roussel, Vogel 2012) done in integer math.
+    For each axis
+        speed    = low pass of the raw speed, cutoff derivCutoff
+        cutoff   = minCutoff + beta * |speed|
+        position = low pass of the raw position, cutoff from above
+    and the low pass smoothing factor for a sample time Te is
+        alpha = 2*pi*fc*Te / (2*pi*fc*Te + 1)
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_GazeFilter.h>
+#include <TPP_Tracker.h>    // for POI_FRACTION_ONE
+
+// extra fraction bits kept in the filter state so small corrections are not lost
+#define STATE_FRACTION_BITS 8
+
+// a gap longer than this means the history is stale; start over
+const int MAX_GAP_MS = 1000;
+
+/* ------------------------------ */
+// set the filter parameters and start over
+void TPP_GazeFilter::init(const gazeFilterConfig &config) {
+    config_ = config;
+    reset();
+}
+
+/* ------------------------------ */
+// forget the history; the next position is passed through as-is
+void TPP_GazeFilter::reset() {
+    primed_ = false;
+}
+
+/* ------------------------------ */
+// returns the low pass smoothing factor for a cutoff and sample time, times 65536
+int32_t TPP_GazeFilter::alphaQ16(int32_t cutoffMilliHz, int dtMS) {
+
+    // 2*pi*fc*Te scaled by 1,000,000 (milliHz * ms)
+    int64_t wScaled = ((int64_t)6283 * cutoffMilliHz * dtMS) / 1000;
+    return (int32_t)((wScaled << 16) / (wScaled + 1000000));
+}
+
+/* ------------------------------ */
+// moves one axis of the filter forward by one sample
+void TPP_GazeFilter::filterAxis(axisState *pAxis, int value, int dtMS) {
+
+    int32_t valueQ = (int32_t)value << STATE_FRACTION_BITS;
+
+    // smoothed speed in fine units per second
+    int32_t rawSpeed = (((valueQ - pAxis->valueQ) >> STATE_FRACTION_BITS) * 1000) / dtMS;
+    int32_t alphaD = alphaQ16(config_.derivCutoffMilliHz, dtMS);
+    pAxis->speed += (int32_t)(((int64_t)alphaD * (rawSpeed - pAxis->speed)) >> 16);
+
+    // the faster the target moves, the higher the cutoff
+    int32_t cutoff = config_.minCutoffMilliHz
+        + (int32_t)(((int64_t)config_.betaMilliHz * abs(pAxis->speed)) / POI_FRACTION_ONE);
+    int32_t alpha = alphaQ16(cutoff, dtMS);
+    pAxis->valueQ += (int32_t)(((int64_t)alpha * (valueQ - pAxis->valueQ)) >> 16);
+}
+
+/* ------------------------------ */
+// filter a new gaze target. The filtered position is returned in pXOut, pYOut.
+// returns true if the filtered position has moved at least deadbandFine since the
+// last time we returned true, which means the eyes should be retargeted.
+bool TPP_GazeFilter::update(int xFine, int yFine, unsigned long nowMS, int *pXOut, int *pYOut) {
+
+    int dtMS = nowMS - lastMS_;
+    bool inputMoved = (xFine != lastXIn_) || (yFine != lastYIn_);
+    lastXIn_ = xFine;
+    lastYIn_ = yFine;
+
+    if (!primed_ || (dtMS > MAX_GAP_MS)) {
+        // first position; nothing to smooth against
+        primed_ = true;
+        x_.valueQ = (int32_t)xFine << STATE_FRACTION_BITS;
+        y_.valueQ = (int32_t)yFine << STATE_FRACTION_BITS;
+        x_.speed = 0;
+        y_.speed = 0;
+        lastMS_ = nowMS;
+        lastXOut_ = *pXOut = xFine;
+        lastYOut_ = *pYOut = yFine;
+        retargets_++;
+        return true;
+    }
+
+    if (dtMS > 0) {
+        filterAxis(&x_, xFine, dtMS);
+        filterAxis(&y_, yFine, dtMS);
+        lastMS_ = nowMS;
+    }
+
+    // round to nearest
+    *pXOut = (x_.valueQ + (1 << (STATE_FRACTION_BITS - 1))) >> STATE_FRACTION_BITS;
+    *pYOut = (y_.valueQ + (1 << (STATE_FRACTION_BITS - 1))) >> STATE_FRACTION_BITS;
+
+    if ((abs(*pXOut - lastXOut_) < config_.deadbandFine) && (abs(*pYOut - lastYOut_) < config_.deadbandFine)) {
+        // too small a move to be worth a retarget. Only count it if the target
+        // moved; a target that stands still suppresses nothing.
+        if (inputMoved) {
+            suppressedRetargets_++;
+        }
+        return false;
+    }
+
+    lastXOut_ = *pXOut;
+    lastYOut_ = *pYOut;
+    retargets_++;
+    return true;
+}
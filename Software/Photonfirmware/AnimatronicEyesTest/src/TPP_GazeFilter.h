@@ -0,0 +1,73 @@
+/*
+    TPP_GazeFilter.h
+
+    Team Practical Project adaptive smoothing of the gaze target
+
+    The position of a person reported by the TOF jitters from frame to frame. Each
+    new position costs an animation list rebuild and new servo writes, and makes
+    the eyes twitch. This is a One Euro filter: a low pass filter whose cutoff
+    rises with the speed of the target. At rest the cutoff is low and jitter is
+    removed; when the person moves quickly the cutoff rises and the eyes keep up.
+
+    Positions are in fixed point zone units, see POI_FRACTION_BITS.
+    All math is integer.
+
+    Key methods
+        .init()     set the filter parameters
+        .update()   filter a new target position. Returns true if the filtered position
+                    has moved far enough that the eyes should be retargeted
+        .reset()    forget the history, e.g. when a new person is being looked at
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_GAZEFILTER_H
+#define _TPP_GAZEFILTER_H
+
+#include <Particle.h>
+
+typedef struct {
+    int minCutoffMilliHz;       // cutoff when the target is still. Lower is smoother but lags more
+    int betaMilliHz;            // cutoff increase for each zone per second of target speed
+    int derivCutoffMilliHz;     // cutoff used to smooth the speed estimate
+    int deadbandFine;           // filtered moves smaller than this do not retarget the eyes
+} gazeFilterConfig;
+
+/*!
+ *  @brief  Class that holds the state of a fixed point One Euro filter for the x and y
+ * gaze position
+ */
+class TPP_GazeFilter {
+public:
+    void init(const gazeFilterConfig &config);
+    void reset();
+    bool update(int xFine, int yFine, unsigned long nowMS, int *pXOut, int *pYOut);
+    unsigned long getRetargets() { return retargets_; }
+    unsigned long getSuppressedRetargets() { return suppressedRetargets_; }
+
+private:
+    typedef struct {
+        int32_t valueQ;         // filtered position, fine units << STATE_FRACTION_BITS
+        int32_t speed;          // filtered speed, fine units per second
+    } axisState;
+
+    void filterAxis(axisState *pAxis, int value, int dtMS);
+    int32_t alphaQ16(int32_t cutoffMilliHz, int dtMS);
+
+    gazeFilterConfig config_ = {1000, 500, 1000, 0};
+    axisState x_;
+    axisState y_;
+    bool primed_ = false;       // true once we have a first position
+    unsigned long lastMS_ = 0;
+    int lastXOut_ = 0;          // last position that retargeted the eyes
+    int lastYOut_ = 0;
+    int lastXIn_ = 0;           // last target given to update()
+    int lastYIn_ = 0;
+    unsigned long retargets_ = 0;
+    unsigned long suppressedRetargets_ = 0;     // the target moved, but not the eyes
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*
+    TPP_Profiler.cpp
+
+    Team Practical Project profiler of the time spent in named sections of code
+
+    See TPP_Profiler.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_Profiler.h>
+
+#ifdef TPP_PROFILE
+
+#ifndef PARTICLE
+#include <chrono>
+#include <cstdio>
+#endif
+
+TPP_Profiler profiler;
+
+const char *PROFILE_SECTION_NAMES[PROFILE_NUM_SECTIONS] = {
+    "TOF read",
+    "POI",
+    "animation",
+    "puppet",
+    "PWM",
+    "log",
+    "publish"
+};
+
+#ifdef PARTICLE
+// Cortex-M3 debug registers
+#define DEMCR           (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA    (1UL << 24)
+#define DWT_CTRL        (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA (1UL << 0)
+#define DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004)
+#endif
+
+// -------- ticks ------------
+// the time now, in CPU cycles on the Photon and nanoseconds elsewhere.
+// Wraps after about 35 s on the Photon, so only differences are meaningful.
+uint32_t TPP_Profiler::ticks() {
+#ifdef PARTICLE
+    return DWT_CYCCNT;
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* ------------------------------ */
+uint32_t TPP_Profiler::ticksPerMicrosecond() {
+#ifdef PARTICLE
+    return System.ticksPerMicrosecond();
+#else
+    return 1000;
+#endif
+}
+
+// -------- add ------------
+// count one run of a section that took elapsedTicks
+void TPP_Profiler::add(profileSection section, uint32_t elapsedTicks) {
+
+    if (!started_) {
+        reset();
+    }
+    sectionStats *pStats = &stats_[section];
+    pStats->count++;
+    pStats->totalTicks += elapsedTicks;
+    pStats->minTicks = min(pStats->minTicks, elapsedTicks);
+    pStats->maxTicks = max(pStats->maxTicks, elapsedTicks);
+
+    // bucket n holds times from 2^(n-1) up to 2^n microseconds
+    uint32_t elapsedUS = elapsedTicks / ticksPerMicrosecond();
+    int bucket = 0;
+    while ((elapsedUS > 0) && (bucket < PROFILE_HISTOGRAM_BUCKETS - 1)) {
+        elapsedUS >>= 1;
+        bucket++;
+    }
+    pStats->histogram[bucket]++;
+}
+
+// -------- reset ------------
+// forget everything timed so far. Also makes sure the cycle counter is running;
+// Device OS usually starts it, a debugger may not.
+void TPP_Profiler::reset() {
+
+#ifdef PARTICLE
+    if (!(DWT_CTRL & DWT_CTRL_CYCCNTENA)) {
+        DEMCR |= DEMCR_TRCENA;
+        DWT_CYCCNT = 0;
+        DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+    }
+#endif
+    for (int i = 0; i < PROFILE_NUM_SECTIONS; i++) {
+        stats_[i].count = 0;
+        stats_[i].minTicks = 0xFFFFFFFF;
+        stats_[i].maxTicks = 0;
+        stats_[i].totalTicks = 0;
+        for (int j = 0; j < PROFILE_HISTOGRAM_BUCKETS; j++) {
+            stats_[i].histogram[j] = 0;
+        }
+    }
+    started_ = true;
+}
+
+// -------- dump ------------
+// print the table: for each section the runs, the min, average and max time in
+// microseconds, then the histogram, bucket 0 being under 1 us
+void TPP_Profiler::dump() {
+
+#ifdef PARTICLE
+#define PROFILE_PRINTF Serial.printf
+#else
+#define PROFILE_PRINTF printf
+#endif
+
+    uint32_t perUS = ticksPerMicrosecond();
+    PROFILE_PRINTF("section       runs      min us    avg us    max us  histogram <1 <2 <4 ... us\r\n");
+    for (int i = 0; i < PROFILE_NUM_SECTIONS; i++) {
+        const sectionStats &stats = stats_[i];
+        if (!started_ || (stats.count == 0)) {
+            PROFILE_PRINTF("%-12s  0\r\n", PROFILE_SECTION_NAMES[i]);
+            continue;
+        }
+        PROFILE_PRINTF("%-12s  %-8lu  %-8lu  %-8lu  %-8lu ", PROFILE_SECTION_NAMES[i], (unsigned long)stats.count,
+            (unsigned long)(stats.minTicks / perUS), (unsigned long)((stats.totalTicks / stats.count) / perUS),
+            (unsigned long)(stats.maxTicks / perUS));
+        for (int j = 0; j < PROFILE_HISTOGRAM_BUCKETS; j++) {
+            PROFILE_PRINTF(" %lu", (unsigned long)stats.histogram[j]);
+        }
+        PROFILE_PRINTF("\r\n");
+    }
+
+#undef PROFILE_PRINTF
+}
+
+#endif
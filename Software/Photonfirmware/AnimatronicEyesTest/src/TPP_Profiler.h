@@ -0,0 +1,121 @@
+/*
+    TPP_Profiler.h
+
+    Team Practical Project profiler of the time spent in named sections of code
+
+    Opt in by uncommenting TPP_PROFILE below. Otherwise PROFILE_SECTION compiles
+    to nothing.
+
+    PROFILE_SECTION(section) at the top of a block times the rest of the block.
+    For each section the profiler keeps the number of runs, the min, max and total
+    time, and a histogram with one bucket for each power of two microseconds. On
+    the Photon the time comes from the Cortex-M3 DWT cycle counter (CYCCNT), one
+    tick per CPU cycle. Elsewhere, when the code is built on a PC by the host
+    tests (Software/Photonfirmware/test, "make tof_replay_profile"), std::chrono
+    stands in for it and the table is printed with printf.
+
+    Sections may nest. Each section should only be entered by one thread, so the
+    table needs no lock: the TOF sections run in the TOF thread, the others in
+    loop(). The TOF thread logs too, so only the messages logged from loop() are
+    timed as PROFILE_LOG.
+
+    Key methods
+        .dump()     print the table to the USB serial port
+        .reset()    start over
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_PROFILER_H
+#define _TPP_PROFILER_H
+
+//#define TPP_PROFILE
+
+#include <Particle.h>
+
+#define PROFILE_HISTOGRAM_BUCKETS 16    // the last bucket holds everything from 16 ms up
+
+// the sections that are timed
+typedef enum {
+    PROFILE_TOF_READ,           // reading a frame from the sensor
+    PROFILE_POI,                // finding the point of interest in it
+    PROFILE_ANIMATION,          // animationList::process
+    PROFILE_PUPPET,             // TPP_Puppet::process
+    PROFILE_PWM,                // one servo write to the PCA9685
+    PROFILE_LOG,                // one log message
+    PROFILE_PUBLISH,            // one cloud publish
+    PROFILE_NUM_SECTIONS
+} profileSection;
+
+/*!
+ *  @brief  Class that keeps the timing table of the profiled sections. There is one instance.
+ */
+class TPP_Profiler {
+public:
+    static uint32_t ticks();
+    void add(profileSection section, uint32_t elapsedTicks);
+    void dump();
+    void reset();
+
+private:
+    typedef struct {
+        uint32_t count;
+        uint32_t minTicks;
+        uint32_t maxTicks;
+        uint64_t totalTicks;
+        uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+    } sectionStats;
+
+    uint32_t ticksPerMicrosecond();
+
+    sectionStats stats_[PROFILE_NUM_SECTIONS];
+    bool started_ = false;
+};
+
+extern TPP_Profiler profiler;
+
+/*!
+ *  @brief  Times the block it is declared in; see PROFILE_SECTION
+ */
+class TPP_ProfileScope {
+public:
+    TPP_ProfileScope(profileSection section) : section_(section), startTicks_(TPP_Profiler::ticks()) {}
+    ~TPP_ProfileScope() { profiler.add(section_, TPP_Profiler::ticks() - startTicks_); }
+
+private:
+    profileSection section_;
+    uint32_t startTicks_;
+};
+
+#ifdef TPP_PROFILE
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SECTION(section) TPP_ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(section)
+#else
+#define PROFILE_SECTION(section)
+#endif
+
+#if defined(TPP_PROFILE) && defined(PARTICLE)
+/*!
+ *  @brief  SerialLogHandler that times each message it writes as PROFILE_LOG
+ */
+class TPP_ProfiledSerialLogHandler : public SerialLogHandler {
+public:
+    using SerialLogHandler::SerialLogHandler;
+
+protected:
+    virtual void logMessage(const char *msg, LogLevel level, const char *category, const LogAttributes &attr) override {
+        if (!application_thread_current(NULL)) {
+            SerialLogHandler::logMessage(msg, level, category, attr);
+            return;
+        }
+        PROFILE_SECTION(PROFILE_LOG);
+        SerialLogHandler::logMessage(msg, level, category, attr);
+    }
+};
+#endif
+
+#endif
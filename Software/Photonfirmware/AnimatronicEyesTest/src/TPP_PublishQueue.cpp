@@ -0,0 +1,115 @@
+/*
+    TPP_PublishQueue.cpp
+
+    Team Practical Project queue of the events waiting to be published to the cloud
+
+    See TPP_PublishQueue.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_PublishQueue.h>
+
+Logger publishLogger("app.publish");
+
+/* ------------------------------ */
+// true if a should be published before b
+static bool goesBefore(const queuedEvent &a, const queuedEvent &b) {
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    return a.order < b.order;
+}
+
+// -------- add ------------
+// queue an event. One that replaces a waiting event of the same name keeps
+// its place, so an event that keeps changing is not put off for ever.
+void TPP_PublishQueue::add(const char *name, const char *data, int priority) {
+
+    int slot = -1;
+    for (int i = 0; i < numEvents_; i++) {
+        if (strncmp(events_[i].name, name, PUBLISH_QUEUE_NAME_BYTES - 1) == 0) {
+            publishLogger.trace("%s: %s replaces %s", name, data, events_[i].data);
+            replaced_++;
+            slot = i;
+            break;
+        }
+    }
+
+    queuedEvent event;
+    snprintf(event.name, PUBLISH_QUEUE_NAME_BYTES, "%s", name);
+    snprintf(event.data, PUBLISH_QUEUE_DATA_BYTES, "%s", data);
+    event.priority = priority;
+    event.order = nextOrder_++;
+    event.addedMS = millis();
+
+    if (slot >= 0) {
+        event.order = events_[slot].order;
+        event.addedMS = events_[slot].addedMS;
+    } else if (numEvents_ < PUBLISH_QUEUE_LENGTH) {
+        slot = numEvents_++;
+    }
+    if (slot < 0) {
+        // full: make room by dropping the least important, unless that is the new one
+        int last = 0;
+        for (int i = 1; i < numEvents_; i++) {
+            if (goesBefore(events_[last], events_[i])) {
+                last = i;
+            }
+        }
+        dropped_++;
+        if (events_[last].priority <= priority) {
+            publishLogger.warn("queue full, dropped %s: %s", name, data);
+            return;
+        }
+        publishLogger.warn("queue full, dropped %s: %s", events_[last].name, events_[last].data);
+        slot = last;
+    }
+    events_[slot] = event;
+}
+
+// -------- take ------------
+// returns true and the most important event if one is waiting and
+// PUBLISH_QUEUE_INTERVAL_MS has gone by since the last one was taken
+bool TPP_PublishQueue::take(queuedEvent *pEvent) {
+
+    if ((numEvents_ == 0) || (msUntilNext() > 0)) {
+        return false;
+    }
+
+    int first = 0;
+    for (int i = 1; i < numEvents_; i++) {
+        if (goesBefore(events_[i], events_[first])) {
+            first = i;
+        }
+    }
+    *pEvent = events_[first];
+    events_[first] = events_[--numEvents_];
+
+    published_++;
+    havePublished_ = true;
+    lastTakenMS_ = millis();
+    maxWaitMS_ = max(maxWaitMS_, lastTakenMS_ - pEvent->addedMS);
+    return true;
+}
+
+// -------- msUntilNext ------------
+// how long until take() may hand out the next event; 0 if it may now
+unsigned long TPP_PublishQueue::msUntilNext() {
+
+    unsigned long sinceLastMS = millis() - lastTakenMS_;
+    if (!havePublished_ || (sinceLastMS >= PUBLISH_QUEUE_INTERVAL_MS)) {
+        return 0;
+    }
+    return PUBLISH_QUEUE_INTERVAL_MS - sinceLastMS;
+}
+
+// -------- logStats ------------
+void TPP_PublishQueue::logStats() {
+    publishLogger.info("published %lu, replaced by a newer one %lu, dropped %lu, longest wait %lu ms",
+        published_, replaced_, dropped_, maxWaitMS_);
+}
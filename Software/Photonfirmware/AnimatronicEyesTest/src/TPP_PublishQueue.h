@@ -0,0 +1,73 @@
+/*
+    TPP_PublishQueue.h
+
+    Team Practical Project queue of the events waiting to be published to the cloud
+
+    The cloud takes about one publish a second. Events that come faster wait here
+    instead of being dropped, and go out one every PUBLISH_QUEUE_INTERVAL_MS.
+
+    An event replaces one with the same name that is still waiting: for an event
+    that reports a state, such as "TOF_event", only the latest state is worth
+    sending. So there is at most one event of each name in the queue, and each is
+    published within PUBLISH_QUEUE_LENGTH intervals.
+
+    The most important event goes first; priority 0 is the most important. Events
+    of the same priority go in the order they were added. If the queue is full,
+    the least important event is dropped, the new one if it is no more important
+    than the rest.
+
+    Key methods
+        .add()              queue an event
+        .take()             the next event to publish, if it is time for one
+        .msUntilNext()      when take() may next return one
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_PUBLISHQUEUE_H
+#define _TPP_PUBLISHQUEUE_H
+
+#include <Particle.h>
+
+#define PUBLISH_QUEUE_LENGTH 4
+#define PUBLISH_QUEUE_INTERVAL_MS 1000  // the cloud allows one publish a second
+#define PUBLISH_QUEUE_NAME_BYTES 24     // longer names and data are cut short
+#define PUBLISH_QUEUE_DATA_BYTES 32
+
+typedef struct {
+    char name[PUBLISH_QUEUE_NAME_BYTES];
+    char data[PUBLISH_QUEUE_DATA_BYTES];
+    int priority;                       // 0 is the most important
+    unsigned long order;                // counts up as events are added
+    unsigned long addedMS;
+} queuedEvent;
+
+/*!
+ *  @brief  Class that holds the events to publish and hands them out at the allowed rate
+ */
+class TPP_PublishQueue {
+public:
+    void add(const char *name, const char *data, int priority);
+    bool take(queuedEvent *pEvent);
+    unsigned long msUntilNext();
+    bool isEmpty() { return numEvents_ == 0; }
+    void logStats();
+
+private:
+    queuedEvent events_[PUBLISH_QUEUE_LENGTH];
+    int numEvents_ = 0;
+    unsigned long nextOrder_ = 0;
+    bool havePublished_ = false;
+    unsigned long lastTakenMS_ = 0;
+
+    // statistics
+    unsigned long published_ = 0;
+    unsigned long replaced_ = 0;        // a newer event of the same name came first
+    unsigned long dropped_ = 0;         // the queue was full
+    unsigned long maxWaitMS_ = 0;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*
+    TPP_Scheduler.cpp
+
+    Team Practical Project cooperative scheduler for the main loop
+
+    See TPP_Scheduler.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_Scheduler.h>
+#include <climits>
+
+Logger schedulerLogger("app.scheduler");
+
+static_assert(TPP_SCHEDULER_MAX_TASKS <= 32, "run() keeps one bit per task");
+
+// -------- addPeriodic ------------
+// pFunction is called every periodMS, the first time periodMS from now.
+// returns the task number, or -1 if there is no room for another task
+int TPP_Scheduler::addPeriodic(const char *name, schedulerTaskFunction pFunction, unsigned long periodMS,
+        int priority, unsigned long budgetUS) {
+    return addTask(name, pFunction, max(periodMS, 1UL), periodMS, priority, budgetUS);
+}
+
+// -------- addOneShot ------------
+// pFunction is called once, delayMS from now. runIn() arms it again.
+// returns the task number, or -1 if there is no room for another task
+int TPP_Scheduler::addOneShot(const char *name, schedulerTaskFunction pFunction, unsigned long delayMS,
+        int priority, unsigned long budgetUS) {
+    return addTask(name, pFunction, 0, delayMS, priority, budgetUS);
+}
+
+/* ------------------------------ */
+int TPP_Scheduler::addTask(const char *name, schedulerTaskFunction pFunction, unsigned long periodMS,
+        unsigned long delayMS, int priority, unsigned long budgetUS) {
+
+    if (numTasks_ >= TPP_SCHEDULER_MAX_TASKS) {
+        schedulerLogger.error("no room for task %s", name);
+        return -1;
+    }
+    schedulerTask *pTask = &tasks_[numTasks_];
+    pTask->name = name;
+    pTask->pFunction = pFunction;
+    pTask->periodMS = periodMS;
+    pTask->nextRunMS = millis() + delayMS;
+    pTask->priority = priority;
+    pTask->budgetUS = budgetUS;
+    pTask->armed = true;
+    pTask->runs = 0;
+    pTask->totalUS = 0;
+    pTask->maxUS = 0;
+    pTask->overruns = 0;
+    pTask->deferred = 0;
+    return numTasks_++;
+}
+
+// -------- runIn ------------
+// the task runs delayMS from now, whether or not it was already due.
+// A periodic task continues at its period from then.
+void TPP_Scheduler::runIn(int task, unsigned long delayMS) {
+    if ((task < 0) || (task >= numTasks_)) {
+        return;
+    }
+    tasks_[task].nextRunMS = millis() + delayMS;
+    tasks_[task].armed = true;
+}
+
+// -------- cancel ------------
+// the task does not run until runIn() is called for it
+void TPP_Scheduler::cancel(int task) {
+    if ((task < 0) || (task >= numTasks_)) {
+        return;
+    }
+    tasks_[task].armed = false;
+}
+
+// -------- setPeriod ------------
+// a periodic task runs every periodMS from its next run on
+void TPP_Scheduler::setPeriod(int task, unsigned long periodMS) {
+    if ((task < 0) || (task >= numTasks_) || (tasks_[task].periodMS == 0) || (periodMS == 0)) {
+        return;
+    }
+    tasks_[task].periodMS = periodMS;
+    if ((long)(tasks_[task].nextRunMS - (millis() + periodMS)) > 0) {
+        tasks_[task].nextRunMS = millis() + periodMS;
+    }
+}
+
+// -------- run ------------
+// called from loop() to run the tasks that are due, the most important first.
+// Each task runs at most once per call.
+void TPP_Scheduler::run() {
+
+    unsigned long startUS = micros();
+    unsigned long nowMS = millis();
+    uint32_t ranMask = 0;
+
+    int task;
+    while ((task = nextDueTask(nowMS, ranMask)) >= 0) {
+
+        if ((ranMask != 0) && (micros() - startUS > TPP_SCHEDULER_LOOP_BUDGET_US)) {
+            // out of time; everything still due waits for the next call
+            for (int i = 0; i < numTasks_; i++) {
+                if (!(ranMask & (1UL << i)) && tasks_[i].armed && ((long)(nowMS - tasks_[i].nextRunMS) >= 0)) {
+                    tasks_[i].deferred++;
+                }
+            }
+            return;
+        }
+        ranMask |= 1UL << task;
+        runTask(task);
+    }
+}
+
+/* ------------------------------ */
+// the most important task that is due and has not run in this call of run()
+// returns -1 if there is none
+int TPP_Scheduler::nextDueTask(unsigned long nowMS, uint32_t ranMask) {
+
+    int best = -1;
+    for (int i = 0; i < numTasks_; i++) {
+        if (       tasks_[i].armed
+                && !(ranMask & (1UL << i))
+                && ((long)(nowMS - tasks_[i].nextRunMS) >= 0)
+                && ((best < 0) || (tasks_[i].priority < tasks_[best].priority))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* ------------------------------ */
+// call the task, time it and work out when it runs next
+void TPP_Scheduler::runTask(int task) {
+
+    schedulerTask *pTask = &tasks_[task];
+
+    // a one-shot task may arm itself again while it runs
+    if (pTask->periodMS == 0) {
+        pTask->armed = false;
+    } else {
+        pTask->nextRunMS += pTask->periodMS;
+        if ((long)(millis() - pTask->nextRunMS) >= 0) {
+            // more than a period behind; skip the runs that were missed
+            pTask->nextRunMS = millis() + pTask->periodMS;
+        }
+    }
+
+    unsigned long startUS = micros();
+    pTask->pFunction();
+    unsigned long elapsedUS = micros() - startUS;
+
+    pTask->runs++;
+    pTask->totalUS += elapsedUS;
+    if (elapsedUS > pTask->budgetUS) {
+        pTask->overruns++;
+        if (elapsedUS > pTask->maxUS) {
+            schedulerLogger.warn("task %s took %lu us, budget %lu us", pTask->name, elapsedUS, pTask->budgetUS);
+        }
+    }
+    pTask->maxUS = max(pTask->maxUS, elapsedUS);
+}
+
+// -------- msUntilNextDue ------------
+// how long until the next armed task is due; 0 if one is due now
+unsigned long TPP_Scheduler::msUntilNextDue() {
+
+    unsigned long nowMS = millis();
+    unsigned long untilMS = ULONG_MAX;
+    for (int i = 0; i < numTasks_; i++) {
+        if (!tasks_[i].armed) {
+            continue;
+        }
+        long dueInMS = (long)(tasks_[i].nextRunMS - nowMS);
+        if (dueInMS <= 0) {
+            return 0;
+        }
+        untilMS = min(untilMS, (unsigned long)dueInMS);
+    }
+    return untilMS;
+}
+
+// -------- logStats ------------
+// log how often each task ran and how long it took
+void TPP_Scheduler::logStats() {
+    for (int i = 0; i < numTasks_; i++) {
+        const schedulerTask &task = tasks_[i];
+        schedulerLogger.info("%-12s runs %lu avg %lu us max %lu us overruns %lu deferred %lu", task.name,
+            task.runs, task.totalUS / max(task.runs, 1UL), task.maxUS, task.overruns, task.deferred);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+    TPP_Scheduler.h
+
+    Team Practical Project cooperative scheduler for the main loop
+
+    Each part of the head registers the work it does as a task: a function that
+    is called every periodMS, or once after a delay. loop() calls run(), which
+    calls the tasks that are due, the most important first. Tasks are never
+    interrupted, so each must do a bounded piece of work and return.
+
+    Priority 0 is the most important. Once the tasks run in one call of run() have
+    taken TPP_SCHEDULER_LOOP_BUDGET_US, the rest of the due tasks wait for the next
+    call, so one slow pass cannot hold up the servos for long. Each task also has
+    its own budget; a run that takes longer is counted as an overrun and logged
+    when it sets a new maximum.
+
+    A periodic task that falls more than a period behind skips the runs it missed
+    rather than running several times in a row.
+
+    Key methods
+        .addPeriodic()  called in setup(); returns the task number, -1 if there is no room
+        .addOneShot()   a task that runs once, delayMS from now
+        .runIn()        (re)arm a task to run delayMS from now
+        .setPeriod()    change how often a periodic task runs
+        .run()          called from loop()
+        .msUntilNextDue()   how long loop() may sleep before run() has work
+        .logStats()     log how often each task ran and how long it took
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_SCHEDULER_H
+#define _TPP_SCHEDULER_H
+
+#include <Particle.h>
+
+#define TPP_SCHEDULER_MAX_TASKS 12          // at most 32
+#define TPP_SCHEDULER_LOOP_BUDGET_US 5000   // the most run() spends before leaving tasks for the next call
+
+typedef void (*schedulerTaskFunction)();
+
+/*!
+ *  @brief  Class that calls the tasks of the main loop when they are due
+ */
+class TPP_Scheduler {
+public:
+    int  addPeriodic(const char *name, schedulerTaskFunction pFunction, unsigned long periodMS,
+            int priority, unsigned long budgetUS);
+    int  addOneShot(const char *name, schedulerTaskFunction pFunction, unsigned long delayMS,
+            int priority, unsigned long budgetUS);
+    void runIn(int task, unsigned long delayMS);
+    void cancel(int task);
+    void setPeriod(int task, unsigned long periodMS);
+    void run();
+    unsigned long msUntilNextDue();
+    void logStats();
+
+private:
+    typedef struct {
+        const char *name;
+        schedulerTaskFunction pFunction;
+        unsigned long periodMS;     // 0 for a one-shot task
+        unsigned long nextRunMS;
+        int priority;               // 0 is the most important
+        unsigned long budgetUS;
+        bool armed;
+
+        // statistics
+        unsigned long runs;
+        unsigned long totalUS;
+        unsigned long maxUS;
+        unsigned long overruns;     // runs that took longer than budgetUS
+        unsigned long deferred;     // times it was due but the loop budget was spent
+    } schedulerTask;
+
+    int  addTask(const char *name, schedulerTaskFunction pFunction, unsigned long periodMS,
+            unsigned long delayMS, int priority, unsigned long budgetUS);
+    int  nextDueTask(unsigned long nowMS, uint32_t ranMask);
+    void runTask(int task);
+
+    schedulerTask tasks_[TPP_SCHEDULER_MAX_TASKS];
+    int numTasks_ = 0;
+};
+
+#endif
@@ -19,194 +19,906 @@
 2022 02 23  change to reduce chatter. 
 2022 11 27  change to poi detection - must be closer than calibration distance
             getPOITemporalFiltered has better TRACE level logging
+2026 10 18  getPOI reports a distance weighted centroid of the target with sub-zone precision
+            getPOI follows blobs with TPP_Tracker and stays focused on the same person
+            getPOITemporalFiltered uses the track age instead of function statics
+            sensor state is held in the instance so several sensors can be used
+            frames can be recorded with TPP_TOFRecorder and replayed through getPOI
+            the calibration is kept in EEPROM and reused at boot if the scene still matches
+            foreground is found against an adaptive background (TPP_Background) that
+            follows changes in the scene, instead of the calibration frame and NOISE_RANGE
+            larger Wire buffers and bulk writes for a faster sensor firmware download;
+            initTOF logs the time of each phase
+            init is a state machine advanced by serviceInit, so the caller keeps running
+            while the sensor comes up; a missing sensor fails init instead of freezing
+            sensor I/O holds the Wire lock so the sensor can be read from its own thread
+            (TPP_TOFThread); the POI carries the target velocity for prediction
+            ROI mode: while a person is followed only the zones around them go through
+            the background and the tracker; the rest get a one compare foreground test
+            frames that have not changed since the last empty frame are skipped
+            confidence mode: zones are weighed by sigma, signal and reflectance
+            with several targets per zone (VL53L5CX_NB_TARGET_PER_ZONE) the nearest good one is used
+            the zone search is specialised for 4x4 and 8x8 with compile time neighbour tables
+            a crosstalk calibration can be made once and is kept in EEPROM and applied at init
+            a sensor that stops sending frames or has I2C errors restarts ranging, then re-inits
+            on its own with the calibration it has, instead of needing a reboot
+            reading and processing a frame can be profiled, see TPP_Profiler.h
+            a lower ranging rate for an empty room (setIdleRate); a hit goes back to the full rate
 
 */
 
 #include <TPP_TOF.h>
-
-SparkFun_VL53L5CX myImager;
-VL53L5CX_ResultsData measurementData; // Result data class structure, 1356 byes of RAM
+#include <TPP_TOFRecorder.h>
+#include <TPP_DeferredLog.h>
 
 Logger theLogger("app.TOF");
+Logger initLogger("app.TOF.init");
 
-// noise range in measured data.  Anything within +/- 50 of the calibrations is noise
+// noise range in measured data. An average distance this close to the sensor is noise.
+// The noise band of each zone around its background is learned by TPP_Background.
 const uint16_t NOISE_RANGE = 50;
 const uint16_t MAX_CALIBRATION = 2000;  // anything greater is set to 2000 mm
 
-// declare 8x8 array of calibration values
-int32_t calibration[64];
+// a stored calibration is reused if no more than CALIBRATION_MISMATCHED_ZONES
+// zones of the first frame differ from it by more than CALIBRATION_MATCH_MM
+const int CALIBRATION_MATCH_MM = 100;
+const int CALIBRATION_MISMATCHED_ZONES = 4;
+
+// the range of each part of the zone confidence, from no confidence to full
+const int32_t CONFIDENCE_BAD_SIGMA_MM = 30;
+const int32_t CONFIDENCE_GOOD_SIGMA_MM = 5;
+const int32_t CONFIDENCE_BAD_SIGNAL = 1;        // kcps per SPAD
+const int32_t CONFIDENCE_GOOD_SIGNAL = 10;
+const int32_t CONFIDENCE_BAD_REFLECTANCE = 1;   // percent
+const int32_t CONFIDENCE_GOOD_REFLECTANCE = 8;
+const int CONFIDENCE_OTHER_STATUS = 75;         // the most for status 6 or 9
+
+const uint32_t CALIBRATION_MAGIC = 0x43464F54;   // "TOFC"
+const uint8_t CALIBRATION_VERSION = 1;
+
+// the background calibration as kept in EEPROM, one for each sensor
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t resolution;
+    uint16_t checksum;      // crc16TOFFrame of distanceMM
+    int16_t distanceMM[64];
+} storedCalibration;
+
+static_assert(sizeof(storedCalibration) == TOF_EEPROM_CALIBRATION_BYTES, "update TOF_EEPROM_CALIBRATION_BYTES");
+
+const uint32_t XTALK_MAGIC = 0x58464F54;        // "TOFX"
+const uint8_t XTALK_VERSION = 1;
+
+// the crosstalk calibration as kept in EEPROM, one for each sensor
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t unused;
+    uint16_t checksum;      // crc16TOFFrame of data
+    uint8_t data[VL53L5CX_XTALK_BUFFER_SIZE];
+} storedXtalk;
+
+static_assert(sizeof(storedXtalk) == TOF_EEPROM_XTALK_BYTES, "update TOF_EEPROM_XTALK_BYTES");
+
+// too big for the stack of the TOF thread. Only used while a sensor is being
+// brought up or calibrated, which is one sensor at a time.
+static storedXtalk xtalkBuffer;
+
+// The default Wire buffers are 32 bytes, so the 86 KB sensor firmware would go
+// in almost 3000 transfers. Device OS calls this once at startup for larger buffers.
+hal_i2c_config_t acquireWireBuffer() {
+    static uint8_t rxBuffer[TOF_WIRE_BUFFER_SIZE];
+    static uint8_t txBuffer[TOF_WIRE_BUFFER_SIZE];
+    hal_i2c_config_t config = {
+        .size = sizeof(hal_i2c_config_t),
+        .version = HAL_I2C_CONFIG_VERSION_1,
+        .rx_buffer = rxBuffer,
+        .rx_buffer_size = TOF_WIRE_BUFFER_SIZE,
+        .tx_buffer = txBuffer,
+        .tx_buffer_size = TOF_WIRE_BUFFER_SIZE
+    };
+    return config;
+}
+
+/* ------------------------------ */
+// The per target results of a zone are at zone * TARGETS .. zone * TARGETS + TARGETS - 1.
+// Moves the nearest good target of each zone to index zone, so the frame can be used
+// as if the sensor reported one target per zone. Zone n is written after zones below
+// n were read from, so this can be done in place. A zone without a good target
+// keeps its first target.
+template <int TARGETS>
+static void keepNearestTargets(VL53L5CX_ResultsData *pFrame) {
+
+    for (int zone = 0; zone < VL53L5CX_RESOLUTION_8X8; zone++) {
+        int first = zone * TARGETS;
+        int nearest = -1;
+        for (int target = first; target < first + TARGETS; target++) {
+            int status = pFrame->target_status[target];
+            if (((status != 5) && (status != 6) && (status != 9)) || (pFrame->distance_mm[target] <= 0)) {
+                continue;
+            }
+            if ((nearest < 0) || (pFrame->distance_mm[target] < pFrame->distance_mm[nearest])) {
+                nearest = target;
+            }
+        }
+        if (nearest < 0) {
+            nearest = first;
+        }
+        pFrame->distance_mm[zone] = pFrame->distance_mm[nearest];
+        pFrame->target_status[zone] = pFrame->target_status[nearest];
+        pFrame->range_sigma_mm[zone] = pFrame->range_sigma_mm[nearest];
+        pFrame->signal_per_spad[zone] = pFrame->signal_per_spad[nearest];
+        pFrame->reflectance[zone] = pFrame->reflectance[nearest];
+    }
+}
+
+// the sensor reports one target per zone; the frame is already as we want it
+template <>
+void keepNearestTargets<1>(VL53L5CX_ResultsData *pFrame) {
+}
+
+/* ------------------------------ */
+// log how long a phase of init took and start timing the next
+static void logInitPhase(int sensorIndex, const char *phase, unsigned long *pPhaseStartMS) {
+    unsigned long now = millis();
+    initLogger.info("sensor %d init %s took %lu ms", sensorIndex, phase, now - *pPhaseStartMS);
+    *pPhaseStartMS = now;
+}
 
-#define RANGING_FREQUENCY 14  // times per second for sensor to sample the environment
 #define FRAMES_FOR_GOOD_HIT 2 // number of subsequent frames needed to consider a hit good 
                               // this filters out spurious hits
 
-int imageResolution; // read this back from the sensor
-int imageWidth; // read this back from the sensor
+const unsigned long REBOOT_MS = 100;            // the sensor needs this after its reboot sequence
+const unsigned long INIT_POLL_MS = 5;           // how often to ask for a frame during init
+const unsigned long FIRST_FRAME_TIMEOUT_MS = 2000;
+const int MAX_CALIBRATION_FRAMES = 500;
+
+// a sensor is faulty if it sends no frame for FRAME_TIMEOUT_MS, about 7 frame
+// periods, or has MAX_I2C_ERRORS in a row. A failed re-init is retried after RECOVERY_RETRY_MS.
+// At the idle rate the timeout is the same number of the longer frame periods.
+const unsigned long FRAME_TIMEOUT_MS = 500;
+const int MAX_I2C_ERRORS = 3;
+const unsigned long RECOVERY_RETRY_MS = 5000;
 
 // -------- initTOF ----------
 // called once to initialize the sensor
-// may take up to 10 seconds to return
-// returns True if sensor was initialized; False for error
-void TPP_TOF::initTOF(){
+// may take up to 10 seconds to return, much less if the stored calibration is used
+// Use startInit and serviceInit instead to keep running while the sensor comes up.
+void TPP_TOF::initTOF(uint8_t i2cAddress, int sensorIndex){
+
+    startInit(i2cAddress, sensorIndex);
+    while ((serviceInit() != TOF_INIT_READY) && (initState_ != TOF_INIT_FAILED)) {
+        delay(1);
+    }
+}
+
+// -------- startInit ----------
+// starts bringing up the sensor. Returns at once; call serviceInit until
+// it returns TOF_INIT_READY or TOF_INIT_FAILED.
+// The sensor comes out of reset at TOF_DEFAULT_ADDRESS. If i2cAddress is different
+// the sensor is moved there; any other sensor still at the default address must be
+// held in reset until init is done.
+// sensorIndex picks where the calibration of this sensor is kept in EEPROM.
+void TPP_TOF::startInit(uint8_t i2cAddress, int sensorIndex){
+
+    sensorIndex_ = sensorIndex;
+    i2cAddress_ = i2cAddress;
 
-    imageResolution = 0; // read this back from the sensor
-    imageWidth = 0; // read this back from the sensor
+    imageResolution_ = 0; // read this back from the sensor
+    imageWidth_ = 0; // read this back from the sensor
 
     Serial.println("SparkFun VL53L5CX Imager Example");
-    
-    Serial.println("Initializing sensor board. This can take up to 10s. Please wait.");
-    if (myImager.begin() == false) {
-        Serial.println(F("Sensor not found - check your wiring. Freezing"));
-        while (1) {
-            delay(10); // allow remote reset to happen
-        } ;
+    Serial.println("Initializing sensor board.");
+
+    initStartMS_ = millis();
+    phaseStartMS_ = initStartMS_;
+    initState_ = TOF_INIT_REBOOT;
+}
+
+// -------- serviceInit ----------
+// called every time through loop() until the sensor is ready. Each call does
+// one step of bringing up the sensor, or nothing if the step is waiting.
+// returns the state after the step
+tofInitState TPP_TOF::serviceInit() {
+
+    if ((initState_ == TOF_INIT_OFF) || (initState_ == TOF_INIT_READY) || (initState_ == TOF_INIT_FAILED)) {
+        return initState_;
     }
-    
-    myImager.setResolution(64); //Enable all 64 pads - 8 x 8 array of readings
-    
-    imageResolution = myImager.getResolution(); //Query sensor for current resolution - either 4x4 or 8x8
-    imageWidth = sqrt(imageResolution); //Calculate printing width
+    WITH_LOCK(Wire) {
+        initStep();
+    }
+    return initState_;
+}
 
-    // debug print statement - are we communicating with the module
-    String theResolution = "Resolution = ";
-    theResolution += String(imageResolution);
-    Serial.println(theResolution);
+/* ------------------------------ */
+// one step of serviceInit, with the bus locked
+void TPP_TOF::initStep() {
+
+    switch (initState_) {
+
+    case TOF_INIT_REBOOT: {
+        myImager_.setWireMaxPacketSize(TOF_WIRE_BUFFER_SIZE);
+        // after a fault the sensor is most likely still at its own address. If it
+        // was reset it is back at the default one.
+        bool found = false;
+        if (recovering_ && (i2cAddress_ != TOF_DEFAULT_ADDRESS)) {
+            found = myImager_.beginReboot(i2cAddress_);
+        }
+        if (!found && !myImager_.beginReboot()) {
+            initFailed("not found - check your wiring");
+            break;
+        }
+        stepMS_ = millis();
+        initState_ = TOF_INIT_WAKEUP;
+        break;
+    }
 
-    // XXX test out target order and sharpener changes
-    // myImager.setSharpenerPercent(20);
-    // myImager.setTargetOrder(SF_VL53L5CX_TARGET_ORDER::CLOSEST);
-    // myImager.setTargetOrder(SF_VL53L5CX_TARGET_ORDER::STRONGEST);
+    case TOF_INIT_WAKEUP:
+        if (millis() - stepMS_ < REBOOT_MS) {
+            break;
+        }
+        if (!myImager_.beginWakeup()) {
+            initFailed("did not boot");
+            break;
+        }
+        initState_ = TOF_INIT_DOWNLOAD;
+        break;
 
-    myImager.setRangingFrequency(RANGING_FREQUENCY);
+    case TOF_INIT_DOWNLOAD:
+        if (!myImager_.beginDownload(TOF_INIT_DOWNLOAD_BYTES)) {
+            initFailed("firmware download failed");
+            break;
+        }
+        if (myImager_.getFirmwareBytesRemaining() == 0) {
+            initState_ = TOF_INIT_FINISH;
+        }
+        break;
 
-    myImager.startRanging();
+    case TOF_INIT_FINISH:
+        if (!myImager_.beginFinish()) {
+            initFailed("did not start its firmware");
+            break;
+        }
+        logInitPhase(sensorIndex_, "firmware download", &phaseStartMS_);
+        initState_ = TOF_INIT_CONFIGURE;
+        break;
+
+    case TOF_INIT_CONFIGURE:
+        if (myImager_.getAddress() != i2cAddress_) {
+            if (myImager_.setAddress(i2cAddress_) == false) {
+                theLogger.error("could not move sensor to address 0x%02x", i2cAddress_);
+            }
+        }
 
-    // fill in the calibration data array
+        myImager_.setResolution(64); //Enable all 64 pads - 8 x 8 array of readings
+        applyStoredXtalk();
 
-    // wait for data to be ready
-    do {
-        // do nothing here, wait for data to be ready
-        delay(5); //Small delay between polling
-    } while(myImager.isDataReady() != true);
+        imageResolution_ = myImager_.getResolution(); //Query sensor for current resolution - either 4x4 or 8x8
+        imageWidth_ = (imageResolution_ == VL53L5CX_RESOLUTION_8X8) ? 8 : 4; //Calculate printing width
 
-    // data is now ready
+        // debug print statement - are we communicating with the module
+        Serial.printlnf("Resolution = %d", imageResolution_);
+        initState_ = TOF_INIT_START_RANGING;
+        break;
 
-    // look for two successive frames that are similar
-    bool gotSimilarFrames = false;
-    int frameCount = 0;
-    int sumOfDistances = 0;
-    int lastFrameSum = 0;
-    do {
-        if (myImager.isDataReady()) {
-            if(myImager.getRangingData(&measurementData)) {
-                frameCount++;
-                sumOfDistances = 0;
-                for(int i=0; i<imageResolution; i++) {
-                    sumOfDistances += measurementData.distance_mm[i];
-                }
+    case TOF_INIT_START_RANGING:
+        // XXX test out target order and sharpener changes
+        // myImager_.setSharpenerPercent(20);
+        // myImager_.setTargetOrder(SF_VL53L5CX_TARGET_ORDER::CLOSEST);
+        // myImager_.setTargetOrder(SF_VL53L5CX_TARGET_ORDER::STRONGEST);
 
-                theLogger.trace("Sum of mm: %d", sumOfDistances);
+        myImager_.setRangingFrequency(RANGING_FREQUENCY);
+        rangingFrequency_ = RANGING_FREQUENCY;
+        logInitPhase(sensorIndex_, "configuration", &phaseStartMS_);
 
-                if (abs(lastFrameSum - sumOfDistances) < 500) {
-                    gotSimilarFrames = true;
-                    theLogger.info("calibration done. it took %d frames.", frameCount);
-                } else {
-                    lastFrameSum = sumOfDistances;
-                }
+        myImager_.startRanging();
+        stepMS_ = millis();
+        initState_ = TOF_INIT_FIRST_FRAME;
+        break;
 
+    case TOF_INIT_FIRST_FRAME:
+        if (millis() - lastPollMS_ < INIT_POLL_MS) {
+            break;
+        }
+        lastPollMS_ = millis();
+        if (!myImager_.isDataReady()) {
+            if (millis() - stepMS_ > FIRST_FRAME_TIMEOUT_MS) {
+                initFailed("sent no frame");
             }
+            break;
         }
+        logInitPhase(sensorIndex_, "first frame", &phaseStartMS_);
 
-        if (frameCount > 500){
-            theLogger.error("could not calibrate");
-            gotSimilarFrames = true;
+        // after a fault the calibration we have is still good
+        if (recovering_) {
+            initDone();
+            break;
         }
 
-        delay(5); // so we're not in a tight loop
+        // a background stored by an earlier boot saves waiting for the scene to settle
+        if (useStoredCalibration()) {
+            logInitPhase(sensorIndex_, "stored calibration", &phaseStartMS_);
+            initDone();
+            break;
+        }
+        calibrationFrames_ = 0;
+        lastFrameSum_ = 0;
+        initState_ = TOF_INIT_CALIBRATE;
+        break;
+
+    case TOF_INIT_CALIBRATE: {
+        if (millis() - lastPollMS_ < INIT_POLL_MS) {
+            break;
+        }
+        lastPollMS_ = millis();
+        bool calibrated = false;
+        if (calibrateBackground(&calibrated)) {
+            if (calibrated) {
+                logInitPhase(sensorIndex_, "calibration", &phaseStartMS_);
+                saveCalibration();
+            }
+            initDone();
+        }
+        break;
+    }
 
-    } while (!gotSimilarFrames);
+    default:
+        break;
+    }
+}
 
+/* ------------------------------ */
+// the sensor is not usable. getPOI will have no data.
+void TPP_TOF::initFailed(const char *step) {
+    theLogger.error("sensor %d %s, error %d, value %lu", sensorIndex_, step,
+        (int)myImager_.lastError.lastErrorCode, (unsigned long)myImager_.lastError.lastErrorValue);
+    initState_ = TOF_INIT_FAILED;
+}
+
+/* ------------------------------ */
+// the calibration is known; start looking for people
+void TPP_TOF::initDone() {
+
+    initLogger.info("sensor %d init took %lu ms", sensorIndex_, millis() - initStartMS_);
+
+    lastGoodFrameMS_ = millis();
+    i2cErrors_ = 0;
+    restarted_ = false;
+    if (recovering_) {
+        // the learned background is kept
+        theLogger.info("sensor %d recovered in %lu ms", sensorIndex_, millis() - recoveryStartMS_);
+        recovering_ = false;
+        initState_ = TOF_INIT_READY;
+        return;
+    }
+
+    background_.init(calibration_, imageResolution_);
+    selectSearch();
+    initState_ = TOF_INIT_READY;
+
+#ifdef CONTINUOUS_DEBUG_DISPLAY
+    moveTerminalCursorDown(20);
+#endif
+    Serial.println("Calibration data:");
+    prettyPrint(calibration_);
+    Serial.println("End of calibration data\n");
+}
+
+/* ------------------------------ */
+// fill in the calibration data array from the scene in front of the sensor
+// called for each frame until it returns true. *pCalibrated is set false if
+// the scene did not settle.
+bool TPP_TOF::calibrateBackground(bool *pCalibrated) {
+
+    // look for two successive frames that are similar
+    bool gotSimilarFrames = false;
+    *pCalibrated = false;
+
+    if (myImager_.isDataReady()) {
+        if(readFrame()) {
+            calibrationFrames_++;
+            int sumOfDistances = 0;
+            for(int i=0; i<imageResolution_; i++) {
+                sumOfDistances += measurementData_.distance_mm[i];
+            }
+
+            DEFERRED_TRACE(theLogger, "Sum of mm: %d", sumOfDistances);
+
+            if (abs(lastFrameSum_ - sumOfDistances) < 500) {
+                gotSimilarFrames = true;
+                *pCalibrated = true;
+                theLogger.info("calibration done. it took %d frames.", calibrationFrames_);
+            } else {
+                lastFrameSum_ = sumOfDistances;
+            }
+
+        }
+    }
+
+    if (calibrationFrames_ > MAX_CALIBRATION_FRAMES){
+        theLogger.error("could not calibrate");
+        gotSimilarFrames = true;
+    }
+
+    if (!gotSimilarFrames) {
+        return false;
+    }
+
+    // read out the measured data into an array
+    for(int i = 0; i < 64; i++) {
     
-    //if (myImager.getRangingData(&measurementData)) { //Read distance data into array
-    
-        // read out the measured data into an array
-        for(int i = 0; i < 64; i++) {
-        
-            calibration[i] = measurementData.distance_mm[i];
+        calibration_[i] = measurementData_.distance_mm[i];
+
+        // adjust for calibration values being 0 or too long for measurement
+        if( (calibration_[i] == 0) || (calibration_[i] > MAX_CALIBRATION) ) {
+            calibration_[i] = MAX_CALIBRATION;
+        }
+
+    }
+    return true;
+}
 
-            // adjust for calibration values being 0 or too long for measurement
-            if( (calibration[i] == 0) || (calibration[i] > MAX_CALIBRATION) ) {
-                calibration[i] = MAX_CALIBRATION;
+/* ------------------------------ */
+// read the calibration of this sensor from EEPROM and check it against one
+// frame of the scene. Zones that are now farther away take the new distance.
+// returns false if there is no stored calibration or the scene has changed
+bool TPP_TOF::useStoredCalibration() {
+
+    storedCalibration stored;
+    EEPROM.get(calibrationAddress(), stored);
+
+    if (       (stored.magic != CALIBRATION_MAGIC)
+            || (stored.version != CALIBRATION_VERSION)
+            || (stored.resolution != imageResolution_)
+            || (stored.checksum != crc16TOFFrame((const uint8_t *)stored.distanceMM, sizeof(stored.distanceMM)))) {
+        theLogger.info("sensor %d has no stored calibration", sensorIndex_);
+        return false;
+    }
+
+    // the frame we waited for in serviceInit
+    if (!readFrame()) {
+        return false;
+    }
+
+    int mismatchedZones = 0;
+    bool changed = false;
+    for (int i = 0; i < imageResolution_; i++) {
+
+        int32_t measured = measurementData_.distance_mm[i];
+        if ((measured == 0) || (measured > MAX_CALIBRATION)) {
+            measured = MAX_CALIBRATION;
+        }
+
+        calibration_[i] = stored.distanceMM[i];
+        if (abs(measured - calibration_[i]) > CALIBRATION_MATCH_MM) {
+            mismatchedZones++;
+            // something closer may be a person, but farther is always background
+            if (measured > calibration_[i]) {
+                calibration_[i] = measured;
+                changed = true;
             }
+        }
+    }
+
+    if (mismatchedZones > CALIBRATION_MISMATCHED_ZONES) {
+        theLogger.info("sensor %d scene has changed in %d zones, recalibrating", sensorIndex_, mismatchedZones);
+        return false;
+    }
+    if (changed) {
+        saveCalibration();
+    }
+    return true;
+}
+
+/* ------------------------------ */
+// write the calibration of this sensor to EEPROM
+void TPP_TOF::saveCalibration() {
+
+    storedCalibration stored;
+    stored.magic = CALIBRATION_MAGIC;
+    stored.version = CALIBRATION_VERSION;
+    stored.resolution = imageResolution_;
+    for (int i = 0; i < 64; i++) {
+        stored.distanceMM[i] = calibration_[i];
+    }
+    stored.checksum = crc16TOFFrame((const uint8_t *)stored.distanceMM, sizeof(stored.distanceMM));
 
+    EEPROM.put(calibrationAddress(), stored);
+}
+
+// -------- forgetCalibration ------------
+// the next init will calibrate from the scene instead of using the stored
+// calibration. Use after the head has been moved.
+void TPP_TOF::forgetCalibration() {
+    uint32_t noMagic = 0;
+    EEPROM.put(calibrationAddress(), noMagic);
+}
+
+/* ------------------------------ */
+int TPP_TOF::calibrationAddress() {
+    return TOF_EEPROM_CALIBRATION_ADDRESS + (sensorIndex_ * sizeof(storedCalibration));
+}
+
+/* ------------------------------ */
+// give the sensor the crosstalk calibration from EEPROM, if there is one.
+// Otherwise it keeps ST's default. Call with the bus locked, before ranging starts.
+void TPP_TOF::applyStoredXtalk() {
+
+    if (xtalkAddress() + (int)sizeof(storedXtalk) > (int)EEPROM.length()) {
+        return;
+    }
+    EEPROM.get(xtalkAddress(), xtalkBuffer);
+    if (       (xtalkBuffer.magic != XTALK_MAGIC)
+            || (xtalkBuffer.version != XTALK_VERSION)
+            || (xtalkBuffer.checksum != crc16TOFFrame(xtalkBuffer.data, sizeof(xtalkBuffer.data)))) {
+        initLogger.info("sensor %d has no stored crosstalk calibration", sensorIndex_);
+        return;
+    }
+    if (!myImager_.setXtalkCalibrationData(xtalkBuffer.data)) {
+        theLogger.error("sensor %d did not take its crosstalk calibration, error %lu", sensorIndex_,
+            (unsigned long)myImager_.lastError.lastErrorValue);
+        return;
+    }
+    initLogger.info("sensor %d using stored crosstalk calibration", sensorIndex_);
+}
+
+/* ------------------------------ */
+// measure the crosstalk of the cover glass and keep it in EEPROM. Needs the
+// TOF_XTALK_... target in front of the sensor. Takes several seconds, during
+// which the bus is held. Ranging starts again with the new calibration.
+void TPP_TOF::calibrateXtalk() {
+
+    if (xtalkAddress() + (int)sizeof(storedXtalk) > (int)EEPROM.length()) {
+        theLogger.error("sensor %d: no room in EEPROM for a crosstalk calibration", sensorIndex_);
+        return;
+    }
+    theLogger.info("sensor %d crosstalk calibration started", sensorIndex_);
+    unsigned long startMS = millis();
+
+    WITH_LOCK(Wire) {
+        myImager_.stopRanging();
+        if (       myImager_.calibrateXtalk(TOF_XTALK_REFLECTANCE_PERCENT, TOF_XTALK_SAMPLES, TOF_XTALK_DISTANCE_MM)
+                && myImager_.getXtalkCalibrationData(xtalkBuffer.data)) {
+            xtalkBuffer.magic = XTALK_MAGIC;
+            xtalkBuffer.version = XTALK_VERSION;
+            xtalkBuffer.unused = 0;
+            xtalkBuffer.checksum = crc16TOFFrame(xtalkBuffer.data, sizeof(xtalkBuffer.data));
+            EEPROM.put(xtalkAddress(), xtalkBuffer);
+            myImager_.setXtalkCalibrationData(xtalkBuffer.data);
+            theLogger.info("sensor %d crosstalk calibration took %lu ms", sensorIndex_, millis() - startMS);
+        } else {
+            theLogger.error("sensor %d crosstalk calibration failed, error %d, value %lu", sensorIndex_,
+                (int)myImager_.lastError.lastErrorCode, (unsigned long)myImager_.lastError.lastErrorValue);
         }
-#ifdef CONTINUOUS_DEBUG_DISPLAY
-        moveTerminalCursorDown(20);
-#endif
-        Serial.println("Calibration data:");
-        prettyPrint(calibration);
-        Serial.println("End of calibration data\n");
-   // }
 
-   
+        // the calibration leaves the sensor in its own configuration
+        myImager_.setResolution(imageResolution_);
+        myImager_.setRangingFrequency(rangingFrequency_);
+        myImager_.startRanging();
+    }
+    haveReference_ = false;
+    lastGoodFrameMS_ = millis();
+}
+
+// -------- forgetXtalkCalibration ------------
+// the next init leaves the sensor with ST's default crosstalk calibration
+void TPP_TOF::forgetXtalkCalibration() {
+    if (xtalkAddress() + (int)sizeof(uint32_t) <= (int)EEPROM.length()) {
+        uint32_t noMagic = 0;
+        EEPROM.put(xtalkAddress(), noMagic);
+    }
+}
+
+/* ------------------------------ */
+int TPP_TOF::xtalkAddress() {
+    return TOF_EEPROM_XTALK_ADDRESS + (sensorIndex_ * sizeof(storedXtalk));
+}
 
 
+/* ------------------------------ */
+// the distance of a zone if it is good, -1 if its status is bad, -2 if out of range
+// In confidence mode a zone with too little confidence has a bad status.
+int32_t TPP_TOF::checkZone(const VL53L5CX_ResultsData &frame, int zone) {
+
+    int statusCode = frame.target_status[zone];
+    int measuredData = frame.distance_mm[zone];
 
+    // only good data if status code is 5, 6 or 9
+    if( (statusCode != 5) && (statusCode != 9) && (statusCode != 6)) { // TOF measurement is bad
+        return -1;
+    }
+    if (confidenceMode_ && (zoneConfidence(frame, zone) < TOF_MIN_CONFIDENCE)) {
+        return -1;
+    }
+    if ( (measuredData == 0) || (measuredData > MAX_CALIBRATION) ) { //data out of range
+        return -2;
+    }
+    return measuredData;
 }
 
+/* ------------------------------ */
+// how much of the way value is from bad to good, 0 to 100
+static int scaleConfidence(int32_t value, int32_t bad, int32_t good) {
+    return constrain((int)(((value - bad) * 100) / (good - bad)), 0, 100);
+}
+
+/* ------------------------------ */
+// 0 to 100, how sure the sensor is of the distance of a zone. The weakest of
+//   the spread of the distance (sigma)
+//   the strength of the return (signal per SPAD)
+//   how much of the light the target reflects
+//   the status; 6 and 9 are less certain than 5
+int TPP_TOF::zoneConfidence(const VL53L5CX_ResultsData &frame, int zone) {
+
+    int confidence = scaleConfidence(frame.range_sigma_mm[zone], CONFIDENCE_BAD_SIGMA_MM, CONFIDENCE_GOOD_SIGMA_MM);
+    confidence = min(confidence, scaleConfidence(frame.signal_per_spad[zone], CONFIDENCE_BAD_SIGNAL, CONFIDENCE_GOOD_SIGNAL));
+    confidence = min(confidence, scaleConfidence(frame.reflectance[zone], CONFIDENCE_BAD_REFLECTANCE, CONFIDENCE_GOOD_REFLECTANCE));
+    if (frame.target_status[zone] != 5) {
+        confidence = min(confidence, CONFIDENCE_OTHER_STATUS);
+    }
+    return confidence;
+}
 
 /* ------------------------------ */
-// process the measured data
-void TPP_TOF::processMeasuredData(VL53L5CX_ResultsData measurementData, int32_t adjustedData[]) { 
+// process the measured data of the zones in the mask zones, bit n for zone n.
+// The other zones are taken to be background (see roiZones) and are not learned.
+// returns a mask of the foreground zones
+uint64_t TPP_TOF::processMeasuredData(const VL53L5CX_ResultsData &measurementData, unsigned long frameMS,
+        uint64_t zones, int32_t adjustedData[]) { 
+
+    uint64_t foreground = 0;
+    // zones where the tracker is following someone are not absorbed into the background
+    uint64_t liveZones = tracker_.getLiveZones(frameMS, zones);
 
-    int statusCode = 0;
-    int measuredData = 0;
-    int32_t deltaDist = 0;
+    for(int i = 0; i < imageResolution_; i++) {
 
-    for(int i = 0; i < imageResolution; i++) {
+        if (!((zones >> i) & 1)) {
+            adjustedData[i] = -3;
+            continue;
+        }
       
-        // process the status code, only good data if status code is 5 or 9
-        statusCode = measurementData.target_status[i];
-        measuredData = measurementData.distance_mm[i];
-
-        if( (statusCode != 5) && (statusCode != 9) && (statusCode != 6)) { // TOF measurement is bad
-            
-            adjustedData[i] = -1;
-
-        } else if ( (measuredData == 0) || (measuredData > MAX_CALIBRATION) ) { 
-         //data out of range
-                
-            adjustedData[i] = -2;  // indicate out of range data
-
-        } else  {
-            // data is good and in range, check if background
-          
-            // check new data against calibration value
-            deltaDist = abs(measuredData - calibration[i]);
-
-            if ((deltaDist <= NOISE_RANGE) || (measuredData > calibration[i]) ){ 
-                    // zero out noise  
-                
-                    adjustedData[i] = -3; // data is background; ignore
+        // -1 for a bad status, -2 for out of range data
+        adjustedData[i] = checkZone(measurementData, i);
+
+        if (adjustedData[i] > 0) {
+            // data is good and in range, check against the background of this zone
+            // background data also updates the background
+
+            if (background_.classifyAndLearn(i, adjustedData[i], (liveZones >> i) & 1)) {
+                    foreground |= 1ULL << i;
             } 
             else { 
-            
-                    adjustedData[i] = (int16_t) measuredData;
+                    adjustedData[i] = -3; // data is background; ignore
             }
 
         }
         
     }
+    return foreground;
 } 
 
+/* ------------------------------ */
+// true if the frame can reuse lastResult_: the last frame processed was empty
+// and no zone has moved by more than its noise band since then
+bool TPP_TOF::frameUnchanged(const VL53L5CX_ResultsData &frame) {
+
+    if (!haveReference_ || (framesSkippedInRow_ >= TOF_MAX_SKIPPED_FRAMES)) {
+        return false;
+    }
+    for (int i = 0; i < imageResolution_; i++) {
+        int32_t zone = checkZone(frame, i);
+        if (zone > 0) {
+            if ((referenceMM_[i] < 0) || (abs(zone - referenceMM_[i]) > background_.getBandMM(i))) {
+                return false;
+            }
+        } else if (zone != referenceMM_[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ------------------------------ */
+// remember an empty frame to compare the next frames with
+void TPP_TOF::setReference(const VL53L5CX_ResultsData &frame) {
+    for (int i = 0; i < imageResolution_; i++) {
+        referenceMM_[i] = checkZone(frame, i);
+    }
+}
+
+/* ------------------------------ */
+// the zones to process this frame, bit n for zone n
+// While we follow a person, the window around where they should be now gets the
+// full work, and so do the zones that were foreground in the last frame, so
+// others in view are still tracked. Every other zone gets only the cheap test of
+// TPP_Background::mayBeForeground. If one of those may be foreground, someone new
+// has come in or ours has left the window, and the whole frame is processed, as it
+// is when the track is lost.
+uint64_t TPP_TOF::roiZones(const VL53L5CX_ResultsData &frame, unsigned long frameMS) {
+
+    uint64_t allZones = (imageResolution_ >= 64) ? ~0ULL : ((1ULL << imageResolution_) - 1);
+
+    const trackInfo *pFocus = tracker_.getTrack(focusTrackId_);
+    if (!roiMode_ || (pFocus == NULL) || (pFocus->missedFrames > 0)) {
+        return allZones;
+    }
+
+    int xFine, yFine;
+    int maxFine = (imageWidth_ - 1) << POI_FRACTION_BITS;
+    TPP_Tracker::extrapolate(pFocus->xFine, pFocus->yFine, pFocus->vxFine, pFocus->vyFine,
+        frameMS - pFocus->lastSeenMS, maxFine, maxFine, &xFine, &yFine);
+
+    int centerX = (xFine + POI_FRACTION_ONE / 2) >> POI_FRACTION_BITS;
+    int centerY = (yFine + POI_FRACTION_ONE / 2) >> POI_FRACTION_BITS;
+    uint64_t zones = lastForeground_;
+    for (int y = max(0, centerY - TOF_ROI_RADIUS); y <= min(imageWidth_ - 1, centerY + TOF_ROI_RADIUS); y++) {
+        for (int x = max(0, centerX - TOF_ROI_RADIUS); x <= min(imageWidth_ - 1, centerX + TOF_ROI_RADIUS); x++) {
+            zones |= 1ULL << (y * imageWidth_ + x);
+        }
+    }
+
+    // the status is only looked at for the few zones that are close enough
+    for (int i = 0; i < imageResolution_; i++) {
+        if (       !((zones >> i) & 1)
+                && background_.mayBeForeground(i, frame.distance_mm[i])
+                && (checkZone(frame, i) > 0)) {
+            return allZones;
+        }
+    }
+    roiFrames_++;
+    return zones;
+}
+
+/* ------------------------------ */
+// make thisZone, at x, y, the point of interest. It is the closest good zone so far.
+void TPP_TOF::takeZone(const VL53L5CX_ResultsData &frame, int thisZone, int x, int y, int distanceMM, int score,
+        unsigned long frameMS, pointOfInterest *pPOI) {
+    pPOI->x  = x;
+    pPOI->y  = y;
+    pPOI->distanceMM = distanceMM;
+    pPOI->detectedAtMS = frameMS;
+    pPOI->calibrationDistMM = background_.getMeanMM(thisZone);
+    pPOI->hasDetection = true; 
+    pPOI->surroundingHits =  score;
+    pPOI->confidence = zoneConfidence(frame, thisZone);
+}
+
+/* ------------------------------ */
+// find the closest good zone and make it the point of interest
+// works for any image width. Returns the zone, or -1 if there is none.
+int TPP_TOF::searchGeneric(const VL53L5CX_ResultsData &frame, int32_t adjustedData[],
+        unsigned long frameMS, pointOfInterest *pPOI) {
+
+    int closestZone = -1;
+    for (int y = 0; y < imageWidth_; y++) {
+        for (int x = 0; x < imageWidth_; x++) {
+
+            int thisZone = y*imageWidth_ + x;
+
+            // Get the average distance of this zone
+            int avgDistThisZone = avgdistZone(thisZone, adjustedData);
+
+            int score = scoreZone(thisZone, adjustedData);
+
+            if(        (adjustedData[thisZone] > 0)                       // less than 0 is to be ignored 
+                    && (validate(score))                                 // has at least x adjacent zones with valid distances 
+                    && (adjustedData[thisZone] < background_.getMeanMM(thisZone))   // closer than the background (this does not seem to matter)
+                    && (adjustedData[thisZone] < pPOI->distanceMM)       // closer than current closest pPOI
+                    && (avgDistThisZone > NOISE_RANGE)
+                    ) {
+                // this pPOI will be the one closest to the sensor
+                takeZone(frame, thisZone, x, y, adjustedData[thisZone], score, frameMS, pPOI);
+                closestZone = thisZone;
+            }
+        }
+    }
+    return closestZone;
+}
+
+/* ------------------------------ */
+// the zones around each zone of a WIDTH x WIDTH image, the zone itself included.
+// A neighbour past the edge is zone WIDTH * WIDTH, which the search sets to 0 so
+// it never has a valid distance.
+template <int WIDTH>
+struct neighbourTable {
+    uint8_t zones[WIDTH * WIDTH][9];
+};
+
+template <int WIDTH>
+constexpr neighbourTable<WIDTH> makeNeighbourTable() {
+    neighbourTable<WIDTH> table = {};
+    for (int zone = 0; zone < WIDTH * WIDTH; zone++) {
+        int n = 0;
+        for (int y = zone / WIDTH - 1; y <= zone / WIDTH + 1; y++) {
+            for (int x = zone % WIDTH - 1; x <= zone % WIDTH + 1; x++) {
+                bool inside = (x >= 0) && (x < WIDTH) && (y >= 0) && (y < WIDTH);
+                table.zones[zone][n++] = inside ? (y * WIDTH + x) : (WIDTH * WIDTH);
+            }
+        }
+    }
+    return table;
+}
+
+template <int WIDTH>
+struct neighbours {
+    static constexpr neighbourTable<WIDTH> table = makeNeighbourTable<WIDTH>();
+};
+template <int WIDTH>
+constexpr neighbourTable<WIDTH> neighbours<WIDTH>::table;
+
+/* ------------------------------ */
+// searchGeneric for an image WIDTH zones wide. The neighbours come from the table
+// and the loop over them is unrolled, so there is no division or bounds check.
+// adjustedData must have room for one more zone, the one past the edge.
+template <int WIDTH>
+int TPP_TOF::searchFixed(const VL53L5CX_ResultsData &frame, int32_t adjustedData[],
+        unsigned long frameMS, pointOfInterest *pPOI) {
+
+    const neighbourTable<WIDTH> &table = neighbours<WIDTH>::table;
+    adjustedData[WIDTH * WIDTH] = 0;
+
+    int closestZone = -1;
+    for (int thisZone = 0; thisZone < WIDTH * WIDTH; thisZone++) {
+
+        // a zone without a good distance can not be chosen; no need to score it
+        int32_t distance = adjustedData[thisZone];
+        if (distance <= 0) {
+            continue;
+        }
+
+        int score = 0;
+        int totalDist = 0;
+        const uint8_t *pNeighbours = table.zones[thisZone];
+#pragma GCC unroll 9
+        for (int n = 0; n < 9; n++) {
+            int32_t neighbourDist = adjustedData[pNeighbours[n]];
+            if (neighbourDist > 0) {
+                score++;
+                totalDist += neighbourDist;
+            }
+        }
+
+        if (       (validate(score))
+                && (distance < background_.getMeanMM(thisZone))
+                && (distance < pPOI->distanceMM)
+                && ((totalDist / score) > NOISE_RANGE)  // the zone itself is in score
+                ) {
+            takeZone(frame, thisZone, thisZone % WIDTH, thisZone / WIDTH, distance, score, frameMS, pPOI);
+            closestZone = thisZone;
+        }
+    }
+    return closestZone;
+}
+
+/* ------------------------------ */
+// use the zone search made for the image width, if there is one
+void TPP_TOF::selectSearch() {
+    if (genericSearch_) {
+        search_ = &TPP_TOF::searchGeneric;
+    } else if (imageWidth_ == 8) {
+        search_ = &TPP_TOF::searchFixed<8>;
+    } else if (imageWidth_ == 4) {
+        search_ = &TPP_TOF::searchFixed<4>;
+    } else {
+        search_ = &TPP_TOF::searchGeneric;
+    }
+}
+
+// -------- setGenericSearch ------------
+// true to search with the code that works for any image width, to benchmark it
+void TPP_TOF::setGenericSearch(bool generic) {
+    genericSearch_ = generic;
+    selectSearch();
+}
 
 /* ------------------------------ */
 // returns number of adjacent zones that have valid distance data
 int TPP_TOF::scoreZone(int location, int32_t dataArray[]){
     int score = 0;
     int locX, locY, loc;
-    int locYInit = location/imageWidth;
-    int locXInit = location % imageWidth;
+    int locYInit = location/imageWidth_;
+    int locXInit = location % imageWidth_;
 
     for(int yIndex = -1; yIndex <= 1; yIndex++) {
         for(int xIndex = -1; xIndex <= 1; xIndex++) {
@@ -214,10 +926,10 @@ int TPP_TOF::scoreZone(int location, int32_t dataArray[]){
             locX = locXInit+ xIndex;
             locY = locYInit + yIndex;
 
-            if ((locX >= 0) && (locX < imageWidth) && (locY >= 0) && (locY < imageWidth)) {
+            if ((locX >= 0) && (locX < imageWidth_) && (locY >= 0) && (locY < imageWidth_)) {
 
                 // determine the location in the dataArray of value to test for validity
-                loc = (locY * imageWidth) + locX;
+                loc = (locY * imageWidth_) + locX;
 
                 if(dataArray[loc] > 0) { // valid value
                     score++;
@@ -235,8 +947,8 @@ int TPP_TOF::avgdistZone(int location, int32_t distance[]){
     int numZones = 0;
     int avgDist = 0;
     int locX, locY, loc;
-    int locYInit = location/imageWidth;
-    int locXInit = location % imageWidth;
+    int locYInit = location/imageWidth_;
+    int locXInit = location % imageWidth_;
 
 
     avgDist = distance[location];
@@ -247,10 +959,10 @@ int TPP_TOF::avgdistZone(int location, int32_t distance[]){
                 locX = locXInit + xIndex;
                 locY = locYInit + yIndex;
 
-                if ((locX >= 0) && (locX < imageWidth) && (locY >= 0) && (locY < imageWidth)) {
+                if ((locX >= 0) && (locX < imageWidth_) && (locY >= 0) && (locY < imageWidth_)) {
 
                     // determine the location in the dataArray of value to test for validity
-                    loc = (locY * imageWidth) + locX;
+                    loc = (locY * imageWidth_) + locX;
                     if (distance[loc] > 0 ) {
                         totalDist += distance[loc] ;
                         numZones++;
@@ -294,118 +1006,312 @@ void TPP_TOF::moveTerminalCursorDown(int numlines) {
 
 
 
+/* ------------------------------ */
+// read a frame from the sensor into measurementData_, nearest target first
+// returns false if it could not be read. Call with the bus locked.
+bool TPP_TOF::readFrame() {
+    if (!myImager_.getRangingData(&measurementData_)) {
+        return false;
+    }
+    keepNearestTargets<VL53L5CX_NB_TARGET_PER_ZONE>(&measurementData_);
+    return true;
+}
+
+/* ------------------------------ */
+// watch for a sensor that has stopped working, after each poll of getPOI.
+// The first fault restarts ranging; a fault before the next good frame
+// re-initialises the sensor. Returns false if there was a fault.
+bool TPP_TOF::checkHealth(bool gotFrame, bool i2cError) {
+
+    unsigned long now = millis();
+    if (gotFrame) {
+        lastGoodFrameMS_ = now;
+        i2cErrors_ = 0;
+        restarted_ = false;
+        return true;
+    }
+    if (i2cError) {
+        i2cErrors_++;
+    }
+    unsigned long frameTimeoutMS = FRAME_TIMEOUT_MS * RANGING_FREQUENCY / rangingFrequency_;
+    if ((i2cErrors_ < MAX_I2C_ERRORS) && (now - lastGoodFrameMS_ < frameTimeoutMS)) {
+        return true;
+    }
+
+    faults_++;
+    theLogger.warn("sensor %d %s", sensorIndex_,
+        (i2cErrors_ >= MAX_I2C_ERRORS) ? "has I2C errors" : "stopped sending frames");
+    i2cErrors_ = 0;
+    lastGoodFrameMS_ = now;
+
+    if (!restarted_) {
+        restarted_ = true;
+        bool started = false;
+        WITH_LOCK(Wire) {
+            myImager_.stopRanging();
+            started = myImager_.startRanging();
+        }
+        if (started) {
+            return false;   // it has FRAME_TIMEOUT_MS to send a frame
+        }
+    }
+    startRecovery();
+    return false;
+}
+
+/* ------------------------------ */
+// bring the sensor up again, keeping the calibration and the background.
+// getPOI advances it a step at a time.
+void TPP_TOF::startRecovery() {
+
+    theLogger.warn("sensor %d: re-initialising", sensorIndex_);
+    recovering_ = true;
+    recoveryStartMS_ = millis();
+    initStartMS_ = recoveryStartMS_;
+    phaseStartMS_ = recoveryStartMS_;
+    initState_ = TOF_INIT_REBOOT;
+
+    // the people in front of it have to be found again, at the full rate
+    requestedFrequency_ = RANGING_FREQUENCY;
+    tracker_.reset();
+    focusTrackId_ = 0;
+    haveReference_ = false;
+    waitingFirstDetection_ = true;
+    hitIsPersistent_ = false;
+    sequentialFramesWithHit_ = 0;
+}
+
+/* ------------------------------ */
+// one step of the re-init, or a wait before trying it again
+void TPP_TOF::serviceRecovery() {
+
+    if (initState_ == TOF_INIT_FAILED) {
+        if (millis() - recoveryStartMS_ < RECOVERY_RETRY_MS) {
+            return;
+        }
+        startRecovery();
+    }
+    serviceInit();
+}
+
+// -------- restartRanging ------------
+// stops and starts ranging so the next frame is one frame period from now.
+// Used to stagger the frames of several sensors on the same bus.
+bool TPP_TOF::restartRanging() {
+    if (initState_ != TOF_INIT_READY) {
+        return false;
+    }
+    bool started = false;
+    WITH_LOCK(Wire) {
+        myImager_.stopRanging();
+        started = myImager_.startRanging();
+    }
+    return started;
+}
+
+
+/* ------------------------------ */
+// range at frequency frames a second from now on. The frame after this
+// comes one new frame period from now.
+void TPP_TOF::changeRangingFrequency(int frequency) {
+
+    bool started = false;
+    WITH_LOCK(Wire) {
+        myImager_.stopRanging();
+        myImager_.setRangingFrequency(frequency);
+        started = myImager_.startRanging();
+    }
+    rangingFrequency_ = frequency;
+    lastGoodFrameMS_ = millis();
+    theLogger.info("sensor %d ranging at %d Hz", sensorIndex_, frequency);
+    if (!started) {
+        startRecovery();
+    }
+}
+
 // -------- getPOI ------------
 // called anytime to have sensor read and interpret its zone data
 // returns the current Point Of Interest
 void TPP_TOF::getPOI(pointOfInterest *pPOI){
 
     pPOI->gotNewSensorData = false;
+    pPOI->hasDetection = false;
+
+    if (recovering_) {
+        serviceRecovery();
+        return;
+    }
+    if (initState_ != TOF_INIT_READY) {
+        return;
+    }
+
+    if (xtalkRequested_) {
+        xtalkRequested_ = false;
+        calibrateXtalk();
+    }
+    if (requestedFrequency_ != rangingFrequency_) {
+        changeRangingFrequency(requestedFrequency_);
+    }
+
+    //Poll sensor for new data.  Adjust if close to calibration value
+    // only the reads hold the bus, so other devices on it wait as little as possible
+    bool gotFrame = false;
+    bool i2cError = false;
+    WITH_LOCK(Wire) {
+        PROFILE_SECTION(PROFILE_TOF_READ);
+        if (myImager_.isDataReady() == true) {
+            gotFrame = readFrame(); //Read distance data into ST driver array
+            i2cError = !gotFrame;
+        } else {
+            i2cError = (myImager_.lastError.lastErrorCode != SF_VL53L5CX_ERROR_TYPE::NO_ERROR);
+        }
+    }
+
+    if (!checkHealth(gotFrame, i2cError)) {
+        return;
+    }
+    if (gotFrame) {
+        lastFrameMS_ = millis();
+        processFrame(measurementData_, lastFrameMS_, pPOI);
+    }
+}
+
+/* ------------------------------ */
+// interpret one frame of zone data that was read at frameMS
+// this is the whole of getPOI except for reading the sensor, so a recorded
+// frame can be run through it
+void TPP_TOF::processFrame(const VL53L5CX_ResultsData &frame, unsigned long frameMS, pointOfInterest *pPOI){
+
+    PROFILE_SECTION(PROFILE_POI);
+
+    // nothing has happened since the last empty frame
+    if (frameUnchanged(frame)) {
+        *pPOI = lastResult_;
+        framesSkippedInRow_++;
+        skippedFrames_++;
+        return;
+    }
+    framesSkippedInRow_ = 0;
+
     pPOI->hasDetection = false;
     pPOI->x = -255;
     pPOI->y = -255;
+    pPOI->xFine = -255 * POI_FRACTION_ONE;
+    pPOI->yFine = -255 * POI_FRACTION_ONE;
+    pPOI->vxFine = 0;
+    pPOI->vyFine = 0;
+    pPOI->trackId = 0;
+    pPOI->trackAge = 0;
+    pPOI->confidence = 0;
     pPOI->distanceMM = -1;
     pPOI->detectedAtMS = -1;
     pPOI->calibrationDistMM = -1;
 
-    int32_t adjustedData[imageResolution];
+    int32_t adjustedData[VL53L5CX_RESOLUTION_8X8 + 1];    // room for searchFixed's zone past the edge
 
 #ifdef CONTINUOUS_DEBUG_DISPLAY
-    int32_t secondTable[imageResolution];   // second table to print out
+    int32_t secondTable[imageResolution_];   // second table to print out
     String secondTableTitle = ""; // will hold title of second table 
 
     // initialize second table
-    for (int i = 0; i<imageResolution; i++) {
+    for (int i = 0; i<imageResolution_; i++) {
         secondTable[i] = 0;
     }
 #endif
   
-    //Poll sensor for new data.  Adjust if close to calibration value
-    
-    if (myImager.isDataReady() == true) {
+    pPOI->gotNewSensorData = true;
+
+    // initialize findings
+    pPOI->distanceMM = MAX_CALIBRATION + 1; // start with the max allowed
+
+    // process the measured data, in ROI mode only where someone is or may be
+    uint64_t foreground = processMeasuredData(frame, frameMS, roiZones(frame, frameMS), adjustedData);
+    lastForeground_ = foreground;
     
-        if (myImager.getRangingData(&measurementData)) { //Read distance data into ST driver array
+    // XXXX New criteria (v 0.8+ for establishing the smallest valid distance)
+    //  Walk through the adjustedData array.  For each possible
+    //    smallest value found, check that surrounding values are valid.
+    int closestZone = (this->*search_)(frame, adjustedData, frameMS, pPOI);
 
-            pPOI->gotNewSensorData = true;
-       
-            // initialize findings
-            pPOI->distanceMM = MAX_CALIBRATION + 1; // start with the max allowed
+#ifdef CONTINUOUS_DEBUG_DISPLAY
+    for (int i = 0; i < imageResolution_; i++) {
+        secondTable[i] = avgdistZone(i, adjustedData);
+    }
+#endif
 
-            // process the measured data
-            processMeasuredData(measurementData, adjustedData);
-            
-            // XXXX New criteria (v 0.8+ for establishing the smallest valid distance)
-            //  Walk through the adjustedData array except for the edges.  For each possible
-            //    smallest value found, check that surrounding values are valid.
+    // group the foreground into blobs and follow them from frame to frame
+    int numTracks = tracker_.update(adjustedData, imageWidth_, frameMS);
 
-            //
-            // do not process the edges: x, y == 0 or x,y == 7  
-            for (int y = 0; y < imageWidth; y++) {
-                for (int x = 0; x < imageWidth; x++) {
+    // frames like this one can be skipped if it is empty. Not while the tracker
+    // still has tracks; they have to be seen to be missing.
+    haveReference_ = (foreground == 0) && (numTracks == 0);
+    if (haveReference_) {
+        setReference(frame);
+    }
 
-                    int thisZone = y*imageWidth + x;
+    if (pPOI->hasDetection) {
+        // stay with the person we are looking at as long as they are seen,
+        // otherwise look at the person with the closest zone
+        const trackInfo *pFocus = tracker_.getTrack(focusTrackId_);
+        if ((pFocus == NULL) || (pFocus->missedFrames > 0)) {
+            focusTrackId_ = tracker_.trackIdAtZone(closestZone);
+            pFocus = tracker_.getTrack(focusTrackId_);
+        }
 
-                    // Get the average distance of this zone
-                    int avgDistThisZone = avgdistZone(thisZone, adjustedData);
+        if ((pFocus != NULL) && (tracker_.trackIdAtZone(closestZone) != focusTrackId_)) {
+            // someone else has come closer. The eyes stay with the person they
+            // are looking at, so the distance and zone are theirs too.
+            int zone = pFocus->closestZone;
+            takeZone(frame, zone, zone % imageWidth_, zone / imageWidth_, adjustedData[zone],
+                pPOI->surroundingHits, frameMS, pPOI);
+        }
 
-                    int score = scoreZone(thisZone, adjustedData);
-#ifdef CONTINUOUS_DEBUG_DISPLAY
-                    secondTable[thisZone] = avgDistThisZone; 
-#endif
-                    // test for the smallest value that is a significant zone
-                    //if( (avgDistThisZone > NOISE_RANGE) && (avgDistThisZone < smallestValue) &&
-                    //    (validate(score) == true) ) {
-
-                    if(        (adjustedData[thisZone] > 0)                       // less than 0 is to be ignored 
-                            && (validate(score))                                 // has at least x adjacent zones with valid distances 
-                            && (adjustedData[thisZone] < calibration[thisZone])   // closer than our calibration frame (this does not seem to matter)
-                            && (adjustedData[thisZone] < pPOI->distanceMM)       // closer than current closest pPOI
-                            && (avgDistThisZone > NOISE_RANGE)
-                            ) {
-                        // this pPOI will be the one closest to the sensor
-                        pPOI->x  = x;
-                        pPOI->y  = y;
-                        pPOI->distanceMM = adjustedData[thisZone];
-                        pPOI->detectedAtMS = millis();
-                        pPOI->calibrationDistMM = calibration[thisZone];
-                        pPOI->hasDetection = true; 
-                        pPOI->surroundingHits =  score;
-               
-                    }
-                }
-            }
+        if (pFocus != NULL) {
+            pPOI->trackId = focusTrackId_;
+            pPOI->trackAge = pFocus->age;
+            pPOI->xFine = pFocus->xFine;
+            pPOI->yFine = pFocus->yFine;
+            pPOI->vxFine = pFocus->vxFine;
+            pPOI->vyFine = pFocus->vyFine;
+        } else {
+            // the tracker had no room for this blob
+            pPOI->xFine = pPOI->x << POI_FRACTION_BITS;
+            pPOI->yFine = pPOI->y << POI_FRACTION_BITS;
+        }
+    } else {
+        focusTrackId_ = 0;
+    }
 
 
 
 #ifdef CONTINUOUS_DEBUG_DISPLAY
 
-            int linesPrinted = 0;
-            linesPrinted = prettyPrint(adjustedData);
-
-            // print out focus value found
-            Serial.print("\nFocus on x = ");
-            Serial.printf("%5ld", focusX);
-            Serial.print(" y = ");
-            Serial.printf("%5ld", focusY);
-            Serial.print(" range = ");
-            Serial.printf("%5ld", smallestValue);
-            Serial.println();
-            Serial.println();
-            Serial.println();
-            linesPrinted += 3;
-
-            Serial.println("avgDistThisZone");
-            linesPrinted += 1;
-            linesPrinted += prettyPrint(secondTable);
-            Serial.println();
-            linesPrinted++;
-
-            // overwrite the previous display
-            moveTerminalCursorUp(linesPrinted+1);
+    int linesPrinted = 0;
+    linesPrinted = prettyPrint(adjustedData);
+
+    // print out focus value found
+    Serial.print("\nFocus on x = ");
+    Serial.printf("%5ld", focusX);
+    Serial.print(" y = ");
+    Serial.printf("%5ld", focusY);
+    Serial.print(" range = ");
+    Serial.printf("%5ld", smallestValue);
+    Serial.println();
+    Serial.println();
+    Serial.println();
+    linesPrinted += 3;
+
+    Serial.println("avgDistThisZone");
+    linesPrinted += 1;
+    linesPrinted += prettyPrint(secondTable);
+    Serial.println();
+    linesPrinted++;
+
+    // overwrite the previous display
+    moveTerminalCursorUp(linesPrinted+1);
 #endif
-            
-        }
-    }
 
+    lastResult_ = *pPOI;
 }
 
 // -------- getPOITemporalFiltered ------------
@@ -415,15 +1321,6 @@ void TPP_TOF::getPOI(pointOfInterest *pPOI){
 // this prevents spurious reports
 void TPP_TOF::getPOITemporalFiltered(pointOfInterest *pPOI) {
 
-    static bool waitingFirstDetection = true;
-    static int sequentialFramesWithHit = 0;
-    static int currentX = -1;
-    static int currentY = -1;
-    static int suppressedX = -1;
-    static int suppressedY = -1;
-
-    bool isPersistentDetection = false;
-
     // get new point of interest data
     getPOI(pPOI); 
 
@@ -434,67 +1331,135 @@ void TPP_TOF::getPOITemporalFiltered(pointOfInterest *pPOI) {
         return;
     }
 
+    // someone has come in; have the next frame at the full rate rather than
+    // wait for the detection to persist over several slow frames
+    if (pPOI->hasDetection && (rangingFrequency_ != RANGING_FREQUENCY)) {
+        requestedFrequency_ = RANGING_FREQUENCY;
+        changeRangingFrequency(RANGING_FREQUENCY);
+    }
+
+    filterTemporal(pPOI);
+
+    if (pRecorder_ != NULL) {
+        pRecorder_->recordFrame(sensorIndex_, measurementData_, imageResolution_, lastFrameMS_, background_, *pPOI,
+            confidenceMode_);
+    }
+}
+
+/* ------------------------------ */
+// suppress the detection in a new frame's POI until it has persisted for
+// FRAMES_FOR_GOOD_HIT frames, or one frame in confidence mode if the sensor is
+// sure of it
+void TPP_TOF::filterTemporal(pointOfInterest *pPOI) {
+
+    bool isPersistentDetection = false;
+
     if ( ! pPOI->hasDetection) {
         //theLogger.trace("no detection");
-        waitingFirstDetection = true; 
+        waitingFirstDetection_ = true; 
 
     } else {
 
-        if (waitingFirstDetection) {
+        if (waitingFirstDetection_) {
             // we have a first detection
-            //theLogger.trace("first detection (%4i, %4i) dist: %ld calib: %d deltaCalibr: %ld surrounding: %d", 
-            //  pPOI->x, pPOI->y, pPOI->distanceMM, pPOI->calibrationDistMM, pPOI->distanceMM - pPOI->calibrationDistMM, pPOI->surroundingHits);
-            waitingFirstDetection = false;
-            sequentialFramesWithHit = 0;
-            currentX = pPOI->x;
-            currentY = pPOI->y;
-            suppressedX = -1; // set up to log this one
-            suppressedY = -1;
+            waitingFirstDetection_ = false;
+            hitIsPersistent_ = false;
+            sequentialFramesWithHit_ = 0;
+            suppressedX_ = -1; // set up to log this one
+            suppressedY_ = -1;
         } 
-        
-        // allow some spatial jitter
-        int spatialDistX = 0 ;  //currentX - pPOI->x;
-        int spatialDistY = 0 ;  //currentY - pPOI->y;
-        if ((spatialDistX < 2) && (spatialDistY < 2)) {
-            // same x,y so increment frame counter
-            sequentialFramesWithHit++;
-        } else {
-            // x,y has changed so this becomes the first frame
-            sequentialFramesWithHit = 1;
-            currentX = pPOI->x;
-            currentY = pPOI->y;
+        sequentialFramesWithHit_++;
+
+        // The tracker only keeps a person that moves a short distance from frame
+        // to frame, so the age of the track is the number of frames with the same
+        // person in them. If the tracker had no room we count frames with any hit.
+        int framesWithHit = sequentialFramesWithHit_;
+        if (pPOI->trackId != 0) {
+            framesWithHit = min(pPOI->trackAge, sequentialFramesWithHit_);
         }
 
         // do we have enough sequential frames to declare a hit?
-        if (sequentialFramesWithHit >= FRAMES_FOR_GOOD_HIT) {
+        // once declared, the hit lasts as long as every frame has a detection
+        int framesForGoodHit = FRAMES_FOR_GOOD_HIT;
+        if (confidenceMode_ && (pPOI->confidence >= TOF_STRONG_CONFIDENCE)) {
+            framesForGoodHit = 1;
+        }
+        if (framesWithHit >= framesForGoodHit) {
             // the frames filter has passed
-            isPersistentDetection = true;
+            hitIsPersistent_ = true;
         }
+        isPersistentDetection = hitIsPersistent_;
 
         if (isPersistentDetection) {
             // we'll return the POI that we got
 
             // logging
-            theLogger.trace("temporal filter returns point (%4i, %4i) dist: %d calib: %d deltaDist: %d frames: %d surrounding: %d", 
-                pPOI->x, pPOI->y, pPOI->distanceMM, pPOI->calibrationDistMM, pPOI->distanceMM - pPOI->calibrationDistMM,
-                 sequentialFramesWithHit, pPOI->surroundingHits);
+            DEFERRED_TRACE(theLogger, "temporal filter returns point (%4i, %4i) track: %d dist: %d calib: %d deltaDist: %d frames: %d surrounding: %d confidence: %d", 
+                pPOI->x, pPOI->y, pPOI->trackId, pPOI->distanceMM, pPOI->calibrationDistMM, pPOI->distanceMM - pPOI->calibrationDistMM,
+                 framesWithHit, pPOI->surroundingHits, pPOI->confidence);
 
         } else {
             // valid point, but not persistent so suppress this detection
             pPOI->hasDetection =  false; 
 
             // logging
-            if((suppressedX != pPOI->x) && (suppressedY != pPOI->y) ) {
+            if((suppressedX_ != pPOI->x) && (suppressedY_ != pPOI->y) ) {
                 // only report once for each x,y
-                theLogger.trace("POI suppressed (%4i, %4i) dist: %d  calib: %d  delta: %d", 
+                DEFERRED_TRACE(theLogger, "POI suppressed (%4i, %4i) dist: %d  calib: %d  delta: %d", 
                     pPOI->x,pPOI->y,pPOI->distanceMM,pPOI->calibrationDistMM,pPOI->distanceMM - pPOI->calibrationDistMM);
-                suppressedX = pPOI->x;
-                suppressedY = pPOI->y;
+                suppressedX_ = pPOI->x;
+                suppressedY_ = pPOI->y;
             }
         }
     } 
 }
 
+// -------- setRecorder ------------
+// every frame read by getPOITemporalFiltered is passed to pRecorder, marked
+// with the sensorIndex given to startInit. NULL stops recording.
+void TPP_TOF::setRecorder(TPP_TOFRecorder *pRecorder) {
+    pRecorder_ = pRecorder;
+}
+
+// -------- replayFrame ------------
+// runs a recorded frame through the same steps as getPOITemporalFiltered.
+// A calibration frame replaces the calibration and starts over; its POI has
+// gotNewSensorData false. Use an instance that is not reading a sensor.
+void TPP_TOF::replayFrame(const tofFrame &frame, pointOfInterest *pPOI) {
+
+    pPOI->gotNewSensorData = false;
+    pPOI->hasDetection = false;
+
+    if (frame.flags & TOF_FRAME_FLAG_CALIBRATION) {
+        imageResolution_ = frame.numZones;
+        imageWidth_ = (imageResolution_ == VL53L5CX_RESOLUTION_8X8) ? 8 : 4;
+        selectSearch();
+        for (int i = 0; i < imageResolution_; i++) {
+            calibration_[i] = frame.distanceMM[i];
+        }
+        background_.init(calibration_, imageResolution_);
+        tracker_.reset();
+        haveReference_ = false;
+        focusTrackId_ = 0;
+        lastForeground_ = 0;
+        waitingFirstDetection_ = true;
+        hitIsPersistent_ = false;
+        return;
+    }
+
+    if (frame.numZones != imageResolution_) {
+        // no calibration for this resolution yet
+        return;
+    }
+
+    for (int i = 0; i < imageResolution_; i++) {
+        measurementData_.distance_mm[i] = frame.distanceMM[i];
+        measurementData_.target_status[i] = frame.status[i];
+    }
+    processFrame(measurementData_, frame.timestampMS, pPOI);
+    filterTemporal(pPOI);
+}
+
 
 /* ------------------------------ */
 // function to pretty print data to serial port
@@ -505,15 +1470,15 @@ int TPP_TOF::prettyPrint(int32_t dataArray[]) {
 
     int lines = 0;
     Serial.print("\t        ");
-    for (int i = imageWidth-1; i >= 0; i--) {
+    for (int i = imageWidth_-1; i >= 0; i--) {
         Serial.printf("%-5i",i);
     }
     Serial.println();
     lines++;
-    for(int y = 0; y <= imageWidth * (imageWidth - 1) ; y += imageWidth)  {
+    for(int y = 0; y <= imageWidth_ * (imageWidth_ - 1) ; y += imageWidth_)  {
         Serial.print("\t");
-        Serial.printf("%-5i:  ", y/imageWidth);
-        for (int x = imageWidth - 1 ; x >= 0 ; x--) {
+        Serial.printf("%-5i:  ", y/imageWidth_);
+        for (int x = imageWidth_ - 1 ; x >= 0 ; x--) {
             Serial.printf("%-5ld", dataArray[x + y]);
         }
         Serial.println();
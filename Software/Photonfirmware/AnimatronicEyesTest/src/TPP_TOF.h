@@ -14,6 +14,46 @@
     Requires the caller to set up the wire.h library
         Wire.begin(); //This resets to 100kHz I2C
         Wire.setClock(400000); //Sensor has max I2C freq of 400kHz 
+    The Wire buffers are enlarged to TOF_WIRE_BUFFER_SIZE (see acquireWireBuffer in
+    TPP_TOF.cpp) so the sensor firmware download and frame reads use few, large transfers.
+
+    Bringing up the sensor takes a second or more, most of it the firmware download,
+    and up to 10 seconds when it calibrates from the scene. startInit() begins it and
+    each call of serviceInit() does one bounded step (at most TOF_INIT_DOWNLOAD_BYTES of
+    firmware), so the caller's loop keeps running. getPOI() has no data until the
+    sensor is ready. A sensor that does not answer ends in TOF_INIT_FAILED.
+
+    The sensor can report up to four targets per zone, for instance a person and
+    the wall behind them, if VL53L5CX_NB_TARGET_PER_ZONE is set in the library's
+    platform.h. Each frame is then reduced to the nearest good target of each zone
+    as it is read, so everything after the read sees one target per zone. With the
+    default of one target per zone this costs nothing. Each extra target adds about
+    600 bytes to VL53L5CX_ResultsData.
+
+    The zone search is compiled once for each image width, 4x4 and 8x8, with the
+    neighbours of each zone in a table made at compile time. The one for the
+    sensor's resolution is picked when init is done. setGenericSearch() uses the
+    old search that works out the neighbours at run time, to compare the two.
+
+    A cover glass in front of the sensor reflects some of its light back, which
+    shows as near hits. requestXtalkCalibration() measures this crosstalk once, with
+    a target in front of the head, and keeps it in EEPROM. Each init after that
+    gives it to the sensor, so there is no calibration at boot.
+
+    A sensor that stops working heals itself. getPOI watches for I2C errors and for
+    frames that stop coming. The sensor's stream counter must advance for a frame to
+    be ready, so a stuck counter shows up as missing frames. Ranging is restarted
+    first. If that does not help, the sensor alone is brought up again, keeping its
+    calibration and learned background. isRecovering() is true meanwhile, and
+    getPOI has no data. A re-init that fails is tried again every few seconds.
+
+    While the room is empty the sensor can range at TOF_IDLE_RANGING_FREQUENCY
+    instead of RANGING_FREQUENCY, see setIdleRate(). The first frame with a hit in
+    it puts the sensor back to the full rate on its own, without waiting for the
+    caller, so the next frame comes at the full rate.
+
+    Every use of the sensor holds the Wire lock, so the sensor can be read from
+    another thread (see TPP_TOFThread.h) while loop() drives other devices on the bus.
   
     Author: Bob Glicksman, Jim Schrempp
     (c) Copyright 2022 Bob Glicksman and Jim Schrempp
@@ -28,41 +68,223 @@
 
 #include <SparkFun_VL53L5CX_Library.h> //http://librarymanager/All#SparkFun_VL53L5CX
 #include <Wire.h>
+#include <TPP_Tracker.h>
+#include <TPP_TOFFrame.h>
+#include <TPP_Background.h>
+#include <TPP_Profiler.h>
+
+// the address of the sensor when it comes out of reset
+#define TOF_DEFAULT_ADDRESS (DEFAULT_I2C_ADDR >> 1)
+
+#define RANGING_FREQUENCY 14  // times per second for sensor to sample the environment
+#define TOF_IDLE_RANGING_FREQUENCY 2    // while no one has been seen for a long time
+
+// size of the Wire transmit and receive buffers, and so the largest I2C transfer
+#define TOF_WIRE_BUFFER_SIZE 512
+
+// In ROI mode, while we follow a person, only the zones within TOF_ROI_RADIUS of
+// where they are predicted to be, and the zones already foreground, are run through
+// the background and the tracker. Every other zone is only compared with its
+// foreground threshold; one that is newly closer sends the frame back to full processing.
+#define TOF_ROI_RADIUS 2
+
+// In confidence mode each zone gets a confidence from the sigma, signal and
+// reflectance the sensor reports. Zones below TOF_MIN_CONFIDENCE are treated as
+// bad data, and a hit at or above TOF_STRONG_CONFIDENCE is good in its first frame.
+#define TOF_MIN_CONFIDENCE 25
+#define TOF_STRONG_CONFIDENCE 75
+
+// A frame in which no zone has moved by more than its noise band since the last
+// empty frame reuses that frame's result instead of being processed. At most
+// TOF_MAX_SKIPPED_FRAMES in a row are skipped so the background keeps learning.
+#define TOF_MAX_SKIPPED_FRAMES 14
+
+// firmware bytes sent to the sensor in each step of serviceInit, about 25 ms at 400 kHz
+#define TOF_INIT_DOWNLOAD_BYTES 1024
 
-extern SparkFun_VL53L5CX myImager;
-extern VL53L5CX_ResultsData measurementData; // Result data class structure, 1356 byes of RAM
+// the background calibration of sensor n is kept in EEPROM at
+// TOF_EEPROM_CALIBRATION_ADDRESS + n * TOF_EEPROM_CALIBRATION_BYTES
+#define TOF_EEPROM_CALIBRATION_ADDRESS 0
+#define TOF_EEPROM_CALIBRATION_BYTES 136
+
+// the crosstalk calibration of sensor n is kept in EEPROM after room for the
+// background calibration of two sensors, at
+// TOF_EEPROM_XTALK_ADDRESS + n * TOF_EEPROM_XTALK_BYTES
+#define TOF_EEPROM_XTALK_ADDRESS (TOF_EEPROM_CALIBRATION_ADDRESS + 2 * TOF_EEPROM_CALIBRATION_BYTES)
+#define TOF_EEPROM_XTALK_BYTES (8 + VL53L5CX_XTALK_BUFFER_SIZE)
+
+// the target for the crosstalk calibration: a grey card (3% reflectance for ST's
+// calibration, more is fine) filling the field of view at this distance, 600 to 3000 mm
+#define TOF_XTALK_REFLECTANCE_PERCENT 3
+#define TOF_XTALK_DISTANCE_MM 600
+#define TOF_XTALK_SAMPLES 4             // 1 to 16, more takes longer
 
 typedef struct {
     bool gotNewSensorData;      
     bool hasDetection;    // only true if there is a detection
     unsigned long detectedAtMS;
-    int distanceMM; 
-    int x;
-    int y;
-    int calibrationDistMM;
+    int distanceMM; // the closest zone of the person we are looking at, who is not
+    int x;          // always the closest person: the eyes stay with one while they are
+    int y;          // tracked, see trackId
+    int xFine;  // distance weighted centroid of the target, zone units * POI_FRACTION_ONE
+    int yFine;
+    int vxFine; // velocity of the target, zone units * POI_FRACTION_ONE per second
+    int vyFine;
+    int trackId;    // persistent id of the person we are looking at, 0 if none
+    int trackAge;   // number of frames that person has been seen
+    int confidence; // 0 to 100, how sure the sensor is of the distance of the chosen zone
+    int calibrationDistMM;  // background distance of the zone
     int surroundingHits;  // for debug. number of adjacent zones with good data
     int surroundingAvg; // for debug. score from the zone avg function
 } pointOfInterest ;
 
+// the steps of bringing up a sensor, in order
+typedef enum {
+    TOF_INIT_OFF,               // startInit has not been called
+    TOF_INIT_REBOOT,
+    TOF_INIT_WAKEUP,            // after the sensor has had time to reboot
+    TOF_INIT_DOWNLOAD,          // firmware, TOF_INIT_DOWNLOAD_BYTES at a time
+    TOF_INIT_FINISH,
+    TOF_INIT_CONFIGURE,
+    TOF_INIT_START_RANGING,
+    TOF_INIT_FIRST_FRAME,
+    TOF_INIT_CALIBRATE,         // one frame at a time until the scene settles
+    TOF_INIT_READY,
+    TOF_INIT_FAILED             // no sensor, or it stopped answering
+} tofInitState;
+
+class TPP_TOFRecorder;
+
 /*!
  *  @brief  Class that stores state and functions for interacting with the VL53L5CX
- * Time of Flight (TOF) sensor
+ * Time of Flight (TOF) sensor. There is one instance for each sensor.
  */
 class TPP_TOF {
 public:
-    void initTOF();
+    void initTOF(uint8_t i2cAddress = TOF_DEFAULT_ADDRESS, int sensorIndex = 0);
+    void startInit(uint8_t i2cAddress = TOF_DEFAULT_ADDRESS, int sensorIndex = 0);
+    tofInitState serviceInit();
+    tofInitState getInitState() { return initState_; }
+    bool isRecovering() { return recovering_; }
+    unsigned long getFaults() { return faults_; }
     void getPOI(pointOfInterest *pPOI);
     void getPOITemporalFiltered(pointOfInterest *pPOI);
+    bool restartRanging();
+    int  getImageWidth() { return imageWidth_; }
+    void forgetCalibration();
+    void requestXtalkCalibration() { xtalkRequested_ = true; }
+    void forgetXtalkCalibration();
+    void setRecorder(TPP_TOFRecorder *pRecorder);
+    void replayFrame(const tofFrame &frame, pointOfInterest *pPOI);
+    void setROIMode(bool enabled) { roiMode_ = enabled; }
+    unsigned long getROIFrames() { return roiFrames_; }
+    unsigned long getSkippedFrames() { return skippedFrames_; }
+    void setConfidenceMode(bool enabled) { confidenceMode_ = enabled; }
+    void setGenericSearch(bool generic);
+    void setIdleRate(bool idle) { requestedFrequency_ = idle ? TOF_IDLE_RANGING_FREQUENCY : RANGING_FREQUENCY; }
+    bool isIdleRate() { return requestedFrequency_ == TOF_IDLE_RANGING_FREQUENCY; }
 
 private:
     int prettyPrint(int32_t dataArray[]);
-    void processMeasuredData(VL53L5CX_ResultsData measurementData, int32_t adjustedData[]);
+    bool readFrame();
+    bool calibrateBackground(bool *pCalibrated);
+    void initStep();
+    void initFailed(const char *step);
+    void initDone();
+    bool checkHealth(bool gotFrame, bool i2cError);
+    void startRecovery();
+    void serviceRecovery();
+    bool useStoredCalibration();
+    void saveCalibration();
+    int  calibrationAddress();
+    void applyStoredXtalk();
+    void calibrateXtalk();
+    int  xtalkAddress();
+    void changeRangingFrequency(int frequency);
+    void processFrame(const VL53L5CX_ResultsData &frame, unsigned long frameMS, pointOfInterest *pPOI);
+    void filterTemporal(pointOfInterest *pPOI);
+    int32_t checkZone(const VL53L5CX_ResultsData &frame, int zone);
+    int  zoneConfidence(const VL53L5CX_ResultsData &frame, int zone);
+    uint64_t processMeasuredData(const VL53L5CX_ResultsData &measurementData, unsigned long frameMS,
+            uint64_t zones, int32_t adjustedData[]);
+    uint64_t roiZones(const VL53L5CX_ResultsData &frame, unsigned long frameMS);
+    bool frameUnchanged(const VL53L5CX_ResultsData &frame);
+    void setReference(const VL53L5CX_ResultsData &frame);
+    void selectSearch();
+    int  searchGeneric(const VL53L5CX_ResultsData &frame, int32_t adjustedData[],
+            unsigned long frameMS, pointOfInterest *pPOI);
+    template <int WIDTH>
+    int  searchFixed(const VL53L5CX_ResultsData &frame, int32_t adjustedData[],
+            unsigned long frameMS, pointOfInterest *pPOI);
+    void takeZone(const VL53L5CX_ResultsData &frame, int thisZone, int x, int y, int distanceMM, int score,
+            unsigned long frameMS, pointOfInterest *pPOI);
     int  scoreZone(int location, int32_t dataArray[]);
     int  avgdistZone(int location, int32_t distance[]);
     bool validate(int score);
     void moveTerminalCursorUp(int numlines);
     void moveTerminalCursorDown(int numlines);
 
+    SparkFun_VL53L5CX myImager_;
+    VL53L5CX_ResultsData measurementData_;  // Result data class structure, 1356 byes of RAM
+    int32_t calibration_[64];               // 8x8 array of calibration values
+    TPP_Background background_;             // learned from calibration_ and the frames since
+    int imageResolution_ = 0;               // read this back from the sensor
+    int imageWidth_ = 0;                    // read this back from the sensor
+    unsigned long lastFrameMS_ = 0;         // when measurementData_ was read
+
+    TPP_Tracker tracker_;           // follows the blobs in the field of view
+    int focusTrackId_ = 0;          // the track we are looking at
+
+    // temporal filter state
+    bool waitingFirstDetection_ = true;
+    bool hitIsPersistent_ = false;
+    int sequentialFramesWithHit_ = 0;
+    int suppressedX_ = -1;
+    int suppressedY_ = -1;
+
+    bool confidenceMode_ = false;
+
+    // zone search for imageWidth_, chosen by selectSearch()
+    typedef int (TPP_TOF::*searchFunction)(const VL53L5CX_ResultsData &frame, int32_t adjustedData[],
+            unsigned long frameMS, pointOfInterest *pPOI);
+    searchFunction search_ = &TPP_TOF::searchGeneric;
+    bool genericSearch_ = false;
+
+    // region of interest
+    bool roiMode_ = true;
+    unsigned long roiFrames_ = 0;           // frames processed only in and around the window
+    uint64_t lastForeground_ = 0;           // the foreground of the last frame, bit n for zone n
+
+    // frame-delta short-circuit
+    int16_t referenceMM_[64];               // the last empty frame, -1 or -2 for bad zones
+    bool haveReference_ = false;
+    int framesSkippedInRow_ = 0;
+    pointOfInterest lastResult_;            // the result of the last frame processed
+    unsigned long skippedFrames_ = 0;
+
+    // init state
+    tofInitState initState_ = TOF_INIT_OFF;
+    uint8_t i2cAddress_ = TOF_DEFAULT_ADDRESS;
+    unsigned long initStartMS_ = 0;
+    unsigned long phaseStartMS_ = 0;        // start of the phase that is logged next
+    unsigned long stepMS_ = 0;              // start of the current step, for its waits
+    unsigned long lastPollMS_ = 0;          // last time we asked the sensor for a frame
+    int calibrationFrames_ = 0;
+    int lastFrameSum_ = 0;
+    volatile bool xtalkRequested_ = false;  // getPOI runs the crosstalk calibration
+    int rangingFrequency_ = RANGING_FREQUENCY;
+    volatile int requestedFrequency_ = RANGING_FREQUENCY;  // getPOI changes to it
+
+    // recovery
+    volatile bool recovering_ = false;      // init is running again after a fault
+    bool restarted_ = false;                // ranging was restarted since the last good frame
+    int i2cErrors_ = 0;                     // in a row
+    unsigned long lastGoodFrameMS_ = 0;
+    unsigned long recoveryStartMS_ = 0;
+    unsigned long faults_ = 0;
+
+    TPP_TOFRecorder *pRecorder_ = NULL;     // gets every frame if not NULL
+    int sensorIndex_ = 0;                   // which sensor of a TPP_TOFArray
 };
 
 
@@ -0,0 +1,355 @@
+/*
+    TPP_TOFArray.cpp
+
+    Team Practical Project array of Time of Flight sensors
+
+    Several VL53L5CX sensors can be mounted side by side to widen the field of
+    view. This class owns one TPP_TOF for each sensor and fuses their points of
+    interest into one panorama.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_TOFArray.h>
+
+Logger arrayLogger("app.TOF");
+
+// a sensor result older than this is not used in the panorama, about two frames
+const unsigned long STALE_POI_MS = 2 * (1000 / RANGING_FREQUENCY);
+
+// -------- initTOFs ----------
+// called once to start bringing up all the sensors. Returns at once;
+// call serviceInit every time through loop().
+void TPP_TOFArray::initTOFs(const tofSensorConfig sensors[], int numSensors) {
+
+    numSensors_ = min(numSensors, TOF_MAX_SENSORS);
+    if (numSensors > TOF_MAX_SENSORS) {
+        arrayLogger.error("only %d of %d sensors are used, increase TOF_MAX_SENSORS", numSensors_, numSensors);
+    }
+
+    // hold every sensor that we can off the bus, so only one answers at the default address
+    for (int i = 0; i < numSensors_; i++) {
+        config_[i] = sensors[i];
+        if (sensors[i].lpnPin >= 0) {
+            pinMode(sensors[i].lpnPin, OUTPUT);
+            digitalWrite(sensors[i].lpnPin, LOW);
+        }
+    }
+
+    // a sensor without an LPn pin is always on the bus, so it has to be moved first
+    int position = 0;
+    for (int i = 0; i < numSensors_; i++) {
+        if (sensors[i].lpnPin < 0) {
+            initOrder_[position++] = i;
+        }
+    }
+    for (int i = 0; i < numSensors_; i++) {
+        if (sensors[i].lpnPin >= 0) {
+            initOrder_[position++] = i;
+        }
+    }
+
+    for (int i = 0; i < numSensors_; i++) {
+        lastPOI_[i].gotNewSensorData = false;
+        lastPOI_[i].hasDetection = false;
+    }
+    nextSensor_ = 0;
+    focusSensor_ = -1;
+    focusTrackId_ = 0;
+
+    initPosition_ = 0;
+    initWaitMS_ = 0;
+    startNextInit();
+}
+
+// -------- serviceInit ----------
+// called every time through loop(). Does one step of bringing up the sensors.
+// returns true once every sensor is ready or has failed
+bool TPP_TOFArray::serviceInit() {
+
+    if (initPosition_ >= 2 * numSensors_) {
+        return true;
+    }
+    if (millis() - initWaitStartMS_ < initWaitMS_) {
+        return false;
+    }
+    initWaitMS_ = 0;
+
+    if (initPosition_ < numSensors_) {
+
+        int sensor = initOrder_[initPosition_];
+        if (!initStarted_) {
+            sensors_[sensor].startInit(config_[sensor].i2cAddress, sensor);
+            initStarted_ = true;
+            return false;
+        }
+
+        tofInitState state = sensors_[sensor].serviceInit();
+        if ((state != TOF_INIT_READY) && (state != TOF_INIT_FAILED)) {
+            return false;
+        }
+        if ((state == TOF_INIT_FAILED) && (config_[sensor].lpnPin >= 0)) {
+            // it may still be at the default address
+            digitalWrite(config_[sensor].lpnPin, LOW);
+        }
+        initPosition_++;
+        if (initPosition_ < numSensors_) {
+            startNextInit();
+        } else if (numSensors_ == 1) {
+            initPosition_ = 2 * numSensors_;    // nothing to stagger
+        }
+
+    } else {
+
+        // stagger the frames so the reads are spread evenly over the frame period
+        sensors_[initPosition_ - numSensors_].restartRanging();
+        initWait((1000 / RANGING_FREQUENCY) / numSensors_);
+        initPosition_++;
+    }
+
+    if (initPosition_ >= 2 * numSensors_) {
+        int ready = 0;
+        for (int i = 0; i < numSensors_; i++) {
+            if (sensors_[i].getInitState() == TOF_INIT_READY) {
+                ready++;
+            }
+        }
+        arrayLogger.info("%d of %d sensors ready", ready, numSensors_);
+        return true;
+    }
+    return false;
+}
+
+/* ------------------------------ */
+// let the sensor at initPosition_ onto the bus
+void TPP_TOFArray::startNextInit() {
+
+    initStarted_ = false;
+    if (initPosition_ >= numSensors_) {
+        return;
+    }
+    int sensor = initOrder_[initPosition_];
+    if (config_[sensor].lpnPin >= 0) {
+        digitalWrite(config_[sensor].lpnPin, HIGH);
+        initWait(10);   // let the sensor come out of low power
+    }
+}
+
+/* ------------------------------ */
+// the next step of serviceInit is not taken until waitMS from now
+void TPP_TOFArray::initWait(unsigned long waitMS) {
+    initWaitStartMS_ = millis();
+    initWaitMS_ = waitMS;
+}
+
+// -------- getPOITemporalFiltered ------------
+// called anytime to read the next sensor that has a frame ready
+// returns the panorama Point Of Interest. gotNewSensorData is true if
+// any sensor had a new frame.
+void TPP_TOFArray::getPOITemporalFiltered(pointOfInterest *pPOI) {
+
+    pointOfInterest thisPOI;
+    int sensorWithData = -1;
+
+    thisPOI.gotNewSensorData = false;
+    thisPOI.hasDetection = false;
+
+    // Poll the sensors in turn, starting with the one after the last that had data.
+    // Only one frame is read per call.
+    for (int i = 0; i < numSensors_; i++) {
+        int sensor = (nextSensor_ + i) % numSensors_;
+        sensors_[sensor].getPOITemporalFiltered(&thisPOI);
+        if (thisPOI.gotNewSensorData) {
+            lastPOI_[sensor] = thisPOI;
+            sensorWithData = sensor;
+            break;
+        }
+    }
+
+    if (sensorWithData < 0) {
+        // nothing new; report the no-data result as-is
+        *pPOI = thisPOI;
+        return;
+    }
+    nextSensor_ = (sensorWithData + 1) % numSensors_;
+
+    fuse(pPOI);
+    pPOI->gotNewSensorData = true;
+}
+
+// -------- replayFrame ------------
+// runs a recorded frame through its sensor, see TPP_TOF::replayFrame, and
+// returns the panorama Point Of Interest as getPOITemporalFiltered would.
+// Frames of sensors not given to initTOFs are ignored. Use an instance whose
+// sensors are not being read.
+void TPP_TOFArray::replayFrame(const tofFrame &frame, pointOfInterest *pPOI) {
+
+    int sensor = frame.sensorIndex;
+    if (sensor >= numSensors_) {
+        pPOI->gotNewSensorData = false;
+        pPOI->hasDetection = false;
+        return;
+    }
+
+    pointOfInterest thisPOI;
+    sensors_[sensor].replayFrame(frame, &thisPOI);
+    if (!thisPOI.gotNewSensorData) {
+        *pPOI = thisPOI;
+        return;
+    }
+    lastPOI_[sensor] = thisPOI;
+    nextSensor_ = (sensor + 1) % numSensors_;
+
+    fuse(pPOI);
+    pPOI->gotNewSensorData = true;
+}
+
+/* ------------------------------ */
+// picks the point of interest from the latest results of all sensors and
+// converts it to panorama coordinates
+void TPP_TOFArray::fuse(pointOfInterest *pPOI) {
+
+    unsigned long now = millis();
+    int chosen = -1;
+
+    // stay with the person we are looking at while their sensor still sees them
+    if (       (focusSensor_ >= 0)
+            && lastPOI_[focusSensor_].hasDetection
+            && (lastPOI_[focusSensor_].trackId == focusTrackId_)
+            && (now - lastPOI_[focusSensor_].detectedAtMS <= STALE_POI_MS)) {
+        chosen = focusSensor_;
+    } else {
+        // otherwise look at the closest detection of any sensor
+        for (int i = 0; i < numSensors_; i++) {
+            if (       lastPOI_[i].hasDetection
+                    && (now - lastPOI_[i].detectedAtMS <= STALE_POI_MS)
+                    && ((chosen < 0) || (lastPOI_[i].distanceMM < lastPOI_[chosen].distanceMM))) {
+                chosen = i;
+            }
+        }
+    }
+
+    if (chosen < 0) {
+        // no sensor sees anyone
+        *pPOI = lastPOI_[(nextSensor_ + numSensors_ - 1) % numSensors_];
+        pPOI->hasDetection = false;
+        focusSensor_ = -1;
+        focusTrackId_ = 0;
+        return;
+    }
+
+    focusSensor_ = chosen;
+    focusTrackId_ = lastPOI_[chosen].trackId;
+
+    *pPOI = lastPOI_[chosen];
+    int offset = chosen * sensors_[chosen].getImageWidth();
+    pPOI->x += offset;
+    pPOI->xFine += offset << POI_FRACTION_BITS;
+}
+
+/* ------------------------------ */
+// returns the number of zones across all the sensors
+int TPP_TOFArray::getPanoramaWidth() {
+    return numSensors_ * getSensorWidth();
+}
+
+/* ------------------------------ */
+// returns the number of zones from top to bottom
+int TPP_TOFArray::getPanoramaHeight() {
+    return getSensorWidth();
+}
+
+/* ------------------------------ */
+// the zones across one sensor, from the first sensor that is up. 0 if none is.
+int TPP_TOFArray::getSensorWidth() {
+    for (int i = 0; i < numSensors_; i++) {
+        if (sensors_[i].getImageWidth() > 0) {
+            return sensors_[i].getImageWidth();
+        }
+    }
+    return 0;
+}
+
+/* ------------------------------ */
+// record the frames of all sensors, NULL to stop
+void TPP_TOFArray::setRecorder(TPP_TOFRecorder *pRecorder) {
+    for (int i = 0; i < TOF_MAX_SENSORS; i++) {
+        sensors_[i].setRecorder(pRecorder);
+    }
+}
+
+/* ------------------------------ */
+// every sensor calibrates from the scene at the next boot
+void TPP_TOFArray::forgetCalibration() {
+    for (int i = 0; i < numSensors_; i++) {
+        sensors_[i].forgetCalibration();
+    }
+}
+
+/* ------------------------------ */
+// every sensor measures its crosstalk the next time it is read, see TPP_TOF.h
+void TPP_TOFArray::calibrateXtalk() {
+    for (int i = 0; i < numSensors_; i++) {
+        sensors_[i].requestXtalkCalibration();
+    }
+}
+
+/* ------------------------------ */
+// every sensor uses the default crosstalk calibration from the next boot
+void TPP_TOFArray::forgetXtalkCalibration() {
+    for (int i = 0; i < numSensors_; i++) {
+        sensors_[i].forgetXtalkCalibration();
+    }
+}
+
+/* ------------------------------ */
+// frames of all sensors that were not processed because nothing had changed
+unsigned long TPP_TOFArray::getSkippedFrames() {
+    unsigned long skipped = 0;
+    for (int i = 0; i < numSensors_; i++) {
+        skipped += sensors_[i].getSkippedFrames();
+    }
+    return skipped;
+}
+
+/* ------------------------------ */
+// true while any sensor is being re-initialised after a fault
+bool TPP_TOFArray::isRecovering() {
+    for (int i = 0; i < numSensors_; i++) {
+        if (sensors_[i].isRecovering()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ------------------------------ */
+// see TPP_TOF::setIdleRate
+void TPP_TOFArray::setIdleRate(bool idle) {
+    for (int i = 0; i < numSensors_; i++) {
+        sensors_[i].setIdleRate(idle);
+    }
+}
+
+/* ------------------------------ */
+// true while all the sensors are at the idle rate; false once one has seen someone
+bool TPP_TOFArray::isIdleRate() {
+    for (int i = 0; i < numSensors_; i++) {
+        if (!sensors_[i].isIdleRate()) {
+            return false;
+        }
+    }
+    return numSensors_ > 0;
+}
+
+/* ------------------------------ */
+// see TPP_TOF::setConfidenceMode
+void TPP_TOFArray::setConfidenceMode(bool enabled) {
+    for (int i = 0; i < TOF_MAX_SENSORS; i++) {
+        sensors_[i].setConfidenceMode(enabled);
+    }
+}
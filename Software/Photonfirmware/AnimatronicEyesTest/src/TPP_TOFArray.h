@@ -0,0 +1,95 @@
+/*
+    TPP_TOFArray.h
+
+    Team Practical Project array of Time of Flight sensors
+
+    Several VL53L5CX sensors can be mounted side by side to widen the field of
+    view. This class owns one TPP_TOF for each sensor and fuses their points of
+    interest into one panorama. Sensor i covers panorama x from i * 8 to i * 8 + 7,
+    so sensors must be listed in the order of increasing x. Overlap between the
+    fields of view of adjacent sensors is not removed.
+
+    The sensors are read round-robin, at most one frame per call, and their
+    ranging is started staggered so frames arrive spread over the frame period.
+    The cost per frame grows linearly with the number of sensors.
+
+    All sensors come out of reset at the same I2C address, so each sensor needs
+    its own address and every sensor but one must have its LPn pin wired to a GPIO
+    so it can be held off the bus while the others are moved to their addresses.
+    The sensor without an LPn pin (if any) is initialized first.
+
+    initTOFs() only starts bringing up the sensors. serviceInit() must then be called
+    until it returns true (TPP_TOFThread does this); it brings the sensors up one after the other, a bounded step
+    per call, then staggers their ranging. A sensor that fails is held off the bus
+    (if it has an LPn pin) and never has data; the others still work.
+
+    With one sensor this behaves the same as a single TPP_TOF.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_TOFARRAY_H
+#define _TPP_TOFARRAY_H
+
+#include <TPP_TOF.h>
+
+#ifndef TOF_MAX_SENSORS
+#define TOF_MAX_SENSORS 2   // each sensor costs about 5 KB of RAM
+#endif
+
+static_assert(TOF_EEPROM_CALIBRATION_ADDRESS + TOF_MAX_SENSORS * TOF_EEPROM_CALIBRATION_BYTES <= TOF_EEPROM_XTALK_ADDRESS,
+    "the background calibrations run into the crosstalk calibrations in EEPROM");
+
+typedef struct {
+    uint8_t i2cAddress;     // each sensor needs its own address
+    int lpnPin;             // GPIO wired to the LPn pin of the sensor, -1 if not wired
+} tofSensorConfig;
+
+/*!
+ *  @brief  Class that reads several TOF sensors and fuses their points of interest
+ */
+class TPP_TOFArray {
+public:
+    void initTOFs(const tofSensorConfig sensors[], int numSensors);
+    bool serviceInit();
+    void getPOITemporalFiltered(pointOfInterest *pPOI);
+    void replayFrame(const tofFrame &frame, pointOfInterest *pPOI);
+    int  getPanoramaWidth();
+    int  getPanoramaHeight();
+    void setRecorder(TPP_TOFRecorder *pRecorder);
+    void forgetCalibration();
+    void calibrateXtalk();
+    void forgetXtalkCalibration();
+    unsigned long getSkippedFrames();
+    bool isRecovering();
+    void setConfidenceMode(bool enabled);
+    void setIdleRate(bool idle);
+    bool isIdleRate();
+
+private:
+    void fuse(pointOfInterest *pPOI);
+    void startNextInit();
+    void initWait(unsigned long waitMS);
+    int  getSensorWidth();
+
+    TPP_TOF sensors_[TOF_MAX_SENSORS];
+    pointOfInterest lastPOI_[TOF_MAX_SENSORS];  // latest frame result of each sensor
+    int numSensors_ = 0;
+    int nextSensor_ = 0;        // the sensor to poll first on the next call
+    int focusSensor_ = -1;      // the sensor that sees the person we are looking at
+    int focusTrackId_ = 0;
+
+    // init state. initPosition_ steps through initOrder_ to bring the sensors up,
+    // then through the sensors again to stagger them.
+    tofSensorConfig config_[TOF_MAX_SENSORS];
+    int initOrder_[TOF_MAX_SENSORS];    // sensors without an LPn pin first
+    int initPosition_ = 0;
+    bool initStarted_ = false;          // startInit called for the sensor at initPosition_
+    unsigned long initWaitStartMS_ = 0;
+    unsigned long initWaitMS_ = 0;
+};
+
+#endif
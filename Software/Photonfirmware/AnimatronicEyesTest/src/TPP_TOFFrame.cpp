@@ -0,0 +1,215 @@
+/*
+    TPP_TOFFrame.cpp
+
+    Team Practical Project binary Time of Flight frame format
+
+    See TPP_TOFFrame.h for the layout.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_TOFFrame.h>
+
+/* ------------------------------ */
+static void put16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t value) {
+    put16(p, value & 0xFFFF);
+    put16(p + 2, value >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// the sensor status codes are 0 to 13, or 255 for no target
+static uint8_t statusNibble(uint8_t status) {
+    return (status > 15) ? 15 : status;
+}
+
+/* ------------------------------ */
+// CRC-16/CCITT, polynomial 0x1021, start 0xFFFF
+uint16_t crc16TOFFrame(const uint8_t *buffer, int length) {
+
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < length; i++) {
+        crc ^= (uint16_t)buffer[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* ------------------------------ */
+// returns the number of bytes used, or 0 if buffer is too small
+int encodeTOFFrame(const tofFrame *pFrame, const tofFrame *pPrevious, uint8_t *buffer, int bufferSize) {
+
+    int numZones = pFrame->numZones;
+    bool isDelta = (pFrame->flags & TOF_FRAME_FLAG_DELTA) && (pPrevious != NULL);
+    uint8_t flags = pFrame->flags & ~TOF_FRAME_FLAG_DELTA;
+    if (isDelta) {
+        flags |= TOF_FRAME_FLAG_DELTA;
+    }
+
+    // worst case size; a delta frame is never bigger than an absolute one
+    int maxBytes = TOF_FRAME_HEADER_BYTES + (3 * numZones) + TOF_FRAME_DECISION_BYTES + TOF_FRAME_CRC_BYTES;
+    if ((numZones > TOF_FRAME_MAX_ZONES) || (bufferSize < maxBytes)) {
+        return 0;
+    }
+
+    uint8_t *p = buffer + TOF_FRAME_HEADER_BYTES;
+
+    for (int i = 0; i < numZones; i++) {
+        if (isDelta) {
+            int delta = pFrame->distanceMM[i] - pPrevious->distanceMM[i];
+            if ((delta > -128) && (delta < 128)) {
+                *p++ = (uint8_t)(int8_t)delta;
+                continue;
+            }
+            *p++ = (uint8_t)TOF_FRAME_DELTA_ESCAPE;
+        }
+        put16(p, (uint16_t)pFrame->distanceMM[i]);
+        p += 2;
+    }
+
+    if (flags & TOF_FRAME_FLAG_STATUS_NIBBLES) {
+        for (int i = 0; i < numZones; i += 2) {
+            uint8_t high = (i + 1 < numZones) ? statusNibble(pFrame->status[i + 1]) : 0;
+            *p++ = statusNibble(pFrame->status[i]) | (high << 4);
+        }
+    } else {
+        for (int i = 0; i < numZones; i++) {
+            *p++ = pFrame->status[i];
+        }
+    }
+
+    if (flags & TOF_FRAME_FLAG_DECISION) {
+        *p++ = pFrame->hasDetection ? 1 : 0;
+        *p++ = (uint8_t)pFrame->x;
+        *p++ = (uint8_t)pFrame->y;
+        *p++ = 0;
+        put16(p, (uint16_t)pFrame->decisionDistanceMM);
+        p += 2;
+    }
+
+    int payloadBytes = p - buffer - TOF_FRAME_HEADER_BYTES;
+
+    put16(&buffer[0], TOF_FRAME_SYNC);
+    buffer[2] = flags;
+    buffer[3] = numZones;
+    put16(&buffer[4], pFrame->frameNumber);
+    buffer[6] = pFrame->sensorIndex;
+    buffer[7] = 0;
+    put16(&buffer[8], payloadBytes);
+    put32(&buffer[10], pFrame->timestampMS);
+
+    int length = TOF_FRAME_HEADER_BYTES + payloadBytes;
+    if (flags & TOF_FRAME_FLAG_CRC) {
+        put16(&buffer[length], crc16TOFFrame(buffer, length));
+        length += TOF_FRAME_CRC_BYTES;
+    }
+    return length;
+}
+
+/* ------------------------------ */
+// returns the number of bytes used, 0 if buffer does not hold a whole frame yet,
+// or -1 if buffer does not start with a valid frame
+int decodeTOFFrame(const uint8_t *buffer, int length, const tofFrame *pPrevious, tofFrame *pFrame) {
+
+    if (length < TOF_FRAME_HEADER_BYTES) {
+        return 0;
+    }
+    if (get16(&buffer[0]) != TOF_FRAME_SYNC) {
+        return -1;
+    }
+
+    pFrame->flags = buffer[2];
+    pFrame->numZones = buffer[3];
+    pFrame->frameNumber = get16(&buffer[4]);
+    pFrame->sensorIndex = buffer[6];
+    int payloadBytes = get16(&buffer[8]);
+    pFrame->timestampMS = get32(&buffer[10]);
+
+    int numZones = pFrame->numZones;
+    bool isDelta = pFrame->flags & TOF_FRAME_FLAG_DELTA;
+    if ((numZones > TOF_FRAME_MAX_ZONES) || (isDelta && (pPrevious == NULL))) {
+        return -1;
+    }
+    int frameBytes = TOF_FRAME_HEADER_BYTES + payloadBytes;
+    if (pFrame->flags & TOF_FRAME_FLAG_CRC) {
+        frameBytes += TOF_FRAME_CRC_BYTES;
+    }
+    if (length < frameBytes) {
+        return 0;
+    }
+    if (       (pFrame->flags & TOF_FRAME_FLAG_CRC)
+            && (crc16TOFFrame(buffer, frameBytes - TOF_FRAME_CRC_BYTES) != get16(&buffer[frameBytes - TOF_FRAME_CRC_BYTES]))) {
+        return -1;
+    }
+
+    const uint8_t *p = buffer + TOF_FRAME_HEADER_BYTES;
+    const uint8_t *pEnd = p + payloadBytes;
+
+    for (int i = 0; i < numZones; i++) {
+        if (p >= pEnd) {
+            return -1;
+        }
+        if (isDelta && ((int8_t)*p != TOF_FRAME_DELTA_ESCAPE)) {
+            pFrame->distanceMM[i] = pPrevious->distanceMM[i] + (int8_t)*p++;
+            continue;
+        }
+        if (isDelta) {
+            p++;    // skip the escape
+        }
+        if (p + 2 > pEnd) {
+            return -1;
+        }
+        pFrame->distanceMM[i] = (int16_t)get16(p);
+        p += 2;
+    }
+
+    if (pFrame->flags & TOF_FRAME_FLAG_STATUS_NIBBLES) {
+        if (p + (numZones + 1) / 2 > pEnd) {
+            return -1;
+        }
+        for (int i = 0; i < numZones; i++) {
+            uint8_t status = (i & 1) ? (*p++ >> 4) : (*p & 0x0F);
+            pFrame->status[i] = (status == 15) ? 255 : status;
+        }
+        if (numZones & 1) {
+            p++;
+        }
+    } else {
+        if (p + numZones > pEnd) {
+            return -1;
+        }
+        for (int i = 0; i < numZones; i++) {
+            pFrame->status[i] = *p++;
+        }
+    }
+
+    pFrame->hasDetection = false;
+    if (pFrame->flags & TOF_FRAME_FLAG_DECISION) {
+        if (p + TOF_FRAME_DECISION_BYTES > pEnd) {
+            return -1;
+        }
+        pFrame->hasDetection = (p[0] != 0);
+        pFrame->x = (int8_t)p[1];
+        pFrame->y = (int8_t)p[2];
+        pFrame->decisionDistanceMM = (int16_t)get16(&p[4]);
+    }
+
+    return frameBytes;
+}
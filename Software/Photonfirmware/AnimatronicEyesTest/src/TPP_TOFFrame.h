@@ -0,0 +1,100 @@
+/*
+    TPP_TOFFrame.h
+
+    Team Practical Project binary Time of Flight frame format
+
+    A compact binary record of one TOF frame, used to stream frames out of the
+    head or to keep them in RAM so they can be replayed through the POI pipeline.
+    All values are little endian.
+
+    Header, TOF_FRAME_HEADER_BYTES
+        uint16  sync            TOF_FRAME_SYNC
+        uint8   flags           TOF_FRAME_FLAG_xxx
+        uint8   numZones        16 or 64
+        uint16  frameNumber     increments by one for each frame of a sensor
+        uint8   sensorIndex     which sensor of a TPP_TOFArray
+        uint8   reserved
+        uint16  payloadBytes    number of bytes that follow the header
+        uint32  timestampMS     millis() when the frame was read
+    Payload
+        distances   int16 per zone, or if TOF_FRAME_FLAG_DELTA an int8 difference
+                    from the previous frame of the sensor per zone. A difference that
+                    does not fit is sent as TOF_FRAME_DELTA_ESCAPE followed by the int16.
+        status      uint8 per zone, the target_status from the sensor, or if
+                    TOF_FRAME_FLAG_STATUS_NIBBLES one nibble per zone, even zones in
+                    the low nibble. Status 255 (no target) is sent as 15.
+        decision    if TOF_FRAME_FLAG_DECISION, what the firmware made of the frame
+                    uint8 hasDetection, int8 x, int8 y, uint8 reserved, int16 distanceMM
+
+    CRC, if TOF_FRAME_FLAG_CRC
+        uint16  CRC-16/CCITT (0x1021, start 0xFFFF) of the header and payload.
+                Not counted in payloadBytes.
+
+    A frame with TOF_FRAME_FLAG_CALIBRATION holds the background of the sensor
+    instead of a measurement: the distance of each zone that the frames after it
+    were measured against.
+
+    A frame with TOF_FRAME_FLAG_CONFIDENCE was read in confidence mode (see
+    TPP_TOF::setConfidenceMode). Its decision used the sigma, signal and
+    reflectance of each zone, which are not recorded, so it can not be replayed.
+
+    This file does not depend on the Particle libraries so it can be built on a host.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_TOFFRAME_H
+#define _TPP_TOFFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TOF_FRAME_SYNC 0x4654               // "TF"
+#define TOF_FRAME_FLAG_DELTA 0x01
+#define TOF_FRAME_FLAG_CALIBRATION 0x02
+#define TOF_FRAME_FLAG_DECISION 0x04
+#define TOF_FRAME_FLAG_STATUS_NIBBLES 0x08
+#define TOF_FRAME_FLAG_CRC 0x10
+#define TOF_FRAME_FLAG_CONFIDENCE 0x20
+#define TOF_FRAME_DELTA_ESCAPE ((int8_t)0x80)
+
+#define TOF_FRAME_MAX_ZONES 64
+#define TOF_FRAME_HEADER_BYTES 14
+#define TOF_FRAME_DECISION_BYTES 6
+#define TOF_FRAME_CRC_BYTES 2
+#define TOF_FRAME_MAX_BYTES (TOF_FRAME_HEADER_BYTES + (3 * TOF_FRAME_MAX_ZONES) + TOF_FRAME_DECISION_BYTES + TOF_FRAME_CRC_BYTES)
+
+typedef struct {
+    uint8_t flags;
+    uint8_t numZones;
+    uint16_t frameNumber;
+    uint8_t sensorIndex;
+    uint32_t timestampMS;
+    int16_t distanceMM[TOF_FRAME_MAX_ZONES];
+    uint8_t status[TOF_FRAME_MAX_ZONES];
+
+    // what the firmware decided, valid if TOF_FRAME_FLAG_DECISION
+    bool hasDetection;
+    int8_t x;
+    int8_t y;
+    int16_t decisionDistanceMM;
+} tofFrame;
+
+// Encodes pFrame into buffer. If pFrame has TOF_FRAME_FLAG_DELTA set, pPrevious
+// must be the previous frame of the same sensor.
+// Returns the number of bytes used, or 0 if buffer is too small.
+int encodeTOFFrame(const tofFrame *pFrame, const tofFrame *pPrevious, uint8_t *buffer, int bufferSize);
+
+// Decodes one frame from the start of buffer. If the frame is delta encoded,
+// pPrevious must be the previous frame of the same sensor.
+// Returns the number of bytes used, 0 if buffer does not hold a whole frame yet,
+// or -1 if buffer does not start with a valid frame.
+int decodeTOFFrame(const uint8_t *buffer, int length, const tofFrame *pPrevious, tofFrame *pFrame);
+
+// CRC-16/CCITT as used by TOF_FRAME_FLAG_CRC
+uint16_t crc16TOFFrame(const uint8_t *buffer, int length);
+
+#endif
@@ -0,0 +1,363 @@
+/*
+    TPP_TOFRecorder.cpp
+
+    Team Practical Project recorder of Time of Flight frames
+
+    See TPP_TOFRecorder.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_TOFRecorder.h>
+#include <new>
+
+Logger recorderLogger("app.TOF.recorder");
+
+// the number of decision differences that are logged one by one in a replay
+const int MAX_DIFFS_LOGGED = 10;
+
+// -------- setMode ------------
+// start or stop recording. Starting a RAM recording throws away the last one;
+// stopping keeps it for replay().
+void TPP_TOFRecorder::setMode(recordMode mode) {
+
+    WITH_LOCK(lock_) {
+        setModeLocked(mode);
+    }
+}
+
+/* ------------------------------ */
+void TPP_TOFRecorder::setModeLocked(recordMode mode) {
+
+    if (mode != RECORD_OFF) {
+        for (int i = 0; i < TOF_MAX_SENSORS; i++) {
+            havePrevious_[i] = false;
+            calibrationWritten_[i] = false;
+            frameNumber_[i] = 0;
+        }
+        framesRecorded_ = 0;
+        framesDropped_ = 0;
+        sendingLength_ = 0;
+        sendingSent_ = 0;
+        if (mode == RECORD_RAM) {
+            bytesUsed_ = 0;
+        }
+    }
+    mode_ = mode;
+}
+
+// -------- recordFrame ------------
+// called by TPP_TOF for each frame it reads, after the frame has been
+// through the temporal filter and background has learned from it. confidenceMode is true if the TPP_TOF is in
+// confidence mode.
+void TPP_TOFRecorder::recordFrame(int sensorIndex, const VL53L5CX_ResultsData &data, int numZones,
+        unsigned long frameMS, const TPP_Background &background, const pointOfInterest &POI, bool confidenceMode) {
+
+    if ((mode_ == RECORD_OFF) || (sensorIndex >= TOF_MAX_SENSORS) || (numZones > TOF_FRAME_MAX_ZONES)) {
+        return;
+    }
+    WITH_LOCK(lock_) {
+        recordFrameLocked(sensorIndex, data, numZones, frameMS, background, POI, confidenceMode);
+    }
+}
+
+/* ------------------------------ */
+void TPP_TOFRecorder::recordFrameLocked(int sensorIndex, const VL53L5CX_ResultsData &data, int numZones,
+        unsigned long frameMS, const TPP_Background &background, const pointOfInterest &POI, bool confidenceMode) {
+
+    if (mode_ == RECORD_OFF) {
+        return;     // stopped while we waited for the lock
+    }
+
+    frame_.numZones = numZones;
+    frame_.sensorIndex = sensorIndex;
+    frame_.timestampMS = frameMS;
+
+    // the background is needed to make sense of the frames that follow. It is
+    // the one learned so far, not the one from boot, so a replay starts from
+    // the background that decided the first frame.
+    if (!calibrationWritten_[sensorIndex]) {
+        frame_.flags = TOF_FRAME_FLAG_CALIBRATION;
+        frame_.frameNumber = frameNumber_[sensorIndex];
+        for (int i = 0; i < numZones; i++) {
+            frame_.distanceMM[i] = background.getBackgroundMM(i);
+            frame_.status[i] = 0;
+        }
+        if (!write(sensorIndex, &frame_)) {
+            return;
+        }
+        calibrationWritten_[sensorIndex] = true;
+    }
+
+    frame_.flags = TOF_FRAME_FLAG_DECISION;
+    if (confidenceMode) {
+        frame_.flags |= TOF_FRAME_FLAG_CONFIDENCE;
+    }
+    frame_.frameNumber = frameNumber_[sensorIndex]++;
+    for (int i = 0; i < numZones; i++) {
+        frame_.distanceMM[i] = data.distance_mm[i];
+        frame_.status[i] = data.target_status[i];
+    }
+    frame_.hasDetection = POI.hasDetection;
+    frame_.x = POI.x;
+    frame_.y = POI.y;
+    frame_.decisionDistanceMM = POI.distanceMM;
+
+    write(sensorIndex, &frame_);
+}
+
+/* ------------------------------ */
+// encode a frame and send it to where we are recording
+// returns false if there was no room for it
+bool TPP_TOFRecorder::write(int sensorIndex, tofFrame *pFrame) {
+
+    uint8_t encoded[TOF_FRAME_MAX_BYTES];
+    const tofFrame *pPrevious = NULL;
+
+    bool isCalibration = pFrame->flags & TOF_FRAME_FLAG_CALIBRATION;
+    pFrame->flags |= TOF_FRAME_FLAG_STATUS_NIBBLES;
+
+    if (mode_ == RECORD_SERIAL) {
+        if (sendingSent_ < sendingLength_) {
+            // still sending the last frame
+            framesDropped_++;
+            return false;
+        }
+        // a viewer may join at any frame and the port is shared with the log
+        pFrame->flags |= TOF_FRAME_FLAG_CRC;
+        sendingLength_ = encodeTOFFrame(pFrame, NULL, sending_, sizeof(sending_));
+        sendingSent_ = 0;
+        send();
+    } else {
+        if (       !isCalibration
+                && havePrevious_[sensorIndex]
+                && (pFrame->frameNumber % TOF_RECORDER_KEY_INTERVAL != 0)) {
+            pFrame->flags |= TOF_FRAME_FLAG_DELTA;
+            pPrevious = &previous_[sensorIndex];
+        }
+        int length = encodeTOFFrame(pFrame, pPrevious, encoded, sizeof(encoded));
+
+        if (bytesUsed_ + length > TOF_RECORDER_RAM_BYTES) {
+            recorderLogger.info("recording full: %d frames in %d bytes", framesRecorded_, bytesUsed_);
+            mode_ = RECORD_OFF;
+            return false;
+        }
+        memcpy(&buffer_[bytesUsed_], encoded, length);
+        bytesUsed_ += length;
+    }
+
+    if (!isCalibration) {
+        previous_[sensorIndex] = *pFrame;
+        havePrevious_[sensorIndex] = true;
+    }
+    framesRecorded_++;
+    return true;
+}
+
+// -------- process ------------
+// called every time through loop() to send as much of the current frame as
+// the serial port will take without waiting. Does nothing if a frame is
+// being recorded at the moment.
+void TPP_TOFRecorder::process() {
+
+    if (!lock_.trylock()) {
+        return;
+    }
+    send();
+    lock_.unlock();
+}
+
+/* ------------------------------ */
+// send what the serial port has room for, with the lock held
+void TPP_TOFRecorder::send() {
+
+    if ((mode_ != RECORD_SERIAL) || (sendingSent_ >= sendingLength_)) {
+        return;
+    }
+    int room = Serial.availableForWrite();
+    if (room > 0) {
+        int length = min(room, sendingLength_ - sendingSent_);
+        Serial.write(&sending_[sendingSent_], length);
+        sendingSent_ += length;
+    }
+}
+
+// -------- replay ------------
+// runs the frames of sensorIndex in the RAM recording through a fresh TPP_TOF
+// and logs the time per frame and the frames where the decision differs from
+// the one recorded. Stops any recording.
+// returns false if the recording could not be replayed
+bool TPP_TOFRecorder::replay(int sensorIndex) {
+
+    bool ok = false;
+    WITH_LOCK(lock_) {
+        ok = replayLocked(sensorIndex);
+    }
+    return ok;
+}
+
+// time taken by the frames of one replay
+typedef struct {
+    int frames;
+    unsigned long totalUS;
+    unsigned long minUS;
+    unsigned long maxUS;
+} replayTiming;
+
+/* ------------------------------ */
+// run a frame through pTOF and add its time to pTiming
+static void timeReplayFrame(TPP_TOF *pTOF, const tofFrame &frame, pointOfInterest *pPOI, replayTiming *pTiming) {
+
+    unsigned long startUS = micros();
+    pTOF->replayFrame(frame, pPOI);
+    unsigned long elapsedUS = micros() - startUS;
+
+    if (pPOI->gotNewSensorData) {
+        pTiming->frames++;
+        pTiming->totalUS += elapsedUS;
+        pTiming->minUS = min(pTiming->minUS, elapsedUS);
+        pTiming->maxUS = max(pTiming->maxUS, elapsedUS);
+    }
+}
+
+/* ------------------------------ */
+static void logReplayTiming(const char *name, int sensorIndex, const replayTiming &timing) {
+    recorderLogger.info("%s: replayed %d frames of sensor %d in %lu us, %lu frames/s", name,
+        timing.frames, sensorIndex, timing.totalUS, (timing.frames * 1000000UL) / max(timing.totalUS, 1UL));
+    recorderLogger.info("%s: per frame min %lu avg %lu max %lu us", name,
+        timing.minUS, timing.totalUS / timing.frames, timing.maxUS);
+}
+
+/* ------------------------------ */
+// true if two results of the same frame are not the same decision
+static bool poiDiffers(const pointOfInterest &a, const pointOfInterest &b) {
+    return     (a.hasDetection != b.hasDetection)
+            || (a.x != b.x) || (a.y != b.y)
+            || (a.distanceMM != b.distanceMM);
+}
+
+/* ------------------------------ */
+// the frames are run through three TPP_TOFs to compare their speed: one with the
+// generic zone search and one with the search made for the image width, both
+// processing every zone of every frame, and one in ROI mode, as loop() uses.
+// The first two should give the same results. ROI mode can differ only where the
+// background it did not learn outside the window would have changed a decision.
+bool TPP_TOFRecorder::replayLocked(int sensorIndex) {
+
+    mode_ = RECORD_OFF;
+
+    // a TPP_TOF is about 5 KB, too much to keep spares of for a diagnostic, so
+    // they are only had while replaying. Replay runs from a cloud function, not
+    // from the tasks of loop(), so it is exempt from the rule that the running
+    // head allocates no memory (see test/test_no_alloc.cpp).
+    TPP_TOF *pGenericTOF = new (std::nothrow) TPP_TOF();
+    TPP_TOF *pFullTOF = new (std::nothrow) TPP_TOF();
+    TPP_TOF *pTOF = new (std::nothrow) TPP_TOF();
+    if ((pGenericTOF == NULL) || (pFullTOF == NULL) || (pTOF == NULL)) {
+        recorderLogger.error("no memory to replay");
+        delete pGenericTOF;
+        delete pFullTOF;
+        delete pTOF;
+        return false;
+    }
+    pGenericTOF->setROIMode(false);
+    pGenericTOF->setGenericSearch(true);
+    pFullTOF->setROIMode(false);
+
+    pointOfInterest genericPOI;
+    pointOfInterest fullPOI;
+    pointOfInterest POI;
+    replayTiming genericTiming = { 0, 0, 0xFFFFFFFF, 0 };
+    replayTiming fullTiming = { 0, 0, 0xFFFFFFFF, 0 };
+    replayTiming timing = { 0, 0, 0xFFFFFFFF, 0 };
+    int diffs = 0;
+    int genericDiffs = 0;
+    int roiDiffs = 0;
+    bool ok = true;
+    bool confidenceFrame = false;
+
+    for (int i = 0; i < TOF_MAX_SENSORS; i++) {
+        havePrevious_[i] = false;
+    }
+
+    int offset = 0;
+    while (offset < bytesUsed_) {
+
+        // the sensor index is needed to pick the reference for delta decoding
+        int sensor = buffer_[offset + 6];
+        if (sensor >= TOF_MAX_SENSORS) {
+            ok = false;
+            break;
+        }
+        const tofFrame *pPrevious = havePrevious_[sensor] ? &previous_[sensor] : NULL;
+        int length = decodeTOFFrame(&buffer_[offset], bytesUsed_ - offset, pPrevious, &frame_);
+        if (length <= 0) {
+            ok = false;
+            break;
+        }
+        offset += length;
+
+        if (!(frame_.flags & TOF_FRAME_FLAG_CALIBRATION)) {
+            previous_[sensor] = frame_;
+            havePrevious_[sensor] = true;
+        }
+        if (sensor != sensorIndex) {
+            continue;
+        }
+
+        if (frame_.flags & TOF_FRAME_FLAG_CONFIDENCE) {
+            // the sigma, signal and reflectance it was decided on are not recorded
+            confidenceFrame = true;
+            break;
+        }
+        timeReplayFrame(pGenericTOF, frame_, &genericPOI, &genericTiming);
+        timeReplayFrame(pFullTOF, frame_, &fullPOI, &fullTiming);
+        timeReplayFrame(pTOF, frame_, &POI, &timing);
+
+        if (!POI.gotNewSensorData) {
+            continue;   // calibration
+        }
+
+        genericDiffs += poiDiffers(genericPOI, fullPOI);
+        roiDiffs += poiDiffers(POI, fullPOI);
+        if (       (POI.hasDetection != frame_.hasDetection)
+                || (POI.hasDetection && ((POI.x != frame_.x) || (POI.y != frame_.y)))) {
+            diffs++;
+            if (diffs <= MAX_DIFFS_LOGGED) {
+                recorderLogger.info("frame %u: recorded %d (%d, %d), replayed %d (%d, %d)",
+                    frame_.frameNumber, frame_.hasDetection, frame_.x, frame_.y,
+                    POI.hasDetection, POI.x, POI.y);
+            }
+        }
+    }
+
+    unsigned long roiFrames = pTOF->getROIFrames();
+    unsigned long skippedFrames = pTOF->getSkippedFrames();
+    delete pGenericTOF;
+    delete pFullTOF;
+    delete pTOF;
+
+    if (!ok) {
+        recorderLogger.error("recording is damaged at byte %d", offset);
+    }
+    if (confidenceFrame) {
+        recorderLogger.error("sensor %d was recorded in confidence mode and can not be replayed", sensorIndex);
+        return false;
+    }
+    if (timing.frames == 0) {
+        recorderLogger.info("no frames of sensor %d to replay", sensorIndex);
+        return ok;
+    }
+    logReplayTiming("generic search", sensorIndex, genericTiming);
+    logReplayTiming("full frame", sensorIndex, fullTiming);
+    logReplayTiming("ROI", sensorIndex, timing);
+    recorderLogger.info("%d frames differ between the generic search and the one for the image width", genericDiffs);
+    recorderLogger.info("%lu frames processed in the ROI, %lu skipped as unchanged, %d differ from full frame, %d decisions differ from recorded",
+        roiFrames, skippedFrames, roiDiffs, diffs);
+
+    return ok;
+}
@@ -0,0 +1,110 @@
+/*
+    TPP_TOFRecorder.h
+
+    Team Practical Project recorder of Time of Flight frames
+
+    Records every frame that TPP_TOF reads, in the binary format of TPP_TOFFrame.h,
+    together with the decision the firmware made for it.
+
+    RECORD_SERIAL   frames are streamed to the USB serial port for the depth map
+                    viewer (lib/SparkFun_VL53L5CX_Arduino_Library/processingApp).
+                    Each frame is absolute and has a CRC, so a reader can start at
+                    any frame and skip log messages that share the port. process()
+                    writes only what fits in the serial buffer, so loop() never
+                    waits; a frame that arrives while the last one is still being
+                    sent is dropped. A capture of the stream can be replayed on a
+                    PC with tof_replay (Software/Photonfirmware/test), which reports
+                    the speed of the pipeline and where its decisions differ.
+    RECORD_RAM      frames are kept in a RAM buffer until it is full. replay() then
+                    runs them through a fresh TPP_TOF and reports how long each frame
+                    took and every frame where the decision differs from the one
+                    recorded. This is a repeatable benchmark for changes to the POI
+                    pipeline: record a scene once, then replay it on each build.
+                    The frames are run in ROI mode, processing the full frame (see
+                    TPP_TOF::setROIMode) and with the generic zone search (see
+                    TPP_TOF::setGenericSearch), and the time of each is reported.
+
+    Frames read in confidence mode are marked with TOF_FRAME_FLAG_CONFIDENCE. Only
+    the distance and status of each zone are recorded, not the sigma, signal and
+    reflectance that confidence mode uses, so those frames are refused by replay.
+
+    Frames are recorded from the thread that reads the sensor (TPP_TOFThread) while
+    loop() calls process() and the cloud functions change the mode, so every method
+    holds a mutex. process() never waits for it.
+
+    The first frame of each sensor is its calibration frame: the background that
+    TPP_Background had learned when the recording started. In RAM, distances are
+    delta encoded against the previous frame of the sensor, with an absolute key
+    frame every TOF_RECORDER_KEY_INTERVAL frames.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_TOFRECORDER_H
+#define _TPP_TOFRECORDER_H
+
+#include <TPP_TOFArray.h>
+
+#ifndef TOF_RECORDER_RAM_BYTES
+#define TOF_RECORDER_RAM_BYTES 8192    // about 70 frames, 5 seconds, of 8x8 frames
+#endif
+
+#define TOF_RECORDER_KEY_INTERVAL 16
+
+typedef enum {
+    RECORD_OFF,
+    RECORD_SERIAL,
+    RECORD_RAM
+} recordMode;
+
+/*!
+ *  @brief  Class that records TOF frames and replays them through the POI pipeline
+ */
+class TPP_TOFRecorder {
+public:
+    void setMode(recordMode mode);
+    recordMode getMode() { return mode_; }
+    void recordFrame(int sensorIndex, const VL53L5CX_ResultsData &data, int numZones,
+            unsigned long frameMS, const TPP_Background &background, const pointOfInterest &POI,
+            bool confidenceMode);
+    void process();
+    bool replay(int sensorIndex);
+    int  getFramesRecorded() { return framesRecorded_; }
+    int  getFramesDropped() { return framesDropped_; }
+    int  getBytesUsed() { return bytesUsed_; }
+
+private:
+    void setModeLocked(recordMode mode);
+    void recordFrameLocked(int sensorIndex, const VL53L5CX_ResultsData &data, int numZones,
+            unsigned long frameMS, const TPP_Background &background, const pointOfInterest &POI,
+            bool confidenceMode);
+    bool replayLocked(int sensorIndex);
+    bool write(int sensorIndex, tofFrame *pFrame);
+    void send();
+
+    Mutex lock_;
+
+    recordMode mode_ = RECORD_OFF;
+    uint8_t buffer_[TOF_RECORDER_RAM_BYTES];
+    int bytesUsed_ = 0;
+    int framesRecorded_ = 0;
+    int framesDropped_ = 0;
+
+    // the frame being sent in RECORD_SERIAL
+    uint8_t sending_[TOF_FRAME_MAX_BYTES];
+    int sendingLength_ = 0;
+    int sendingSent_ = 0;
+
+    // per sensor state
+    tofFrame previous_[TOF_MAX_SENSORS];    // reference for delta encoding
+    bool havePrevious_[TOF_MAX_SENSORS];
+    bool calibrationWritten_[TOF_MAX_SENSORS];
+    uint16_t frameNumber_[TOF_MAX_SENSORS];
+
+    tofFrame frame_;                        // scratch, too big for the stack
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*
+    TPP_TOFThread.cpp
+
+    Team Practical Project thread that reads the Time of Flight sensors
+
+    See TPP_TOFThread.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_TOFThread.h>
+
+Logger threadLogger("app.TOF.thread");
+
+// -------- start ------------
+// called once from setup() to start reading the sensors of pTOF, which
+// must have had initTOFs called. From now on only the thread uses pTOF,
+// except for its getPanorama... methods.
+void TPP_TOFThread::start(TPP_TOFArray *pTOF) {
+
+    if (pThread_ != NULL) {
+        return;
+    }
+    pTOF_ = pTOF;
+    os_semaphore_create(&resultReady_, TOF_THREAD_QUEUE_SIZE, 0);
+    pThread_ = new Thread("tof", threadFunction, this, OS_THREAD_PRIORITY_DEFAULT, TOF_THREAD_STACK_SIZE);
+    if ((pThread_ == NULL) || !pThread_->isValid()) {
+        threadLogger.error("could not start the TOF thread");
+    }
+}
+
+/* ------------------------------ */
+void TPP_TOFThread::threadFunction(void *param) {
+    ((TPP_TOFThread *)param)->run();
+}
+
+/* ------------------------------ */
+// the thread. Never returns.
+void TPP_TOFThread::run() {
+
+    // bring up the sensors; each step is bounded and holds the bus only while it runs
+    while (!pTOF_->serviceInit()) {
+        delay(1);
+    }
+
+    while (true) {
+        pointOfInterest POI;
+        pTOF_->getPOITemporalFiltered(&POI);
+        if (POI.gotNewSensorData) {
+            if (push(POI)) {
+                os_semaphore_give(resultReady_, false);
+            }
+        } else {
+            delay(pTOF_->isIdleRate() ? TOF_THREAD_IDLE_POLL_MS : TOF_THREAD_POLL_MS);
+        }
+    }
+}
+
+/* ------------------------------ */
+// add a result to the queue. Called only by the thread.
+// returns false if the queue was full and the result was dropped
+bool TPP_TOFThread::push(const pointOfInterest &POI) {
+
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= TOF_THREAD_QUEUE_SIZE) {
+        resultsDropped_++;
+        return false;
+    }
+    queue_[head & (TOF_THREAD_QUEUE_SIZE - 1)] = POI;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// -------- getPOI ------------
+// called from loop() to take the oldest result from the queue
+// returns false, with gotNewSensorData false, if there is none
+bool TPP_TOFThread::getPOI(pointOfInterest *pPOI) {
+
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+        pPOI->gotNewSensorData = false;
+        pPOI->hasDetection = false;
+        return false;
+    }
+    *pPOI = queue_[tail & (TOF_THREAD_QUEUE_SIZE - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+
+    lastPOI_ = *pPOI;
+    haveFocus_ = pPOI->hasDetection && (pPOI->trackId != 0);
+    return true;
+}
+
+// -------- waitForPOI ------------
+// called from loop() to sleep until the thread has queued a result, for at most
+// maxMS. Returns true if there is a result for getPOI
+bool TPP_TOFThread::waitForPOI(unsigned long maxMS) {
+
+    unsigned long startMS = millis();
+    while (tail_.load(std::memory_order_relaxed) == head_.load(std::memory_order_acquire)) {
+        unsigned long waitedMS = millis() - startMS;
+        if ((waitedMS >= maxMS) || (resultReady_ == NULL)) {
+            return false;
+        }
+        // the count can be left over from results getPOI took without waiting,
+        // so look at the queue again after each take
+        os_semaphore_take(resultReady_, maxMS - waitedMS, false);
+    }
+    return true;
+}
+
+// -------- predictFocus ------------
+// called from loop() between results to estimate where the person we are looking at
+// is now, in panorama coordinates. Works from the last result taken, so the thread's
+// tracker is never touched. Returns false if we are not looking at anyone
+bool TPP_TOFThread::predictFocus(unsigned long atMS, int *pXFine, int *pYFine) {
+
+    if (!haveFocus_) {
+        return false;
+    }
+    int maxXFine = (pTOF_->getPanoramaWidth() - 1) << POI_FRACTION_BITS;
+    int maxYFine = (pTOF_->getPanoramaHeight() - 1) << POI_FRACTION_BITS;
+    TPP_Tracker::extrapolate(lastPOI_.xFine, lastPOI_.yFine, lastPOI_.vxFine, lastPOI_.vyFine,
+        atMS - lastPOI_.detectedAtMS, maxXFine, maxYFine, pXFine, pYFine);
+    return true;
+}
+
+#ifndef PARTICLE
+// -------- replayFrame ------------
+// on a PC, in place of the thread: runs frame through the sensors given to start()
+// (see TPP_TOFArray::replayFrame) and queues the result. Call it from the same
+// thread as getPOI.
+void TPP_TOFThread::replayFrame(const tofFrame &frame) {
+
+    pointOfInterest POI;
+    pTOF_->replayFrame(frame, &POI);
+    if (POI.gotNewSensorData) {
+        if (push(POI)) {
+            os_semaphore_give(resultReady_, false);
+        }
+    }
+}
+#endif
@@ -0,0 +1,87 @@
+/*
+    TPP_TOFThread.h
+
+    Team Practical Project thread that reads the Time of Flight sensors
+
+    Reading a frame moves about 1.3 KB over I2C and processing it takes a few more
+    milliseconds. Done inline in loop() this holds up the animation and the servos
+    once per frame. This class gives the sensors their own Device OS thread. The
+    thread brings the sensors up (TPP_TOFArray::serviceInit), then polls them for
+    frames, runs each frame through the POI pipeline and puts the result in a
+    queue. loop() only takes results out of the queue.
+
+    The queue has a single producer (the thread) and a single consumer (loop()),
+    so it needs no lock: each side only writes its own index. If loop() falls
+    behind, the newest results are dropped and counted.
+
+    The sensor and the servo driver share the bus. TPP_TOF and the servo driver
+    hold the Wire lock for each of their transactions.
+
+    The VL53L5CX INT pin is not wired on the head, so the thread polls for a frame
+    every TOF_THREAD_POLL_MS and sleeps in between; every TOF_THREAD_IDLE_POLL_MS
+    while the sensors are at their idle rate, to keep the bus quiet. In place of
+    the interrupt, the thread gives a semaphore for each result it queues, so
+    loop() can sleep in waitForPOI() until there is one.
+
+    On a PC the thread does not run. The host tests queue results with
+    replayFrame() in its place, from recorded or made up frames.
+
+    Key methods
+        .start()            called in setup() after Wire.begin() and initTOFs()
+        .getPOI()           called from loop(); the next result, if there is one
+        .waitForPOI()       called from loop(); blocks until there is a result or a time out
+        .predictFocus()     called from loop(); where the target is now
+        .replayFrame()      host tests only; queues the result of a frame as the thread would
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_TOFTHREAD_H
+#define _TPP_TOFTHREAD_H
+
+#include <TPP_TOFArray.h>
+#include <atomic>
+
+#define TOF_THREAD_QUEUE_SIZE 8         // results, must be a power of 2
+#define TOF_THREAD_STACK_SIZE 4096
+#define TOF_THREAD_POLL_MS 5            // how often to ask the sensors for a frame
+#define TOF_THREAD_IDLE_POLL_MS 25      // the same at TOF_IDLE_RANGING_FREQUENCY
+
+/*!
+ *  @brief  Class that reads the TOF sensors in a thread and queues their points of interest
+ */
+class TPP_TOFThread {
+public:
+    void start(TPP_TOFArray *pTOF);
+    bool getPOI(pointOfInterest *pPOI);
+    bool waitForPOI(unsigned long maxMS);
+    bool predictFocus(unsigned long atMS, int *pXFine, int *pYFine);
+    unsigned long getResultsDropped() { return resultsDropped_; }
+#ifndef PARTICLE
+    void replayFrame(const tofFrame &frame);
+#endif
+
+private:
+    static void threadFunction(void *param);
+    void run();
+    bool push(const pointOfInterest &POI);
+
+    TPP_TOFArray *pTOF_ = NULL;
+    Thread *pThread_ = NULL;
+    os_semaphore_t resultReady_ = NULL;     // given for each result queued
+
+    // single producer, single consumer queue
+    pointOfInterest queue_[TOF_THREAD_QUEUE_SIZE];
+    std::atomic<uint32_t> head_{0};         // next slot to write, only the thread changes it
+    std::atomic<uint32_t> tail_{0};         // next slot to read, only loop() changes it
+    volatile unsigned long resultsDropped_ = 0;
+
+    // loop() side
+    pointOfInterest lastPOI_;               // the last result taken, for predictFocus
+    bool haveFocus_ = false;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/*
+    TPP_Tracker.cpp
+
+    Team Practical Project multi-target tracker for the Time of Flight sensor
+
+    Each frame the zones that have foreground data (adjustedData > 0) are grouped
+    into blobs by connected component labelling. Each blob is matched to a track
+    that has a persistent id, so the caller can keep looking at the same person
+    while others come and go. Each track has a constant velocity predictor so the
+    caller can estimate where the target is between frames.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_Tracker.h>
+
+// adjacent zones further apart in depth than this are not part of the same blob
+const int BLOB_DEPTH_MM = 300;
+// blobs smaller than this are considered noise
+const int MIN_BLOB_ZONES = 2;
+// the weight of a zone in the centroid is how much closer it is than this
+const int CENTROID_WEIGHT_MM = 2000;
+// a blob must be within this distance of a track's predicted position to be matched to it
+const int32_t MATCH_GATE_FINE = 2 * POI_FRACTION_ONE;
+// a track that has not been seen for more than this many frames is dropped
+const int MAX_MISSED_FRAMES = 3;
+// never predict further ahead than this, about two frames
+const unsigned long MAX_PREDICT_MS = 150;
+// a track has moved when its centroid is this far from where it last moved
+const int32_t MOVED_FINE = POI_FRACTION_ONE / 2;
+
+// marks zones that were in a blob too small to keep
+#define TRACKER_NOISE_BLOB 0xFE
+
+/* ------------------------------ */
+TPP_Tracker::TPP_Tracker() {
+    reset();
+}
+
+/* ------------------------------ */
+// forget all tracks
+void TPP_Tracker::reset() {
+    for (int i = 0; i < TRACKER_MAX_TRACKS; i++) {
+        tracks_[i].id = 0;
+    }
+    for (int i = 0; i < TRACKER_MAX_ZONES; i++) {
+        labels_[i] = TRACKER_NO_BLOB;
+    }
+    numBlobs_ = 0;
+}
+
+/* ------------------------------ */
+// groups adjacent foreground zones of similar depth into blobs
+// each zone is queued at most once so the cost is bounded by the grid size
+// returns the number of blobs found
+int TPP_Tracker::labelBlobs(int32_t adjustedData[], int imageWidth) {
+
+    int numZones = imageWidth * imageWidth;
+    uint8_t queue[TRACKER_MAX_ZONES];
+
+    numBlobs_ = 0;
+    for (int i = 0; i < numZones; i++) {
+        labels_[i] = TRACKER_NO_BLOB;
+    }
+
+    for (int start = 0; start < numZones; start++) {
+
+        if ((adjustedData[start] <= 0) || (labels_[start] != TRACKER_NO_BLOB)) {
+            continue;
+        }
+        if (numBlobs_ == TRACKER_MAX_BLOBS) {
+            // no room, ignore the rest of the frame
+            break;
+        }
+
+        blobInfo *pBlob = &blobs_[numBlobs_];
+        pBlob->sumX = 0;
+        pBlob->sumY = 0;
+        pBlob->sumWeight = 0;
+        pBlob->distanceMM = adjustedData[start];
+        pBlob->closestZone = start;
+        pBlob->numZones = 0;
+        pBlob->trackId = 0;
+
+        int head = 0;
+        int tail = 0;
+        labels_[start] = numBlobs_;
+        queue[tail++] = start;
+
+        while (head < tail) {
+            int loc = queue[head++];
+            int locX = loc % imageWidth;
+            int locY = loc / imageWidth;
+
+            // nearer zones weigh more in the centroid
+            int32_t weight = CENTROID_WEIGHT_MM - adjustedData[loc];
+            if (weight < 1) {
+                weight = 1;
+            }
+            pBlob->sumX += weight * locX;
+            pBlob->sumY += weight * locY;
+            pBlob->sumWeight += weight;
+            pBlob->numZones++;
+            if (adjustedData[loc] < pBlob->distanceMM) {
+                pBlob->distanceMM = adjustedData[loc];
+                pBlob->closestZone = loc;
+            }
+
+            for(int yIndex = -1; yIndex <= 1; yIndex++) {
+                for(int xIndex = -1; xIndex <= 1; xIndex++) {
+
+                    int nX = locX + xIndex;
+                    int nY = locY + yIndex;
+
+                    if ((nX >= 0) && (nX < imageWidth) && (nY >= 0) && (nY < imageWidth)) {
+                        int n = (nY * imageWidth) + nX;
+                        if (       (adjustedData[n] > 0)
+                                && (labels_[n] == TRACKER_NO_BLOB)
+                                && (abs(adjustedData[n] - adjustedData[loc]) <= BLOB_DEPTH_MM)) {
+                            labels_[n] = numBlobs_;
+                            queue[tail++] = n;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (pBlob->numZones < MIN_BLOB_ZONES) {
+            // too small to be a person; keep these zones from being visited again
+            for (int i = 0; i < tail; i++) {
+                labels_[queue[i]] = TRACKER_NOISE_BLOB;
+            }
+        } else {
+            numBlobs_++;
+        }
+    }
+
+    return numBlobs_;
+}
+
+/* ------------------------------ */
+// position of a track at atMS assuming constant velocity
+void TPP_Tracker::predictFrom(const trackInfo *pTrack, unsigned long atMS, int *pXFine, int *pYFine) {
+
+    int maxFine = (imageWidth_ - 1) << POI_FRACTION_BITS;
+    extrapolate(pTrack->xFine, pTrack->yFine, pTrack->vxFine, pTrack->vyFine,
+        atMS - pTrack->lastSeenMS, maxFine, maxFine, pXFine, pYFine);
+}
+
+/* ------------------------------ */
+// position dtMS after one at constant velocity, kept within 0..max
+// for callers that have a copy of a track rather than the tracker
+void TPP_Tracker::extrapolate(int xFine, int yFine, int vxFine, int vyFine, unsigned long dtMS,
+        int maxXFine, int maxYFine, int *pXFine, int *pYFine) {
+
+    if (dtMS > MAX_PREDICT_MS) {
+        dtMS = MAX_PREDICT_MS;
+    }
+    *pXFine = constrain(xFine + (int)((vxFine * (int32_t)dtMS) / 1000), 0, maxXFine);
+    *pYFine = constrain(yFine + (int)((vyFine * (int32_t)dtMS) / 1000), 0, maxYFine);
+}
+
+/* ------------------------------ */
+// matches blobs to tracks, closest pair first. Starts tracks for new
+// blobs and drops tracks that have not been seen for a while.
+void TPP_Tracker::associate(unsigned long nowMS) {
+
+    bool trackMatched[TRACKER_MAX_TRACKS];
+    int predX[TRACKER_MAX_TRACKS];
+    int predY[TRACKER_MAX_TRACKS];
+    int blobX[TRACKER_MAX_BLOBS];
+    int blobY[TRACKER_MAX_BLOBS];
+
+    for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+        trackMatched[t] = false;
+        if (tracks_[t].id != 0) {
+            predictFrom(&tracks_[t], nowMS, &predX[t], &predY[t]);
+        }
+    }
+    for (int b = 0; b < numBlobs_; b++) {
+        // round to nearest
+        blobX[b] = ((blobs_[b].sumX << POI_FRACTION_BITS) + blobs_[b].sumWeight/2) / blobs_[b].sumWeight;
+        blobY[b] = ((blobs_[b].sumY << POI_FRACTION_BITS) + blobs_[b].sumWeight/2) / blobs_[b].sumWeight;
+    }
+
+    // greedy matching, at most one pair per pass
+    const int32_t gateSquared = MATCH_GATE_FINE * MATCH_GATE_FINE;
+    for (int pass = 0; pass < TRACKER_MAX_TRACKS; pass++) {
+        int bestTrack = -1;
+        int bestBlob = -1;
+        int32_t bestDistSquared = gateSquared + 1;
+
+        for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+            if ((tracks_[t].id == 0) || trackMatched[t]) {
+                continue;
+            }
+            for (int b = 0; b < numBlobs_; b++) {
+                if (blobs_[b].trackId != 0) {
+                    continue;
+                }
+                int32_t dx = blobX[b] - predX[t];
+                int32_t dy = blobY[b] - predY[t];
+                int32_t distSquared = dx*dx + dy*dy;
+                if (distSquared < bestDistSquared) {
+                    bestDistSquared = distSquared;
+                    bestTrack = t;
+                    bestBlob = b;
+                }
+            }
+        }
+
+        if (bestTrack < 0) {
+            break;  // nothing left within the gate
+        }
+
+        // update the track with the new measurement
+        trackInfo *pTrack = &tracks_[bestTrack];
+        int dtMS = nowMS - pTrack->lastSeenMS;
+        if (dtMS < 1) {
+            dtMS = 1;
+        }
+        int vxNew = ((blobX[bestBlob] - pTrack->xFine) * 1000) / dtMS;
+        int vyNew = ((blobY[bestBlob] - pTrack->yFine) * 1000) / dtMS;
+        pTrack->vxFine = (pTrack->vxFine + vxNew) / 2;     // light smoothing of the velocity
+        pTrack->vyFine = (pTrack->vyFine + vyNew) / 2;
+        pTrack->xFine = blobX[bestBlob];
+        pTrack->yFine = blobY[bestBlob];
+        pTrack->distanceMM = blobs_[bestBlob].distanceMM;
+        pTrack->closestZone = blobs_[bestBlob].closestZone;
+        pTrack->numZones = blobs_[bestBlob].numZones;
+        pTrack->lastSeenMS = nowMS;
+        pTrack->age++;
+        pTrack->missedFrames = 0;
+        if (       (abs(pTrack->xFine - pTrack->anchorXFine) > MOVED_FINE)
+                || (abs(pTrack->yFine - pTrack->anchorYFine) > MOVED_FINE)) {
+            pTrack->anchorXFine = pTrack->xFine;
+            pTrack->anchorYFine = pTrack->yFine;
+            pTrack->lastMovedMS = nowMS;
+        }
+
+        trackMatched[bestTrack] = true;
+        blobs_[bestBlob].trackId = pTrack->id;
+    }
+
+    // tracks not seen this frame
+    for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+        if ((tracks_[t].id != 0) && !trackMatched[t]) {
+            tracks_[t].missedFrames++;
+            if (tracks_[t].missedFrames > MAX_MISSED_FRAMES) {
+                tracks_[t].id = 0;
+            }
+        }
+    }
+
+    // blobs not matched start new tracks if there is room
+    for (int b = 0; b < numBlobs_; b++) {
+        if (blobs_[b].trackId != 0) {
+            continue;
+        }
+        for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+            if (tracks_[t].id == 0) {
+                trackInfo *pTrack = &tracks_[t];
+                pTrack->id = nextTrackId_;
+                nextTrackId_ = (nextTrackId_ >= 30000) ? 1 : nextTrackId_ + 1;
+                pTrack->xFine = blobX[b];
+                pTrack->yFine = blobY[b];
+                pTrack->vxFine = 0;
+                pTrack->vyFine = 0;
+                pTrack->distanceMM = blobs_[b].distanceMM;
+                pTrack->closestZone = blobs_[b].closestZone;
+                pTrack->numZones = blobs_[b].numZones;
+                pTrack->lastSeenMS = nowMS;
+                pTrack->age = 1;
+                pTrack->missedFrames = 0;
+                pTrack->anchorXFine = blobX[b];
+                pTrack->anchorYFine = blobY[b];
+                pTrack->lastMovedMS = nowMS;
+                blobs_[b].trackId = pTrack->id;
+                break;
+            }
+        }
+    }
+}
+
+/* ------------------------------ */
+// process one frame of adjusted data
+// returns the number of tracks currently held
+int TPP_Tracker::update(int32_t adjustedData[], int imageWidth, unsigned long nowMS) {
+
+    imageWidth_ = imageWidth;
+
+    labelBlobs(adjustedData, imageWidth);
+    associate(nowMS);
+
+    int numTracks = 0;
+    for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+        if (tracks_[t].id != 0) {
+            numTracks++;
+        }
+    }
+    return numTracks;
+}
+
+/* ------------------------------ */
+// returns the id of the track that holds this zone in the last frame, 0 if none
+int TPP_Tracker::trackIdAtZone(int location) {
+
+    if ((location < 0) || (location >= TRACKER_MAX_ZONES)) {
+        return 0;
+    }
+    int blob = labels_[location];
+    if (blob >= numBlobs_) {
+        return 0;
+    }
+    return blobs_[blob].trackId;
+}
+
+/* ------------------------------ */
+// returns a mask of the zones of the mask zones that were held by a live track
+// in the last frame, bit n for zone n
+uint64_t TPP_Tracker::getLiveZones(unsigned long nowMS, uint64_t zones) {
+
+    uint64_t live = 0;
+    for (int i = 0; i < TRACKER_MAX_ZONES; i++) {
+        if (!((zones >> i) & 1)) {
+            continue;
+        }
+        const trackInfo *pTrack = getTrack(trackIdAtZone(i));
+        if ((pTrack != NULL) && (nowMS - pTrack->lastMovedMS < TRACKER_LIVE_MS)) {
+            live |= 1ULL << i;
+        }
+    }
+    return live;
+}
+
+/* ------------------------------ */
+// returns the track with this id, or NULL if it is no longer tracked
+const trackInfo* TPP_Tracker::getTrack(int id) {
+
+    if (id == 0) {
+        return NULL;
+    }
+    for (int t = 0; t < TRACKER_MAX_TRACKS; t++) {
+        if (tracks_[t].id == id) {
+            return &tracks_[t];
+        }
+    }
+    return NULL;
+}
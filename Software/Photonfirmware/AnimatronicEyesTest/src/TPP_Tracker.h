@@ -0,0 +1,96 @@
+/*
+    TPP_Tracker.h
+
+    Team Practical Project multi-target tracker for the Time of Flight sensor
+
+    Each frame the zones that have foreground data (adjustedData > 0) are grouped
+    into blobs by connected component labelling. Each blob is matched to a track
+    that has a persistent id, so the caller can keep looking at the same person
+    while others come and go. Each track has a constant velocity predictor so the
+    caller can estimate where the target is between frames. A track that has
+    moved in the last TRACKER_LIVE_MS is live: most likely a person, where one
+    that has stood still longer may be something that was put down.
+
+    All work is bounded: at most TRACKER_MAX_ZONES zones, TRACKER_MAX_BLOBS blobs
+    and TRACKER_MAX_TRACKS tracks are considered each frame, so the worst case
+    time per frame is fixed.
+
+    Positions are in fixed point zone units.
+    e.g. with 8 fraction bits, x = 3.5 zones is reported as 3.5 * 256 = 896
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_TRACKER_H
+#define _TPP_TRACKER_H
+
+#include <Particle.h>
+
+#define POI_FRACTION_BITS 8
+#define POI_FRACTION_ONE (1 << POI_FRACTION_BITS)
+
+#define TRACKER_MAX_ZONES 64    // 8x8 grid
+#define TRACKER_MAX_BLOBS 8     // blobs beyond this in one frame are ignored
+#define TRACKER_MAX_TRACKS 4    // people we can keep track of at once
+#define TRACKER_NO_BLOB 0xFF
+#define TRACKER_LIVE_MS 60000   // a track is live until it has not moved for this long
+
+typedef struct {
+    int id;                     // persistent id, 0 if this slot is not in use
+    int xFine;                  // last measured centroid, zone units * POI_FRACTION_ONE
+    int yFine;
+    int vxFine;                 // velocity, zone units * POI_FRACTION_ONE per second
+    int vyFine;
+    int distanceMM;             // closest zone of the blob
+    int closestZone;            // where that zone is
+    int numZones;               // number of zones in the blob
+    unsigned long lastSeenMS;
+    int age;                    // number of frames this track has been seen
+    int missedFrames;           // number of sequential frames this track has not been seen
+    int anchorXFine;            // where the track was when it last moved
+    int anchorYFine;
+    unsigned long lastMovedMS;
+} trackInfo;
+
+/*!
+ *  @brief  Class that groups foreground zones into blobs and follows them from
+ * frame to frame
+ */
+class TPP_Tracker {
+public:
+    TPP_Tracker();
+    void reset();
+    int  update(int32_t adjustedData[], int imageWidth, unsigned long nowMS);
+    int  trackIdAtZone(int location);
+    uint64_t getLiveZones(unsigned long nowMS, uint64_t zones);
+    const trackInfo* getTrack(int id);
+    static void extrapolate(int xFine, int yFine, int vxFine, int vyFine, unsigned long dtMS,
+            int maxXFine, int maxYFine, int *pXFine, int *pYFine);
+
+private:
+    typedef struct {
+        int32_t sumX;           // weighted sums for the centroid
+        int32_t sumY;
+        int32_t sumWeight;
+        int distanceMM;
+        int closestZone;
+        int numZones;
+        int trackId;
+    } blobInfo;
+
+    int  labelBlobs(int32_t adjustedData[], int imageWidth);
+    void associate(unsigned long nowMS);
+    void predictFrom(const trackInfo *pTrack, unsigned long atMS, int *pXFine, int *pYFine);
+
+    uint8_t labels_[TRACKER_MAX_ZONES];     // blob index for each zone or TRACKER_NO_BLOB
+    blobInfo blobs_[TRACKER_MAX_BLOBS];
+    int numBlobs_ = 0;
+    trackInfo tracks_[TRACKER_MAX_TRACKS];
+    int nextTrackId_ = 1;
+    int imageWidth_ = 8;
+};
+
+#endif
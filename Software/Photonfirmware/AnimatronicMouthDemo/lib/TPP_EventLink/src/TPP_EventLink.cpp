@@ -0,0 +1,447 @@
+/*
+    TPP_EventLink.cpp
+
+    Team Practical Project wired link that carries TOF events from the eyes to the mouth
+
+    See TPP_EventLink.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+
+*/
+
+#include <TPP_EventLink.h>
+
+Logger eventLinkLogger("app.eventlink");
+
+TPP_EventLinkReceiver *TPP_EventLinkReceiver::pBusReceiver_ = nullptr;
+
+// -------- eventLinkCRC8 ------------
+// CRC-8 with polynomial x^8 + x^2 + x + 1 (0x07), starting from 0
+uint8_t eventLinkCRC8(const uint8_t *pData, int length) {
+    uint8_t crc = 0;
+    for (int i = 0; i < length; i++) {
+        crc ^= pData[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+// ================ TPP_EventLinkReceiver ================
+
+// -------- begin ------------
+// join the bus as a slave at address. Frames are then taken in the I2C interrupt.
+void TPP_EventLinkReceiver::begin(uint8_t address) {
+    pBusReceiver_ = this;
+    Wire.begin(address);
+    Wire.onReceive(onReceive);
+    Wire.onRequest(onRequest);
+}
+
+/* ------------------------------ */
+// the eyes have written a frame to us. Runs in the I2C interrupt.
+void TPP_EventLinkReceiver::onReceive(int count) {
+
+    uint8_t frame[EVENT_LINK_FRAME_BYTES];
+    int length = 0;
+    while (Wire.available() > 0) {
+        int data = Wire.read();
+        if (length < EVENT_LINK_FRAME_BYTES) {
+            frame[length] = (uint8_t)data;
+        }
+        length++;
+    }
+    if (pBusReceiver_ != nullptr) {
+        pBusReceiver_->receiveFrame(frame, length);
+    }
+}
+
+/* ------------------------------ */
+// the eyes are reading the ack. Runs in the I2C interrupt.
+void TPP_EventLinkReceiver::onRequest() {
+
+    uint8_t ack[EVENT_LINK_ACK_BYTES];
+    if (pBusReceiver_ != nullptr) {
+        pBusReceiver_->getAck(ack);
+        Wire.write(ack, EVENT_LINK_ACK_BYTES);
+    }
+}
+
+// -------- receiveFrame ------------
+// check a frame and queue its event, unless it is one we have seen already
+// because our ack to it was lost
+void TPP_EventLinkReceiver::receiveFrame(const uint8_t *pFrame, int length) {
+
+    frames_++;
+    if (       (length != EVENT_LINK_FRAME_BYTES)
+            || (pFrame[0] != EVENT_LINK_FRAME_START)
+            || (eventLinkCRC8(&pFrame[1], 3) != pFrame[4])
+            || ((pFrame[1] != EVENT_LINK_EVENT) && (pFrame[1] != EVENT_LINK_PING))) {
+        badFrames_++;
+        lastStatus_ = EVENT_LINK_ACK_BAD_FRAME;
+        return;
+    }
+    lastStatus_ = EVENT_LINK_ACK_OK;
+    lastFrameMS_ = millis();
+
+    uint8_t sequence = pFrame[2];
+    if (haveSequence_ && (sequence == lastSequence_)) {
+        repeats_++;
+        return;
+    }
+    // after either side restarts any sequence number is taken; the eyes
+    // start with a ping, so an event is never mistaken for a repeat
+    haveSequence_ = true;
+    lastSequence_ = sequence;
+
+    if (pFrame[1] == EVENT_LINK_EVENT) {
+        if ((uint8_t)(eventsIn_ - eventsOut_) >= EVENT_LINK_QUEUE_LENGTH) {
+            droppedEvents_++;
+        } else {
+            events_[eventsIn_ % EVENT_LINK_QUEUE_LENGTH] = pFrame[3];
+            eventsIn_++;
+        }
+    }
+}
+
+// -------- getAck ------------
+// the ack for the last frame: its sequence number if it was good
+void TPP_EventLinkReceiver::getAck(uint8_t *pAck) {
+    pAck[0] = EVENT_LINK_ACK_START;
+    pAck[1] = lastSequence_;
+    pAck[2] = lastStatus_;
+    pAck[3] = eventLinkCRC8(&pAck[1], 2);
+}
+
+// -------- getEvent ------------
+// returns true and the event if the eyes have sent one since the last call
+bool TPP_EventLinkReceiver::getEvent(uint8_t *pEvent) {
+
+    if (eventsOut_ == eventsIn_) {
+        return false;
+    }
+    *pEvent = events_[eventsOut_ % EVENT_LINK_QUEUE_LENGTH];
+    eventsOut_++;
+    return true;
+}
+
+// -------- isUp ------------
+// true if a good frame came in within EVENT_LINK_ALIVE_MS
+bool TPP_EventLinkReceiver::isUp() {
+    return haveSequence_ && (millis() - lastFrameMS_ < EVENT_LINK_ALIVE_MS);
+}
+
+
+// ================ TPP_EventLinkSender ================
+
+// -------- begin ------------
+// the mouth is at address on the bus. The first call to process() pings it.
+void TPP_EventLinkSender::begin(uint8_t address) {
+    address_ = address;
+    haveAck_ = false;
+    lastPingMS_ = millis() - EVENT_LINK_PING_MS;
+}
+
+// -------- setLoopback ------------
+// exchange frames with pReceiver instead of the bus; nullptr to go back to the bus
+void TPP_EventLinkSender::setLoopback(TPP_EventLinkReceiver *pReceiver) {
+    pLoopback_ = pReceiver;
+}
+
+// -------- injectFaults ------------
+// in loopback, the next exchanges lose or corrupt what the faults say
+void TPP_EventLinkSender::injectFaults(uint8_t faults, int exchanges) {
+    loopbackFaults_ = faults;
+    faultyExchanges_ = exchanges;
+}
+
+// -------- send ------------
+// queue an event for the mouth. Returns false if the link is down or the queue
+// is full; the caller should then publish the event to the cloud.
+bool TPP_EventLinkSender::send(uint8_t event) {
+
+    if (!isUp() || (numEvents_ >= EVENT_LINK_QUEUE_LENGTH)) {
+        return false;
+    }
+    events_[(eventsOut_ + numEvents_) % EVENT_LINK_QUEUE_LENGTH] = event;
+    numEvents_++;
+    return true;
+}
+
+// -------- process ------------
+// called often from loop(). Sends an unacked frame again once EVENT_LINK_RETRY_MS
+// has gone by, else the next event, else a ping when one is due.
+void TPP_EventLinkSender::process() {
+
+    unsigned long nowMS = millis();
+
+    if (inFlight_) {
+        if (nowMS - lastSentMS_ < EVENT_LINK_RETRY_MS) {
+            return;
+        }
+        // a lost ping is not sent again; the next one will do
+        if (inFlightIsEvent_ && (tries_ < EVENT_LINK_MAX_TRIES)) {
+            retries_++;
+            exchange();
+            return;
+        }
+        inFlight_ = false;
+        if (inFlightIsEvent_) {
+            giveUp();
+            return;
+        }
+    }
+
+    if (numEvents_ > 0) {
+        uint8_t event = events_[eventsOut_];
+        eventsOut_ = (eventsOut_ + 1) % EVENT_LINK_QUEUE_LENGTH;
+        numEvents_--;
+        startFrame(EVENT_LINK_EVENT, event);
+    } else if (nowMS - lastPingMS_ >= EVENT_LINK_PING_MS) {
+        lastPingMS_ = nowMS;
+        startFrame(EVENT_LINK_PING, 0);
+    } else {
+        return;
+    }
+    exchange();
+}
+
+/* ------------------------------ */
+// the event in flight was not acked: the mouth is not there. Take the link to be
+// down rather than wait out EVENT_LINK_ALIVE_MS, and hand back that event and the
+// queued ones for getUndelivered(). Pings bring the link up again.
+void TPP_EventLinkSender::giveUp() {
+
+    lost_++;
+    eventLinkLogger.warn("event %d not acked after %d tries, link down", frame_[3], tries_);
+    haveAck_ = false;
+
+    handBack(frame_[3]);
+    while (numEvents_ > 0) {
+        handBack(events_[eventsOut_]);
+        eventsOut_ = (eventsOut_ + 1) % EVENT_LINK_QUEUE_LENGTH;
+        numEvents_--;
+    }
+}
+
+/* ------------------------------ */
+// if the caller has not taken the last ones yet, the oldest is dropped
+void TPP_EventLinkSender::handBack(uint8_t event) {
+    if (numUndelivered_ >= (int)sizeof(undelivered_)) {
+        numUndelivered_--;
+        memmove(&undelivered_[0], &undelivered_[1], numUndelivered_);
+    }
+    undelivered_[numUndelivered_++] = event;
+}
+
+// -------- getUndelivered ------------
+// returns true and the oldest event that send() took but the mouth never acked;
+// the caller should publish it to the cloud instead
+bool TPP_EventLinkSender::getUndelivered(uint8_t *pEvent) {
+
+    if (numUndelivered_ == 0) {
+        return false;
+    }
+    *pEvent = undelivered_[0];
+    numUndelivered_--;
+    memmove(&undelivered_[0], &undelivered_[1], numUndelivered_);
+    return true;
+}
+
+/* ------------------------------ */
+void TPP_EventLinkSender::startFrame(uint8_t type, uint8_t data) {
+    sequence_++;
+    frame_[0] = EVENT_LINK_FRAME_START;
+    frame_[1] = type;
+    frame_[2] = sequence_;
+    frame_[3] = data;
+    frame_[4] = eventLinkCRC8(&frame_[1], 3);
+    inFlight_ = true;
+    inFlightIsEvent_ = (type == EVENT_LINK_EVENT);
+    tries_ = 0;
+    firstSentMS_ = millis();
+    if (inFlightIsEvent_) {
+        sent_++;
+    }
+}
+
+/* ------------------------------ */
+// send the frame in flight and read the ack. returns true if it was acked
+bool TPP_EventLinkSender::exchange() {
+
+    tries_++;
+    lastSentMS_ = millis();
+    bool acked = (pLoopback_ != nullptr) ? exchangeLoopback() : exchangeBus();
+    if (acked) {
+        inFlight_ = false;
+        haveAck_ = true;
+        lastAckMS_ = millis();
+        if (inFlightIsEvent_) {
+            maxLatencyMS_ = max(maxLatencyMS_, lastAckMS_ - firstSentMS_);
+        }
+    }
+    return acked;
+}
+
+/* ------------------------------ */
+bool TPP_EventLinkSender::exchangeBus() {
+
+    uint8_t ack[EVENT_LINK_ACK_BYTES];
+    int length = 0;
+    WITH_LOCK(Wire) {
+        Wire.beginTransmission(address_);
+        Wire.write(frame_, EVENT_LINK_FRAME_BYTES);
+        if (       (Wire.endTransmission() == 0)
+                && (Wire.requestFrom(address_, (uint8_t)EVENT_LINK_ACK_BYTES) == EVENT_LINK_ACK_BYTES)) {
+            for (length = 0; length < EVENT_LINK_ACK_BYTES; length++) {
+                ack[length] = (uint8_t)Wire.read();
+            }
+        }
+    }
+    return ackMatches(ack, length);
+}
+
+/* ------------------------------ */
+// the same exchange with a receiver in this Photon, with the faults injected
+bool TPP_EventLinkSender::exchangeLoopback() {
+
+    uint8_t faults = 0;
+    if (faultyExchanges_ > 0) {
+        faults = loopbackFaults_;
+        faultyExchanges_--;
+    }
+
+    uint8_t frame[EVENT_LINK_FRAME_BYTES];
+    memcpy(frame, frame_, EVENT_LINK_FRAME_BYTES);
+    if (faults & EVENT_LINK_FAULT_CORRUPT_FRAME) {
+        frame[3] ^= 0x01;
+    }
+    if (!(faults & EVENT_LINK_FAULT_DROP_FRAME)) {
+        pLoopback_->receiveFrame(frame, EVENT_LINK_FRAME_BYTES);
+    }
+
+    uint8_t ack[EVENT_LINK_ACK_BYTES];
+    pLoopback_->getAck(ack);
+    if (faults & EVENT_LINK_FAULT_CORRUPT_ACK) {
+        ack[2] ^= 0x01;
+    }
+    if (faults & EVENT_LINK_FAULT_DROP_ACK) {
+        return false;
+    }
+    return ackMatches(ack, EVENT_LINK_ACK_BYTES);
+}
+
+/* ------------------------------ */
+// true if the ack is good and acks the frame in flight
+bool TPP_EventLinkSender::ackMatches(const uint8_t *pAck, int length) {
+    return     (length == EVENT_LINK_ACK_BYTES)
+            && (pAck[0] == EVENT_LINK_ACK_START)
+            && (eventLinkCRC8(&pAck[1], 2) == pAck[3])
+            && (pAck[1] == frame_[2])
+            && (pAck[2] == EVENT_LINK_ACK_OK);
+}
+
+// -------- isUp ------------
+// true if a frame was acked within EVENT_LINK_ALIVE_MS
+bool TPP_EventLinkSender::isUp() {
+    return haveAck_ && (millis() - lastAckMS_ < EVENT_LINK_ALIVE_MS);
+}
+
+// -------- isIdle ------------
+// true if there is nothing queued or waiting for an ack
+bool TPP_EventLinkSender::isIdle() {
+    return !inFlight_ && (numEvents_ == 0);
+}
+
+// -------- logStats ------------
+void TPP_EventLinkSender::logStats() {
+    eventLinkLogger.info("link %s, events sent %lu retries %lu handed back %lu, slowest ack %lu ms",
+        isUp() ? "up" : "down", sent_, retries_, lost_, maxLatencyMS_);
+}
+
+
+// ================ loopback test ================
+
+typedef struct {
+    const char *name;
+    uint8_t faults;
+    int faultyExchanges;    // the first exchanges after the link is up
+    int eventsDelivered;    // the last this many of the events sent get through
+    unsigned long repeats;  // frames the receiver should see twice
+    bool linkDown;          // the sender gives up; the events not delivered are handed back
+} loopbackCase;
+
+const uint8_t LOOPBACK_EVENTS[] = { 1, 3, 2 };     // Person_entered_fov, Person_too_close, Person_left_fov
+#define NUM_LOOPBACK_EVENTS ((int)(sizeof(LOOPBACK_EVENTS) / sizeof(LOOPBACK_EVENTS[0])))
+
+const loopbackCase LOOPBACK_CASES[] = {
+    { "clean",          0,                              0,                      NUM_LOOPBACK_EVENTS,    0,  false },
+    { "lost frame",     EVENT_LINK_FAULT_DROP_FRAME,    1,                      NUM_LOOPBACK_EVENTS,    0,  false },
+    { "corrupt frame",  EVENT_LINK_FAULT_CORRUPT_FRAME, 2,                      NUM_LOOPBACK_EVENTS,    0,  false },
+    { "lost ack",       EVENT_LINK_FAULT_DROP_ACK,      1,                      NUM_LOOPBACK_EVENTS,    1,  false },
+    { "corrupt ack",    EVENT_LINK_FAULT_CORRUPT_ACK,   2,                      NUM_LOOPBACK_EVENTS,    2,  false },
+    { "mouth gone",     EVENT_LINK_FAULT_DROP_FRAME,    EVENT_LINK_MAX_TRIES,   0,                      0,  true }
+};
+
+/* ------------------------------ */
+// run the sender until everything is acked or given up
+static void runUntilIdle(TPP_EventLinkSender *pSender) {
+    unsigned long startMS = millis();
+    do {
+        pSender->process();
+        delay(1);
+    } while (!pSender->isIdle() && (millis() - startMS < 1000));
+}
+
+// -------- eventLinkLoopbackTest ------------
+// send events through a sender and receiver in this Photon, losing and corrupting
+// frames and acks on the way, and check that each event that should get through
+// does so once and in order. Blocks for about half a second.
+bool eventLinkLoopbackTest() {
+
+    bool allPassed = true;
+    for (const loopbackCase &test : LOOPBACK_CASES) {
+
+        TPP_EventLinkReceiver receiver;
+        TPP_EventLinkSender sender;
+        sender.setLoopback(&receiver);
+        sender.begin();
+        runUntilIdle(&sender);      // the first ping brings the link up
+        bool passed = sender.isUp() && receiver.isUp();
+
+        sender.injectFaults(test.faults, test.faultyExchanges);
+        for (int i = 0; i < NUM_LOOPBACK_EVENTS; i++) {
+            passed = sender.send(LOOPBACK_EVENTS[i]) && passed;
+        }
+        runUntilIdle(&sender);
+
+        int delivered = 0;
+        uint8_t event;
+        while (receiver.getEvent(&event)) {
+            int expected = NUM_LOOPBACK_EVENTS - test.eventsDelivered + delivered;
+            passed = passed && (expected < NUM_LOOPBACK_EVENTS) && (event == LOOPBACK_EVENTS[expected]);
+            delivered++;
+        }
+        passed = passed && (delivered == test.eventsDelivered) && (receiver.getRepeats() == test.repeats);
+
+        // the rest come back from the sender, in order, for the cloud
+        int handedBack = 0;
+        while (sender.getUndelivered(&event)) {
+            passed = passed && (handedBack < NUM_LOOPBACK_EVENTS) && (event == LOOPBACK_EVENTS[handedBack]);
+            handedBack++;
+        }
+        passed = passed && (handedBack == NUM_LOOPBACK_EVENTS - test.eventsDelivered)
+                        && (sender.isUp() != test.linkDown) && (sender.send(LOOPBACK_EVENTS[0]) != test.linkDown);
+
+        eventLinkLogger.info("loopback %-14s %s: delivered %d of %d, handed back %d, bad frames %lu, repeats %lu",
+            test.name, passed ? "pass" : "FAIL", delivered, NUM_LOOPBACK_EVENTS, handedBack,
+            receiver.getBadFrames(), receiver.getRepeats());
+        allPassed = allPassed && passed;
+    }
+    return allPassed;
+}
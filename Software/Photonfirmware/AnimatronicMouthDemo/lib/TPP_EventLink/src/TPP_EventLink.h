@@ -0,0 +1,189 @@
+/*
+    TPP_EventLink.h
+
+    Team Practical Project wired link that carries TOF events from the eyes to the mouth
+
+    The eyes send each TOF_detect event straight to the mouth over I2C rather than
+    through the Particle cloud, which takes from a few hundred ms to several seconds.
+    The mouth joins the I2C bus of the eyes as a slave at EVENT_LINK_I2C_ADDRESS:
+    D0 (SDA), D1 (SCL) and GND of the I2C connectors of the two boards are wired
+    together. The eyes are the bus master, as they already are for the TOF sensors
+    and the servo driver. The mouth's serial port is taken by the MP3 player.
+
+    Each message from the eyes is a frame of EVENT_LINK_FRAME_BYTES:
+        0xA5, type, sequence number, data, CRC-8 of type, sequence number and data
+    type is EVENT_LINK_EVENT, with the TOF_detect code as the data, or EVENT_LINK_PING,
+    which the eyes send every EVENT_LINK_PING_MS so that both sides know the link
+    is there. Straight after writing a frame the eyes read an ack of EVENT_LINK_ACK_BYTES:
+        0x5A, sequence number of the last good frame, status, CRC-8 of sequence number and status
+    If the ack does not carry the sequence number of the frame, the eyes send the
+    frame again every EVENT_LINK_RETRY_MS, up to EVENT_LINK_MAX_TRIES times. The
+    mouth acks a repeated frame again but passes its event on only once. If the
+    eyes give up, they take the link to be down at once. That event and the ones
+    queued behind it come back from getUndelivered(), so none is lost.
+
+    Each side takes the link to be up while frames are acked (eyes) or arrive (mouth)
+    within EVENT_LINK_ALIVE_MS. While the link is down the eyes publish the event to
+    the cloud instead and the mouth takes it from there; while it is up the mouth
+    ignores the cloud, so the eyes may also publish every event there to watch it
+    in the console.
+
+    This library is used by the eyes and the mouth projects, and each has its own
+    copy in its lib directory; change both. "make test" in Software/Photonfirmware/test
+    fails if they differ. The two projects have their own TPP_Animatronic_Global.h,
+    so events are passed as the byte of their TOF_detect code and the callers cast them.
+
+    Loopback test: instead of the bus, a sender can be connected to a receiver in
+    the same Photon, with lost frames, lost acks and corrupt bytes injected on the
+    way. eventLinkLoopbackTest() runs the protocol through each of these, so it can
+    be tested without a mouth: on the Photon from the eyes' cloud function, and on
+    a PC with "make test" in Software/Photonfirmware/test.
+
+    Key methods
+        TPP_EventLinkSender         the eyes
+            .begin()                called in setup() after Wire.begin()
+            .send()                 queue an event; false if the link is down
+            .process()              called often from loop(); sends, retries and pings
+            .getUndelivered()       an event that was queued but not acked, to publish instead
+            .isUp()
+        TPP_EventLinkReceiver       the mouth
+            .begin()                joins the bus as a slave
+            .getEvent()             the next event from the eyes, if there is one
+            .isUp()
+        eventLinkLoopbackTest()     returns true if the protocol passed
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _TPP_EVENTLINK_H
+#define _TPP_EVENTLINK_H
+
+#include <Particle.h>
+
+#define EVENT_LINK_I2C_ADDRESS 0x42     // the mouth; the TOF sensors are at 0x29 and up, the servo driver at 0x40
+#define EVENT_LINK_FRAME_BYTES 5
+#define EVENT_LINK_ACK_BYTES 4
+#define EVENT_LINK_FRAME_START 0xA5
+#define EVENT_LINK_ACK_START 0x5A
+#define EVENT_LINK_RETRY_MS 20          // time the eyes wait before sending an unacked frame again
+#define EVENT_LINK_MAX_TRIES 5          // then the link is down and the event is handed back
+#define EVENT_LINK_PING_MS 1000
+#define EVENT_LINK_ALIVE_MS 3000        // the link is down after this long without a good frame
+#define EVENT_LINK_QUEUE_LENGTH 4       // events waiting to be sent, or to be taken by the mouth; a power of 2
+
+// frame types
+#define EVENT_LINK_EVENT 1
+#define EVENT_LINK_PING 2
+
+// ack status
+#define EVENT_LINK_ACK_OK 0
+#define EVENT_LINK_ACK_BAD_FRAME 1      // the last frame was not good; its sequence number is not acked
+
+// faults injected in loopback, see injectFaults()
+#define EVENT_LINK_FAULT_DROP_FRAME 0x01
+#define EVENT_LINK_FAULT_CORRUPT_FRAME 0x02
+#define EVENT_LINK_FAULT_DROP_ACK 0x04
+#define EVENT_LINK_FAULT_CORRUPT_ACK 0x08
+
+uint8_t eventLinkCRC8(const uint8_t *pData, int length);
+
+/*!
+ *  @brief  Class that takes the frames from the eyes and acks them. Runs in the mouth.
+ */
+class TPP_EventLinkReceiver {
+public:
+    void begin(uint8_t address = EVENT_LINK_I2C_ADDRESS);
+    void receiveFrame(const uint8_t *pFrame, int length);
+    void getAck(uint8_t *pAck);
+    bool getEvent(uint8_t *pEvent);
+    bool isUp();
+
+    unsigned long getFrames() { return frames_; }
+    unsigned long getBadFrames() { return badFrames_; }
+    unsigned long getRepeats() { return repeats_; }
+    unsigned long getDroppedEvents() { return droppedEvents_; }
+
+private:
+    static void onReceive(int count);
+    static void onRequest();
+    static TPP_EventLinkReceiver *pBusReceiver_;
+
+    // frames arrive in the I2C interrupt; getEvent() takes their events in loop().
+    // Each side only moves its own count, so the queue needs no lock.
+    volatile uint8_t events_[EVENT_LINK_QUEUE_LENGTH];
+    volatile uint8_t eventsIn_ = 0;     // counts up and wraps; the slot is the count % EVENT_LINK_QUEUE_LENGTH
+    volatile uint8_t eventsOut_ = 0;
+
+    volatile bool haveSequence_ = false;
+    volatile uint8_t lastSequence_ = 0;
+    volatile uint8_t lastStatus_ = EVENT_LINK_ACK_OK;
+    volatile unsigned long lastFrameMS_ = 0;
+
+    volatile unsigned long frames_ = 0;
+    volatile unsigned long badFrames_ = 0;
+    volatile unsigned long repeats_ = 0;         // frames sent again because their ack was lost
+    volatile unsigned long droppedEvents_ = 0;   // the queue was full
+};
+
+/*!
+ *  @brief  Class that sends events to the mouth and waits for them to be acked. Runs in the eyes.
+ */
+class TPP_EventLinkSender {
+public:
+    void begin(uint8_t address = EVENT_LINK_I2C_ADDRESS);
+    void setLoopback(TPP_EventLinkReceiver *pReceiver);
+    void injectFaults(uint8_t faults, int exchanges);
+    bool send(uint8_t event);
+    void process();
+    bool getUndelivered(uint8_t *pEvent);
+    bool isUp();
+    bool isIdle();
+    void logStats();
+
+private:
+    void startFrame(uint8_t type, uint8_t data);
+    bool exchange();
+    bool exchangeBus();
+    bool exchangeLoopback();
+    bool ackMatches(const uint8_t *pAck, int length);
+    void giveUp();
+    void handBack(uint8_t event);
+
+    uint8_t address_ = EVENT_LINK_I2C_ADDRESS;
+    TPP_EventLinkReceiver *pLoopback_ = nullptr;
+    uint8_t loopbackFaults_ = 0;
+    int faultyExchanges_ = 0;
+
+    uint8_t events_[EVENT_LINK_QUEUE_LENGTH];
+    int eventsOut_ = 0;
+    int numEvents_ = 0;
+
+    // given up: the event in flight and the ones queued behind it, oldest first
+    uint8_t undelivered_[EVENT_LINK_QUEUE_LENGTH + 1];
+    int numUndelivered_ = 0;
+
+    uint8_t frame_[EVENT_LINK_FRAME_BYTES];
+    bool inFlight_ = false;
+    bool inFlightIsEvent_ = false;
+    int tries_ = 0;
+    uint8_t sequence_ = 0;
+    unsigned long firstSentMS_ = 0;
+    unsigned long lastSentMS_ = 0;
+
+    bool haveAck_ = false;
+    unsigned long lastAckMS_ = 0;
+    unsigned long lastPingMS_ = 0;
+
+    // statistics
+    unsigned long sent_ = 0;
+    unsigned long retries_ = 0;
+    unsigned long lost_ = 0;
+    unsigned long maxLatencyMS_ = 0;
+};
+
+bool eventLinkLoopbackTest();
+
+#endif
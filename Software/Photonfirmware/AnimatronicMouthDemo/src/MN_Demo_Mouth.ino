@@ -15,8 +15,9 @@
  *  the Red LED goes out and the speaking sequence can be retriggered.
  * 
  *  The following Photon pins are used:
- *    D0, D1: these are reserved for I2C and brought out to the I2C PCB connector.  These
- *      pins are not used for the mouth function at this time.   
+ *    D0, D1: these are reserved for I2C and brought out to the I2C PCB connector.  Wired
+ *      to the I2C connector of the eyes board, they carry the TOF events from the eyes
+ *      (see TPP_EventLink.h).  The mouth is an I2C slave on the bus of the eyes.
  *    D2: connected on the PCB to the mini MP3 player BUSY line.
  *    D3: connected to the mouth driving servo
  *    D4: available as a 5 volt output pin, e.g. for a second servo.  Not used in this demo
@@ -38,8 +39,10 @@
  * (c) 2021, Team practical projects.  All rights reserved.
  * Released under open source, non-commercial license.
  * Date: 10/21/2022
- *              
- *              bug fix: set num_personalities to 4
+ * version 1.9: TOF events come from the eyes over a wired I2C link (TPP_EventLink.h) instead of
+ *                 the cloud. While the link is up the cloud "TOF_event" is ignored, as the eyes
+ *                 may mirror their events there; while it is down the cloud is used as before.
+ * version 1.8: bug fix: set num_personalities to 4
  *              Made Jim's personality be #2
  *              Added to not play same clip twice in a row for an event (unless there is only one clip)
  * version 1.7: moved audio clips to TPP_clipinfo and added TPP_Animatronic_Global.h
@@ -64,6 +67,7 @@
 #include <math.h>
 #include <TPP_clipinfo.h>
 #include <TPP_Animatronic_Global.h>
+#include <TPP_EventLink.h>
 
 #define BOB_MOUTH
 //#define JIM_MOUTH
@@ -75,6 +79,9 @@ DFRobotDFPlayerMini miniMP3Player;
 // create an instance of the servo
 Servo mouthServo;
 
+// the wired link that brings the events from the eyes
+TPP_EventLinkReceiver eyesLink;
+
 // define Photon pins
 const int BUSY_PIN = D2;
 const int SERVO_PIN = D3;
@@ -233,6 +240,10 @@ int PFmouthPosition(String data) {
 
 // subscription handler for events from eyes code
 void tofHandler(String event, String eventData) {
+    if (eyesLink.isUp()) {
+        // the eyes sent this over the wire already; this is just their mirror
+        return;
+    }
     newMouthEvent(eventData);
 }
 
@@ -284,6 +295,9 @@ void setup() {
     Serial1.begin(9600);
     miniMP3Player.begin(Serial1);
 
+    // listen for the eyes on the I2C bus
+    eyesLink.begin();
+
     // set up the mouth servo
     mouthServo.attach(SERVO_PIN);
 
@@ -338,6 +352,12 @@ void loop() {
     }
 
 
+    // take an event from the eyes that came in over the wired link
+    uint8_t linkEvent;
+    if (eyesLink.getEvent(&linkEvent)) {
+        newMouthEvent(String((int)linkEvent));
+    }
+
     // refresh the analog sampling and processing the mouth movement continuously
     speak();
 
@@ -0,0 +1,2 @@
+// the Device OS headers the libraries include are all in Particle.h
+#include <Particle.h>
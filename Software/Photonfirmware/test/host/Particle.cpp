@@ -0,0 +1,116 @@
+/*
+    Particle.cpp
+
+    Team Practical Project stand-in for the Particle Device OS
+
+    See Particle.h
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#include <Particle.h>
+
+USBSerial Serial;
+USARTSerial Serial1;
+TwoWire Wire;
+CloudClass Particle;
+SystemClass System;
+EEPROMClass EEPROM;
+Logger Log("app");
+
+LogLevel Logger::hostLogLevel = LOG_LEVEL_INFO;
+
+static unsigned long nowUS = 0;
+
+unsigned long millis() { return nowUS / 1000; }
+unsigned long micros() { return nowUS; }
+void delay(unsigned long ms) { nowUS += ms * 1000; }
+void delayMicroseconds(unsigned int us) { nowUS += us; }
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+long random(long howBig) { return (howBig > 0) ? rand() % howBig : 0; }
+long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+void randomSeed(unsigned int seed) { srand(seed); }
+
+void pinMode(pin_t pin, PinMode mode) {}
+int digitalRead(pin_t pin) { return HIGH; }     // the buttons have pull-ups
+void digitalWrite(pin_t pin, int value) {}
+
+/* ------------------------------ */
+bool CloudClass::publish(const char *name, const char *data, PublishFlag flag) {
+    hostPublished++;
+    snprintf(hostLastName, sizeof(hostLastName), "%s", name);
+    snprintf(hostLastData, sizeof(hostLastData), "%s", (data != nullptr) ? data : "");
+    return true;
+}
+
+/* ------------------------------ */
+// a semaphore is its count; the handle points at one of a few kept here
+#define HOST_SEMAPHORES 8
+static unsigned int semaphoreCounts[HOST_SEMAPHORES];
+static int numSemaphores = 0;
+
+int os_semaphore_create(os_semaphore_t *pSemaphore, unsigned int maxCount, unsigned int initialCount) {
+    if (numSemaphores >= HOST_SEMAPHORES) {
+        return -1;
+    }
+    semaphoreCounts[numSemaphores] = initialCount;
+    *pSemaphore = &semaphoreCounts[numSemaphores++];
+    return 0;
+}
+
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeoutMS, bool reserved) {
+    unsigned int *pCount = (unsigned int *)semaphore;
+    if (*pCount == 0) {
+        delay((timeoutMS == CONCURRENT_WAIT_FOREVER) ? 1 : timeoutMS);
+        return -1;
+    }
+    (*pCount)--;
+    return 0;
+}
+
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved) {
+    (*(unsigned int *)semaphore)++;
+    return 0;
+}
+
+void os_thread_yield() {}
+
+/* ------------------------------ */
+void Logger::print(LogLevel level, const char *format, va_list args) const {
+    if (!isLevelEnabled(level)) {
+        return;
+    }
+    const char *levelName = (level >= LOG_LEVEL_ERROR) ? "ERROR"
+                          : (level >= LOG_LEVEL_WARN) ? "WARN"
+                          : (level >= LOG_LEVEL_INFO) ? "INFO" : "TRACE";
+    printf("%010lu [%s] %s: ", millis(), name_, levelName);
+    vprintf(format, args);
+    printf("\n");
+}
+
+void Logger::log(LogLevel level, const char *format, ...) const {
+    va_list args;
+    va_start(args, format);
+    print(level, format, args);
+    va_end(args);
+}
+
+#define LOGGER_LEVEL_METHOD(method, level)                  \
+    void Logger::method(const char *format, ...) const {    \
+        va_list args;                                       \
+        va_start(args, format);                             \
+        print(level, format, args);                         \
+        va_end(args);                                       \
+    }
+
+LOGGER_LEVEL_METHOD(trace, LOG_LEVEL_TRACE)
+LOGGER_LEVEL_METHOD(info, LOG_LEVEL_INFO)
+LOGGER_LEVEL_METHOD(warn, LOG_LEVEL_WARN)
+LOGGER_LEVEL_METHOD(error, LOG_LEVEL_ERROR)
+LOGGER_LEVEL_METHOD(operator(), LOG_LEVEL_INFO)
@@ -0,0 +1,362 @@
+/*
+    Particle.h
+
+    Team Practical Project stand-in for the Particle Device OS, to run the
+    firmware's libraries and tests on a PC
+
+    Only what the firmware uses is here, and most of it does nothing:
+        millis() is a clock that only delay() and a semaphore wait move, so the
+            tests run in no time and give the same result each run
+        Loggers print to stdout; the Serial ports send nowhere
+        a Wire with no device on the bus nacks every transmission
+        a Thread is never started; the tests call what it would run
+        Particle.publish() counts the events and keeps the last one
+    Like the Device OS, none of it allocates memory once running, except String.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#ifndef _HOST_PARTICLE_H
+#define _HOST_PARTICLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef uint16_t pin_t;
+typedef uint32_t system_tick_t;
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+#define HEX 16
+#define DEC 10
+
+#define SYSTEM_THREAD(state)
+#define SYSTEM_MODE(mode)
+
+// -------- time ------------
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// -------- arithmetic ------------
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh);
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned int seed);
+template <class T, class L, class H> T constrain(T value, L low, H high) {
+    return (value < low) ? low : ((value > high) ? high : value);
+}
+
+// -------- pins ------------
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+enum { LOW = 0, HIGH = 1 };
+const pin_t D0 = 0, D1 = 1, D2 = 2, D3 = 3, D4 = 4, D5 = 5, D6 = 6, D7 = 7;
+const pin_t A0 = 10, A1 = 11, A2 = 12, A3 = 13, A4 = 14, A5 = 15, TX = 20, RX = 21;
+void pinMode(pin_t pin, PinMode mode);
+int digitalRead(pin_t pin);
+void digitalWrite(pin_t pin, int value);
+
+// -------- String ------------
+// keeps its text on the heap, as the Device OS String does
+class String {
+public:
+    String() : String("") {}
+    String(const char *text) { set(text, strlen(text)); }
+    String(const String &other) { set(other.p_, other.length_); }
+    explicit String(int value) { setNumber("%d", value); }
+    explicit String(long value) { setNumber("%ld", value); }
+    explicit String(unsigned int value) { setNumber("%u", value); }
+    explicit String(unsigned long value) { setNumber("%lu", value); }
+    explicit String(float value) { setNumber("%f", value); }
+    ~String() { free(p_); }
+
+    String &operator=(const String &other) {
+        if (this != &other) {
+            free(p_);
+            set(other.p_, other.length_);
+        }
+        return *this;
+    }
+
+    const char *c_str() const { return p_; }
+    operator const char *() const { return p_; }
+    unsigned int length() const { return length_; }
+    char charAt(unsigned int index) const { return (index < length_) ? p_[index] : 0; }
+    int toInt() const { return atoi(p_); }
+    float toFloat() const { return atof(p_); }
+    bool equals(const char *text) const { return strcmp(p_, text) == 0; }
+    bool operator==(const char *text) const { return equals(text); }
+    bool startsWith(const char *text) const { return strncmp(p_, text, strlen(text)) == 0; }
+    int indexOf(char c) const { const char *at = strchr(p_, c); return (at == nullptr) ? -1 : (int)(at - p_); }
+    String substring(unsigned int from) const { return substring(from, length_); }
+    String substring(unsigned int from, unsigned int to) const {
+        String part;
+        to = min(to, length_);
+        from = min(from, to);
+        part.set(p_ + from, to - from);
+        return part;
+    }
+    void trim() {}
+
+    String &operator+=(const char *text) {
+        size_t added = strlen(text);
+        p_ = (char *)realloc(p_, length_ + added + 1);
+        memcpy(p_ + length_, text, added + 1);
+        length_ += added;
+        return *this;
+    }
+    String &operator+=(const String &other) { return *this += other.p_; }
+    friend String operator+(const String &a, const String &b) { String sum(a); return sum += b; }
+    friend String operator+(const String &a, const char *b) { String sum(a); return sum += b; }
+    friend String operator+(const char *a, const String &b) { String sum(a); return sum += b; }
+
+private:
+    void set(const char *text, size_t length) {
+        p_ = (char *)malloc(length + 1);
+        memcpy(p_, text, length);
+        p_[length] = 0;
+        length_ = length;
+    }
+    template <class T> void setNumber(const char *format, T value) {
+        char text[24];
+        set(text, snprintf(text, sizeof(text), format, value));
+    }
+
+    char *p_ = nullptr;
+    unsigned int length_ = 0;
+};
+
+// -------- serial ports ------------
+class Print {
+public:
+    size_t print(const char *text) { return 0; }
+    size_t print(const String &text) { return 0; }
+    size_t print(char c) { return 0; }
+    size_t print(long value, int base = DEC) { return 0; }
+    size_t print(unsigned long value, int base = DEC) { return 0; }
+    size_t print(int value, int base = DEC) { return 0; }
+    size_t print(unsigned int value, int base = DEC) { return 0; }
+    size_t print(double value, int digits = 2) { return 0; }
+    size_t println() { return 0; }
+    size_t println(const char *text) { return 0; }
+    size_t println(const String &text) { return 0; }
+    size_t println(long value, int base = DEC) { return 0; }
+    size_t println(unsigned long value, int base = DEC) { return 0; }
+    size_t println(int value, int base = DEC) { return 0; }
+    size_t println(unsigned int value, int base = DEC) { return 0; }
+    size_t println(double value, int digits = 2) { return 0; }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) { return 0; }
+    size_t printlnf(const char *format, ...) __attribute__((format(printf, 2, 3))) { return 0; }
+    size_t write(uint8_t data) { return 1; }
+    size_t write(const uint8_t *pData, size_t length) { return length; }
+};
+
+class Stream : public Print {
+public:
+    int available() { return 0; }
+    int availableForWrite() { return 64; }
+    int read() { return -1; }
+    int peek() { return -1; }
+    void flush() {}
+};
+
+class USBSerial : public Stream {
+public:
+    void begin(long baud = 9600) {}
+    bool isConnected() { return true; }
+};
+
+class USARTSerial : public Stream {
+public:
+    void begin(long baud) {}
+    void end() {}
+};
+
+extern USBSerial Serial;
+extern USARTSerial Serial1;
+
+// -------- I2C ------------
+// a bus with nothing on it: every transmission is nacked
+class TwoWire : public Stream {
+public:
+    void begin() {}
+    void begin(uint8_t address) {}
+    void setClock(uint32_t hz) {}
+    void onReceive(void (*handler)(int)) {}
+    void onRequest(void (*handler)()) {}
+    void beginTransmission(uint8_t address) {}
+    void beginTransmission(int address) {}
+    uint8_t endTransmission(bool stop = true) { return 2; }
+    uint8_t requestFrom(uint8_t address, uint8_t length, uint8_t stop = true) { return 0; }
+    uint8_t requestFrom(int address, int length, int stop = true) { return 0; }
+    bool isEnabled() { return true; }
+    void reset() {}
+    bool lock() { return true; }
+    void unlock() {}
+};
+extern TwoWire Wire;
+
+// the firmware may hand Wire larger buffers
+enum { HAL_I2C_CONFIG_VERSION_1 = 1 };
+typedef struct {
+    uint16_t size;
+    uint16_t version;
+    uint8_t *rx_buffer;
+    uint32_t rx_buffer_size;
+    uint8_t *tx_buffer;
+    uint32_t tx_buffer_size;
+} hal_i2c_config_t;
+
+// -------- logging ------------
+typedef enum {
+    LOG_LEVEL_ALL = 1,
+    LOG_LEVEL_TRACE = 1,
+    LOG_LEVEL_INFO = 30,
+    LOG_LEVEL_WARN = 40,
+    LOG_LEVEL_ERROR = 50,
+    LOG_LEVEL_NONE = 70
+} LogLevel;
+
+class Logger {
+public:
+    explicit Logger(const char *name) : name_(name) {}
+    const char *name() const { return name_; }
+    bool isLevelEnabled(LogLevel level) const { return level >= hostLogLevel; }
+    bool isTraceEnabled() const { return isLevelEnabled(LOG_LEVEL_TRACE); }
+    bool isInfoEnabled() const { return isLevelEnabled(LOG_LEVEL_INFO); }
+
+    void log(LogLevel level, const char *format, ...) const __attribute__((format(printf, 3, 4)));
+    void trace(const char *format, ...) const __attribute__((format(printf, 2, 3)));
+    void info(const char *format, ...) const __attribute__((format(printf, 2, 3)));
+    void warn(const char *format, ...) const __attribute__((format(printf, 2, 3)));
+    void error(const char *format, ...) const __attribute__((format(printf, 2, 3)));
+    void operator()(const char *format, ...) const __attribute__((format(printf, 2, 3)));
+
+    static LogLevel hostLogLevel;       // the tests may quieten the firmware
+
+private:
+    void print(LogLevel level, const char *format, va_list args) const;
+    const char *name_;
+};
+extern Logger Log;
+
+struct LogCategoryFilter {
+    LogCategoryFilter(const char *category, LogLevel level) {}
+};
+typedef std::initializer_list<LogCategoryFilter> LogCategoryFilters;
+
+class LogHandler {
+public:
+    LogHandler(LogLevel level = LOG_LEVEL_INFO, LogCategoryFilters filters = {}) {}
+    virtual ~LogHandler() {}
+};
+
+class StreamLogHandler : public LogHandler {
+public:
+    StreamLogHandler(Print &stream, LogLevel level = LOG_LEVEL_INFO, LogCategoryFilters filters = {})
+        : LogHandler(level, filters) {}
+protected:
+    virtual void logMessage(const char *msg, LogLevel level, const char *category, const void *attr) {}
+};
+
+class SerialLogHandler : public StreamLogHandler {
+public:
+    SerialLogHandler(LogLevel level = LOG_LEVEL_INFO, LogCategoryFilters filters = {})
+        : StreamLogHandler(Serial, level, filters) {}
+};
+
+// -------- cloud ------------
+enum PublishFlag { PUBLIC, PRIVATE, NO_ACK, WITH_ACK };
+
+class CloudClass {
+public:
+    bool publish(const char *name, const char *data = nullptr, PublishFlag flag = PRIVATE);
+    template <class F> bool function(const char *name, F function) { return true; }
+    template <class T> bool variable(const char *name, T variable) { return true; }
+    bool connected() { return true; }
+
+    // for the tests
+    unsigned long hostPublished = 0;
+    char hostLastName[64] = "";
+    char hostLastData[64] = "";
+};
+extern CloudClass Particle;
+
+class SystemClass {
+public:
+    void reset() {}
+    uint32_t freeMemory() { return 60000; }
+    uint32_t ticks() { return micros() * ticksPerMicrosecond(); }
+    static uint32_t ticksPerMicrosecond() { return 120; }
+};
+extern SystemClass System;
+
+class EEPROMClass {
+public:
+    template <class T> T &get(int address, T &t) { memset((void *)&t, 0xFF, sizeof(T)); return t; }
+    template <class T> const T &put(int address, const T &t) { return t; }
+    uint8_t read(int address) { return 0xFF; }
+    void write(int address, uint8_t value) {}
+    size_t length() { return 2047; }
+};
+extern EEPROMClass EEPROM;
+
+// -------- threads ------------
+// one thread on the PC: a Thread is never started, locks are free, and a
+// semaphore wait that would block moves the clock on by its timeout instead
+typedef void *os_semaphore_t;
+typedef void *os_thread_t;
+typedef void os_thread_return_t;
+#define OS_THREAD_PRIORITY_DEFAULT 2
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+
+int os_semaphore_create(os_semaphore_t *pSemaphore, unsigned int maxCount, unsigned int initialCount);
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeoutMS, bool reserved);
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved);
+void os_thread_yield();
+inline bool HAL_IsISR() { return false; }
+
+class Thread {
+public:
+    Thread(const char *name, void (*function)(void *), void *param,
+        int priority = OS_THREAD_PRIORITY_DEFAULT, size_t stackSize = 3072) {}
+    bool isValid() { return true; }
+};
+
+class Mutex {
+public:
+    void lock() {}
+    bool trylock() { return true; }
+    bool try_lock() { return true; }
+    void unlock() {}
+};
+class RecursiveMutex : public Mutex {};
+
+#define WITH_LOCK(lockable) if (true)
+#define ATOMIC_BLOCK() if (true)
+class SingleThreadedSection {};
+
+class Timer {
+public:
+    Timer(unsigned int periodMS, void (*callback)()) {}
+    void start() {}
+    void stop() {}
+};
+
+#endif
@@ -0,0 +1,15 @@
+#!/bin/sh
+# ino2cpp.sh sketch.ino > sketch.cpp
+#
+# Turns a sketch into C++ the way the Particle preprocessor does: the sketch's
+# #includes first, then a prototype for each function it defines, then the sketch.
+# Only functions whose whole signature and opening brace are on one line get a
+# prototype, which is what the sketches here need.
+
+INO=$1
+
+grep -E '^#include' "$INO"
+grep -E '^(void|int|bool|long|unsigned long|float|uint[0-9]+_t|int[0-9]+_t) +[A-Za-z_][A-Za-z0-9_]*\(.*\) *\{' "$INO" \
+    | sed 's/ *{.*$/;/'
+echo "#line 1 \"$INO\""
+cat "$INO"
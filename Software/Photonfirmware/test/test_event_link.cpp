@@ -0,0 +1,97 @@
+/*
+    test_event_link.cpp
+
+    Team Practical Project host test of the wired event link, see TPP_EventLink.h
+
+    Runs eventLinkLoopbackTest(), the same cases the eyes run from their cloud
+    function, then many runs with random faults. In each run every event sent must
+    reach the mouth once and in order, or come back from getUndelivered() for the
+    cloud. With fewer faults than EVENT_LINK_MAX_TRIES nothing may come back.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#include <Particle.h>
+#include <TPP_EventLink.h>
+
+#define RANDOM_RUNS 2000
+
+/* ------------------------------ */
+// returns true if the run kept every event
+static bool randomRun(int run) {
+
+    TPP_EventLinkReceiver receiver;
+    TPP_EventLinkSender sender;
+    sender.setLoopback(&receiver);
+    sender.begin();
+    sender.process();               // the first ping brings the link up
+    if (!sender.isUp()) {
+        printf("run %d: link did not come up\n", run);
+        return false;
+    }
+
+    int numEvents = 1 + rand() % EVENT_LINK_QUEUE_LENGTH;
+    uint8_t faults = 1 << (rand() % 4);
+    int faultyExchanges = rand() % (EVENT_LINK_MAX_TRIES + 2);
+    sender.injectFaults(faults, faultyExchanges);
+    for (int i = 0; i < numEvents; i++) {
+        sender.send(i + 1);
+    }
+    for (int ms = 0; (ms < 1000) && !sender.isIdle(); ms++) {
+        sender.process();
+        delay(1);
+    }
+
+    // a lost ack can leave an event both delivered and handed back, never neither
+    bool kept[EVENT_LINK_QUEUE_LENGTH + 1] = {};
+    int delivered = 0;
+    int handedBack = 0;
+    uint8_t event;
+    uint8_t last = 0;
+    bool passed = true;
+    while (receiver.getEvent(&event)) {
+        passed = passed && (event > last) && (event <= numEvents);
+        last = event;
+        kept[event] = true;
+        delivered++;
+    }
+    while (sender.getUndelivered(&event)) {
+        passed = passed && (event >= 1) && (event <= numEvents);
+        kept[event] = true;
+        handedBack++;
+    }
+    for (int i = 1; i <= numEvents; i++) {
+        passed = passed && kept[i];
+    }
+    if (faultyExchanges < EVENT_LINK_MAX_TRIES) {
+        passed = passed && (delivered == numEvents) && (handedBack == 0);
+    }
+
+    if (!passed) {
+        printf("run %d: faults 0x%02x x%d, %d events, delivered %d, handed back %d\n",
+            run, faults, faultyExchanges, numEvents, delivered, handedBack);
+    }
+    return passed;
+}
+
+int main() {
+
+    bool passed = eventLinkLoopbackTest();
+
+    Logger::hostLogLevel = LOG_LEVEL_ERROR;     // the give-ups are expected
+    srand(1);
+    int failed = 0;
+    for (int run = 0; run < RANDOM_RUNS; run++) {
+        if (!randomRun(run)) {
+            failed++;
+        }
+    }
+    printf("random faults: %d of %d runs failed\n", failed, RANDOM_RUNS);
+
+    passed = passed && (failed == 0);
+    printf("test_event_link %s\n", passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+/*
+    test_no_alloc.cpp
+
+    Team Practical Project host test that the running eyes allocate no memory
+
+    Once the head is running, the tasks of loop() must not use new, malloc or
+    String: the heap of the Photon is small and fragments. This test builds the
+    whole AnimatronicEyes sketch against the stand-in for the Device OS, with
+    malloc, calloc, realloc and new counted. It runs setup() and the start up
+    sequence, then counts while people come and go for TEST_MS. The TOF thread
+    does not run on the PC, so the test makes up the frames of an 8x8 sensor and
+    queues their results with TPP_TOFThread::replayFrame: the POI pipeline, the
+    tracker, the gaze prediction and filter, the animation, the head state
+    machine, the events to the mouth, the mouth link, the publish queue, the
+    servos and the deferred log all run. Any allocation fails the test, as does
+    a person the eyes do not follow.
+
+    Not covered: reading the sensors over I2C, and the cloud functions, which
+    take a String and are exempt.
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#include <Particle.h>
+#include <TPP_TOFThread.h>
+#include <TPP_GazeFilter.h>
+#include <new>
+
+#define STARTUP_MS 60000        // the start up sequence is done well before this
+#define TEST_MS 120000
+#define VISIT_MS 10000          // a person comes close, closer, then leaves, this often
+#define FRAME_MS 66             // 15 frames a second
+#define WIDTH 8
+#define ZONES (WIDTH * WIDTH)
+#define WALL_MM 2000
+#define STATUS_VALID 5
+
+void setup();
+void loop();
+extern TPP_TOFThread tofThread;
+extern TPP_GazeFilter gazeFilter;
+
+static bool counting = false;
+static unsigned long allocations = 0;
+
+// -------- allocation counters ------------
+// the firmware's calls to malloc and friends come here, see -Wl,--wrap in the Makefile
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations += counting;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations += counting;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    allocations += counting;
+    return __real_realloc(p, size);
+}
+}
+
+void *operator new(size_t size) {
+    allocations += counting;
+    void *p = __real_malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    allocations += counting;
+    return __real_malloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t size) noexcept { free(p); }
+void operator delete[](void *p, size_t size) noexcept { free(p); }
+
+/* ------------------------------ */
+// the frame the TOF would see at elapsedMS: a wall, then someone walks across
+// it from left to right, comes too close on the way, steps back and leaves
+static void makeFrame(unsigned long elapsedMS, tofFrame *pFrame) {
+
+    pFrame->flags = 0;
+    pFrame->numZones = ZONES;
+    pFrame->frameNumber++;
+    pFrame->timestampMS = millis();
+    for (int zone = 0; zone < ZONES; zone++) {
+        pFrame->distanceMM[zone] = WALL_MM + ((pFrame->frameNumber * 31 + zone * 17) % 11) - 5;
+        pFrame->status[zone] = STATUS_VALID;
+    }
+
+    unsigned long inVisitMS = elapsedMS % VISIT_MS;
+    if ((inVisitMS < 2000) || (inVisitMS >= 8000)) {
+        return;
+    }
+    int personMM = (inVisitMS < 4000) ? 1200 : (inVisitMS < 6000) ? 200 : 800;
+    int x = 1 + (5 * (inVisitMS - 2000)) / 6000;
+
+    // two zones wide and four high, their chest in row 3 nearest
+    for (int y = 2; y < 6; y++) {
+        for (int dx = 0; dx < 2; dx++) {
+            pFrame->distanceMM[y * WIDTH + x + dx] = personMM + 40 * (y != 3) + 20 * dx;
+        }
+    }
+}
+
+int main() {
+
+    Logger::hostLogLevel = LOG_LEVEL_WARN;      // the eyes log their start up at info
+
+    setup();
+    unsigned long startMS = millis();
+    while (millis() - startMS < STARTUP_MS) {
+        loop();
+        delay(1);
+    }
+
+    // the calibration of the sensor: the empty scene
+    static tofFrame frame;
+    makeFrame(0, &frame);
+    frame.flags = TOF_FRAME_FLAG_CALIBRATION;
+    tofThread.replayFrame(frame);
+
+    unsigned long publishedBefore = Particle.hostPublished;
+    unsigned long retargetsBefore = gazeFilter.getRetargets();
+    counting = true;
+    unsigned long testStartMS = millis();
+    unsigned long lastFrameMS = testStartMS;
+    while (millis() - testStartMS < TEST_MS) {
+        if (millis() - lastFrameMS >= FRAME_MS) {
+            lastFrameMS = millis();
+            makeFrame(lastFrameMS - testStartMS, &frame);
+            tofThread.replayFrame(frame);
+        }
+        loop();
+        delay(1);
+    }
+    counting = false;
+
+    // the mouth is not on the bus, so the events went to the cloud
+    unsigned long published = Particle.hostPublished - publishedBefore;
+    printf("%lu events published, the last %s %s\n", published, Particle.hostLastName, Particle.hostLastData);
+    unsigned long retargets = gazeFilter.getRetargets() - retargetsBefore;
+    printf("%lu eye moves for %d visitors, %lu TOF results dropped\n",
+        retargets, TEST_MS / VISIT_MS, tofThread.getResultsDropped());
+    printf("%lu allocations in %d s of running\n", allocations, TEST_MS / 1000);
+
+    bool passed = (allocations == 0) && (published > 0) && (retargets >= TEST_MS / VISIT_MS);
+    printf("test_no_alloc %s\n", passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
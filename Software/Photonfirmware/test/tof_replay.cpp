@@ -0,0 +1,246 @@
+/*
+    tof_replay.cpp
+
+    Team Practical Project host replay of recorded TOF frames
+
+    Reads a capture of the serial stream of the "tof recorder serial" cloud
+    function (see TPP_TOFRecorder.h), for example saved by the depth map viewer
+    or with "cat /dev/ttyACM0 > capture.tof". Log messages in the capture are
+    skipped; each frame is found by its sync word and checked by its CRC.
+
+    The frames of one sensor are run through TPP_TOF::replayFrame, which is the
+    POI pipeline of the head: TPP_Background, TPP_Tracker, the zone search and
+    the temporal filter. They are run twice, in ROI mode as on the head and
+    processing the full frame (see TPP_TOF::setROIMode). The report gives
+        throughput      frames a second on this PC, and the time of each frame, of each
+        ROI diffs       frames where ROI mode decides differently from the full frame
+        frame rate      of the capture, from the timestamps the head put on it
+        decision diffs  frames where the replayed decision is not the recorded one
+    so a change to the pipeline can be checked against a recorded scene before
+    it goes on the head. Built with TPP_PROFILE ("make tof_replay_profile") it
+    also prints the table of TPP_Profiler. A capture made in confidence mode is refused, see
+    TOF_FRAME_FLAG_CONFIDENCE.
+
+    usage: tof_replay [-s sensor] [-g] [-d maxDiffs] capture
+        -s  the sensor to replay, 0 if not given
+        -g  use the generic zone search instead of the one for the image width
+        -d  fail (exit 1) if more than maxDiffs decisions differ
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#include <Particle.h>
+#include <TPP_TOFArray.h>
+#include <TPP_TOFFrame.h>
+#include <TPP_Profiler.h>
+#include <chrono>
+#include <vector>
+
+#define MAX_DIFFS_PRINTED 20
+
+/* ------------------------------ */
+static bool readFile(const char *path, std::vector<uint8_t> *pData) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        pData->insert(pData->end(), chunk, chunk + length);
+    }
+    fclose(file);
+    return true;
+}
+
+/* ------------------------------ */
+// the time per frame of one of the replays
+static void printTiming(const char *name, const std::vector<double> &frameUS) {
+
+    int numFrames = frameUS.size();
+    std::vector<double> sorted = frameUS;
+    std::sort(sorted.begin(), sorted.end());
+    double totalUS = 0;
+    for (double us : frameUS) {
+        totalUS += us;
+    }
+    printf("%s: %.0f frames/s, per frame min %.1f avg %.1f p99 %.1f max %.1f us\n",
+        name, numFrames * 1000000.0 / max(totalUS, 1.0),
+        sorted.front(), totalUS / numFrames, sorted[(numFrames * 99) / 100], sorted.back());
+}
+
+/* ------------------------------ */
+static void usage() {
+    fprintf(stderr, "usage: tof_replay [-s sensor] [-g] [-d maxDiffs] capture\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+
+    int sensorIndex = 0;
+    bool genericSearch = false;
+    int maxDiffs = -1;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+            sensorIndex = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            genericSearch = true;
+        } else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) {
+            maxDiffs = atoi(argv[++i]);
+        } else if ((argv[i][0] != '-') && (path == NULL)) {
+            path = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (path == NULL) {
+        usage();
+    }
+
+    std::vector<uint8_t> capture;
+    if (!readFile(path, &capture)) {
+        fprintf(stderr, "can not read %s\n", path);
+        return 2;
+    }
+
+    Logger::hostLogLevel = LOG_LEVEL_WARN;
+    static TPP_TOF tof;         // big; keep them off the stack
+    static TPP_TOF fullTOF;
+    tof.setGenericSearch(genericSearch);
+    fullTOF.setGenericSearch(genericSearch);
+    fullTOF.setROIMode(false);
+
+    static tofFrame previous[TOF_MAX_SENSORS];
+    bool havePrevious[TOF_MAX_SENSORS] = {};
+    tofFrame frame;
+    pointOfInterest POI;
+    pointOfInterest fullPOI;
+
+    std::vector<double> frameUS;
+    std::vector<double> fullFrameUS;
+    int skippedBytes = 0;
+    int calibrations = 0;
+    int decisions = 0;
+    int diffs = 0;
+    int roiDiffs = 0;
+    int detections = 0;
+    unsigned long firstMS = 0;
+    unsigned long lastMS = 0;
+
+    const uint8_t *data = capture.data();
+    int length = capture.size();
+    int offset = 0;
+    while (offset + 1 < length) {
+
+        // the sync word, little endian
+        if ((data[offset] != (TOF_FRAME_SYNC & 0xFF)) || (data[offset + 1] != (TOF_FRAME_SYNC >> 8))) {
+            offset++;
+            skippedBytes++;
+            continue;
+        }
+        int sensor = (offset + 6 < length) ? data[offset + 6] : 0;
+        const tofFrame *pPrevious = ((sensor < TOF_MAX_SENSORS) && havePrevious[sensor]) ? &previous[sensor] : NULL;
+        int used = decodeTOFFrame(&data[offset], length - offset, pPrevious, &frame);
+        if (used == 0) {
+            break;      // the capture ends part way through a frame
+        }
+        if (used < 0) {
+            offset++;   // a log message that happens to hold the sync word
+            skippedBytes++;
+            continue;
+        }
+        offset += used;
+
+        if (frame.sensorIndex >= TOF_MAX_SENSORS) {
+            continue;
+        }
+        bool isCalibration = frame.flags & TOF_FRAME_FLAG_CALIBRATION;
+        if (!isCalibration) {
+            previous[frame.sensorIndex] = frame;
+            havePrevious[frame.sensorIndex] = true;
+        }
+        if (frame.sensorIndex != sensorIndex) {
+            continue;
+        }
+        if (frame.flags & TOF_FRAME_FLAG_CONFIDENCE) {
+            // the sigma, signal and reflectance it was decided on are not recorded
+            fprintf(stderr, "%s: frame %u of sensor %d was recorded in confidence mode and can not be replayed\n",
+                path, frame.frameNumber, sensorIndex);
+            return 2;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tof.replayFrame(frame, &POI);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        fullTOF.replayFrame(frame, &fullPOI);
+        std::chrono::duration<double, std::micro> took = end - start;
+        std::chrono::duration<double, std::micro> fullTook = std::chrono::steady_clock::now() - end;
+
+        if (isCalibration) {
+            calibrations++;
+            continue;
+        }
+        if (!POI.gotNewSensorData) {
+            continue;   // no calibration for this resolution yet
+        }
+        frameUS.push_back(took.count());
+        fullFrameUS.push_back(fullTook.count());
+        roiDiffs += (POI.hasDetection != fullPOI.hasDetection)
+            || (POI.x != fullPOI.x) || (POI.y != fullPOI.y) || (POI.distanceMM != fullPOI.distanceMM);
+        if (frameUS.size() == 1) {
+            firstMS = frame.timestampMS;
+        }
+        lastMS = frame.timestampMS;
+        detections += POI.hasDetection;
+
+        if (!(frame.flags & TOF_FRAME_FLAG_DECISION)) {
+            continue;
+        }
+        decisions++;
+        if (       (POI.hasDetection != frame.hasDetection)
+                || (POI.hasDetection && ((POI.x != frame.x) || (POI.y != frame.y)))) {
+            diffs++;
+            if (diffs <= MAX_DIFFS_PRINTED) {
+                printf("frame %u: recorded %d (%d, %d), replayed %d (%d, %d)\n",
+                    frame.frameNumber, frame.hasDetection, frame.x, frame.y,
+                    POI.hasDetection, POI.x, POI.y);
+            }
+        }
+    }
+
+    int numFrames = frameUS.size();
+    printf("%s: sensor %d, %d calibration and %d measurement frames, %d bytes of other output skipped\n",
+        path, sensorIndex, calibrations, numFrames, skippedBytes);
+    if (numFrames == 0) {
+        printf("no frames to replay\n");
+        return 1;
+    }
+
+    const char *search = genericSearch ? "generic" : "image width";
+    char name[64];
+    snprintf(name, sizeof(name), "ROI, %s zone search", search);
+    printTiming(name, frameUS);
+    snprintf(name, sizeof(name), "full frame, %s zone search", search);
+    printTiming(name, fullFrameUS);
+    printf("%lu frames processed in the ROI; %d of %d differ from the full frame\n",
+        tof.getROIFrames(), roiDiffs, numFrames);
+    if ((numFrames > 1) && (lastMS > firstMS)) {
+        printf("captured at %.1f frames/s over %.1f s\n",
+            (numFrames - 1) * 1000.0 / (lastMS - firstMS), (lastMS - firstMS) / 1000.0);
+    }
+    printf("%d frames with a detection; %d of %d recorded decisions differ\n", detections, diffs, decisions);
+#ifdef TPP_PROFILE
+    profiler.dump();
+#endif
+
+    if ((maxDiffs >= 0) && (diffs > maxDiffs)) {
+        printf("tof_replay FAILED: more than %d decisions differ\n", maxDiffs);
+        return 1;
+    }
+    return 0;
+}
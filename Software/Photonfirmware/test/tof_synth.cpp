@@ -0,0 +1,140 @@
+/*
+    tof_synth.cpp
+
+    Team Practical Project synthetic TOF capture, for tof_replay
+
+    Writes what the head would send with "tof recorder serial" while watching a
+    made up scene, so tof_replay can be tested without a head: an 8x8 sensor at
+    15 frames a second looks at a wall 2 m away. A shelf was put up in the top
+    right corner after the head calibrated, and the head has since learned it
+    into the background, so the calibration frame holds it as the recorder
+    writes it. Twice a person walks across in front of it at about 1 m, then
+    leaves. A log line goes out between frames now and then, as on the real port.
+
+    The decision recorded with each frame is the right answer, not what the
+    firmware made of it: the nearest zone of the person, once they have been seen
+    for FRAMES_FOR_GOOD_HIT frames. tof_replay then counts the frames where the
+    pipeline gets it wrong.
+
+    usage: tof_synth capture
+
+    Author: Bob Glicksman, Jim Schrempp
+    (c) Copyright 2026 Bob Glicksman and Jim Schrempp
+
+    This work is licensed under a Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+*/
+
+#include <TPP_TOFFrame.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 8
+#define ZONES (WIDTH * WIDTH)
+#define FRAME_MS 66
+#define NUM_FRAMES 400
+#define WALL_MM 2000
+#define PERSON_MM 1000
+#define SHELF_MM 1500
+#define FRAMES_FOR_GOOD_HIT 2       // as in TPP_TOF.cpp
+#define STATUS_VALID 5
+
+// frames when someone is in view, and the zone columns they walk between
+typedef struct {
+    int firstFrame;
+    int lastFrame;
+    int fromX;
+    int toX;
+} visit;
+
+const visit VISITS[] = {
+    { 60, 180, 1, 6 },
+    { 250, 340, 6, 2 }
+};
+
+/* ------------------------------ */
+// the distance of the empty scene at a zone
+static int backgroundMM(int zone) {
+    bool shelf = (zone / WIDTH < 2) && (zone % WIDTH >= 5);
+    return shelf ? SHELF_MM : WALL_MM;
+}
+
+/* ------------------------------ */
+// a few mm of noise, the same each run
+static int noise(int frame, int zone) {
+    return ((frame * 31 + zone * 17) % 11) - 5;
+}
+
+/* ------------------------------ */
+static bool writeFrame(FILE *file, tofFrame *pFrame) {
+    uint8_t encoded[TOF_FRAME_MAX_BYTES];
+    pFrame->flags |= TOF_FRAME_FLAG_STATUS_NIBBLES | TOF_FRAME_FLAG_CRC;
+    int length = encodeTOFFrame(pFrame, NULL, encoded, sizeof(encoded));
+    return (length > 0) && (fwrite(encoded, 1, length, file) == (size_t)length);
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: tof_synth capture\n");
+        return 2;
+    }
+    FILE *file = fopen(argv[1], "wb");
+    if (file == NULL) {
+        fprintf(stderr, "can not write %s\n", argv[1]);
+        return 2;
+    }
+
+    static tofFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.numZones = ZONES;
+
+    // the calibration: the empty scene as the head has learned it
+    frame.flags = TOF_FRAME_FLAG_CALIBRATION;
+    for (int zone = 0; zone < ZONES; zone++) {
+        frame.distanceMM[zone] = backgroundMM(zone);
+        frame.status[zone] = STATUS_VALID;
+    }
+    bool ok = writeFrame(file, &frame);
+
+    for (int f = 0; (f < NUM_FRAMES) && ok; f++) {
+
+        frame.flags = TOF_FRAME_FLAG_DECISION;
+        frame.frameNumber = f;
+        frame.timestampMS = 5000 + f * FRAME_MS;
+        for (int zone = 0; zone < ZONES; zone++) {
+            frame.distanceMM[zone] = backgroundMM(zone) + noise(f, zone);
+            frame.status[zone] = STATUS_VALID;
+        }
+
+        // a person is two zones wide and four high, their chest in row 3 nearest
+        frame.hasDetection = false;
+        for (const visit &v : VISITS) {
+            if ((f < v.firstFrame) || (f > v.lastFrame)) {
+                continue;
+            }
+            int x = v.fromX + ((v.toX - v.fromX) * (f - v.firstFrame)) / (v.lastFrame - v.firstFrame);
+            for (int y = 2; y < 6; y++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    int zoneX = (x + dx < WIDTH) ? x + dx : x - 1;
+                    frame.distanceMM[y * WIDTH + zoneX] = PERSON_MM + 40 * (y != 3) + 20 * dx + noise(f, zoneX);
+                }
+            }
+            frame.hasDetection = (f - v.firstFrame + 1 >= FRAMES_FOR_GOOD_HIT);
+            frame.x = x;
+            frame.y = 3;
+            frame.decisionDistanceMM = frame.distanceMM[3 * WIDTH + x];
+        }
+        ok = writeFrame(file, &frame);
+
+        if ((f % 25 == 0) && ok) {
+            fprintf(file, "%010d [app.main] INFO: a log message between frames\r\n", frame.timestampMS);
+        }
+    }
+
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "could not write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}